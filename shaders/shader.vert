@@ -1,6 +1,7 @@
 #version 450
 
-layout(location = 0) in vec3 inPosition;  // use vec3 for 3D positions
+// Locations follow VertexAttribute; normalized formats arrive as floats
+layout(location = 0) in vec3 inPosition;  // in the mesh position box
 layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
@@ -11,12 +12,22 @@ layout(set = 0, binding = 0) uniform CameraUBO {
     mat4 proj;
 } camera;
 
-layout(set = 0, binding = 1) uniform ModelUBO {
+// Per-frame object table, firstInstance of each draw selects the entry
+struct ObjectData {
     mat4 model;
-} model;
+    vec4 positionOffset;
+    vec4 positionScale;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
 
 void main() {
-    gl_Position = camera.proj * camera.view * model.model * vec4(inPosition, 1.0);
-    // gl_Position = model.model * vec4(inPosition, 1.0);
+    ObjectData object = objects[gl_InstanceIndex];
+    vec3 position = object.positionOffset.xyz +
+                    inPosition * object.positionScale.xyz;
+    gl_Position = camera.proj * camera.view * object.model *
+                  vec4(position, 1.0);
     fragColor = inColor;
 }
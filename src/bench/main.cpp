@@ -0,0 +1,512 @@
+#include "core/jobSystem.h"
+#include "core/profiler.h"
+#include "renderer/assetStreamer.h"
+#include "renderer/camera.h"
+#include "renderer/meshFile.h"
+#include "renderer/renderItem.h"
+#include "renderer/renderer.h"
+#include "renderer/uniforms.h"
+#include "rhi/vulkan/commandContext.h"
+#include "rhi/vulkan/device.h"
+#include "rhi/vulkan/frame.h"
+#include "rhi/vulkan/gpuProfiler.h"
+#include "rhi/vulkan/instance.h"
+#include "rhi/vulkan/offscreenTarget.h"
+#include "rhi/vulkan/pipeline.h"
+#include "rhi/vulkan/renderRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Headless frame-time benchmark. Builds a grid of RenderItems over one or
+// more cube meshes, renders a fixed number of frames offscreen and prints
+// the timings as JSON. With --stream-dir the items instead come from
+// cooked regions streamed in under a budget while the camera flies past.
+
+struct BenchConfig {
+  uint32_t items = 1000;
+  uint32_t meshes = 1;
+  // Cooked .mesh whose submeshes replace the generated cubes
+  std::string meshFile;
+  // compact, lit or full; a --mesh-file must be cooked with the same one.
+  // The generated cubes have no normals, tangents or UVs for lit.
+  std::string vertexLayout = "compact";
+  // Directory of cooked .mesh files, one region each, laid out along x and
+  // streamed in as the camera passes; replaces the grid of items
+  std::string streamDir;
+  float regionSpacing = 20.0f;
+  // Resident geometry budget of the streamed regions
+  uint64_t budgetMb = 64;
+  uint32_t frames = 500;
+  uint32_t warmupFrames = 50;
+  // Frames rendered one at a time to measure submit-to-fence latency
+  uint32_t gpuFrames = 100;
+  uint32_t width = 1280;
+  uint32_t height = 720;
+  int framesInFlight = 3;
+  // Draws per GPU draw-range zone, 0 = only pass zones
+  uint32_t gpuDrawRange = 0;
+  // Record one vkCmdDrawIndexed per batch instead of multi-draw indirect
+  bool direct = false;
+  // Worker threads recording direct draws in secondary buffers, 0 = off
+  uint32_t recordThreads = 0;
+  // Job system workers for culling, sorting and packing, 0 = serial
+  uint32_t jobThreads = 0;
+  // Frustum cull in a compute pass before the main pass (indirect only)
+  bool gpuCull = false;
+  // Two-phase Hi-Z occlusion culling on top of --gpu-cull
+  bool occlusion = false;
+  // Per-meshlet culling of meshes with enough meshlets, on top of --gpu-cull
+  bool meshlets = false;
+  // Disable the SIMD CPU frustum cull that runs when GPU culling is off
+  bool noCpuCull = false;
+  // Screen-space LOD error in pixels, 0 = always the full meshes
+  float lodThreshold = 1.0f;
+  bool validation = false;
+  std::string out;
+  // Chrome trace of the CPU zones, written after the run
+  std::string trace;
+};
+
+struct Percentiles {
+  double mean = 0.0;
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+};
+
+static Percentiles computePercentiles(std::vector<double> samples) {
+  Percentiles p;
+  if (samples.empty())
+    return p;
+
+  std::sort(samples.begin(), samples.end());
+  auto at = [&](double q) {
+    size_t rank = static_cast<size_t>(std::ceil(q * samples.size()));
+    return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+  };
+
+  double sum = 0.0;
+  for (double s : samples)
+    sum += s;
+
+  p.mean = sum / samples.size();
+  p.p50 = at(0.50);
+  p.p95 = at(0.95);
+  p.p99 = at(0.99);
+  p.max = samples.back();
+  return p;
+}
+
+static void writePercentiles(std::ostream &os, const Percentiles &p) {
+  os << "{\"mean\": " << p.mean << ", \"p50\": " << p.p50
+     << ", \"p95\": " << p.p95 << ", \"p99\": " << p.p99
+     << ", \"max\": " << p.max << "}";
+}
+
+static VertexLayout parseLayout(const std::string &name) {
+  if (name == "compact")
+    return VertexLayout::compact();
+  if (name == "lit")
+    return VertexLayout::lit();
+  if (name == "full")
+    return VertexLayout::full();
+  throw std::runtime_error("unknown vertex layout " + name);
+}
+
+static BenchConfig parseArgs(int argc, char **argv) {
+  BenchConfig config;
+  for (int i = 1; i < argc; i++) {
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc)
+        throw std::runtime_error(std::string("missing value for ") + argv[i]);
+      return argv[++i];
+    };
+    auto number = [&]() { return static_cast<uint32_t>(std::atoi(next())); };
+
+    if (std::strcmp(argv[i], "--items") == 0) {
+      config.items = number();
+    } else if (std::strcmp(argv[i], "--meshes") == 0) {
+      config.meshes = std::max(1u, number());
+    } else if (std::strcmp(argv[i], "--mesh-file") == 0) {
+      config.meshFile = next();
+    } else if (std::strcmp(argv[i], "--vertex-layout") == 0) {
+      config.vertexLayout = next();
+    } else if (std::strcmp(argv[i], "--stream-dir") == 0) {
+      config.streamDir = next();
+    } else if (std::strcmp(argv[i], "--region-spacing") == 0) {
+      config.regionSpacing = static_cast<float>(std::atof(next()));
+    } else if (std::strcmp(argv[i], "--budget-mb") == 0) {
+      config.budgetMb = number();
+    } else if (std::strcmp(argv[i], "--frames") == 0) {
+      config.frames = number();
+    } else if (std::strcmp(argv[i], "--warmup") == 0) {
+      config.warmupFrames = number();
+    } else if (std::strcmp(argv[i], "--gpu-frames") == 0) {
+      config.gpuFrames = number();
+    } else if (std::strcmp(argv[i], "--width") == 0) {
+      config.width = number();
+    } else if (std::strcmp(argv[i], "--height") == 0) {
+      config.height = number();
+    } else if (std::strcmp(argv[i], "--frames-in-flight") == 0) {
+      config.framesInFlight = static_cast<int>(std::max(1u, number()));
+    } else if (std::strcmp(argv[i], "--gpu-draw-range") == 0) {
+      config.gpuDrawRange = number();
+    } else if (std::strcmp(argv[i], "--direct") == 0) {
+      config.direct = true;
+    } else if (std::strcmp(argv[i], "--record-threads") == 0) {
+      config.recordThreads = number();
+    } else if (std::strcmp(argv[i], "--job-threads") == 0) {
+      config.jobThreads = number();
+    } else if (std::strcmp(argv[i], "--gpu-cull") == 0) {
+      config.gpuCull = true;
+    } else if (std::strcmp(argv[i], "--occlusion") == 0) {
+      config.occlusion = true;
+    } else if (std::strcmp(argv[i], "--meshlets") == 0) {
+      config.meshlets = true;
+    } else if (std::strcmp(argv[i], "--no-cpu-cull") == 0) {
+      config.noCpuCull = true;
+    } else if (std::strcmp(argv[i], "--lod-threshold") == 0) {
+      config.lodThreshold = static_cast<float>(std::atof(next()));
+    } else if (std::strcmp(argv[i], "--validation") == 0) {
+      config.validation = true;
+    } else if (std::strcmp(argv[i], "--out") == 0) {
+      config.out = next();
+    } else if (std::strcmp(argv[i], "--trace") == 0) {
+      config.trace = next();
+    } else {
+      throw std::runtime_error(std::string("unknown argument ") + argv[i]);
+    }
+  }
+  if (config.meshFile.empty() && config.streamDir.empty() &&
+      parseLayout(config.vertexLayout).has(VertexAttribute::Normal))
+    throw std::runtime_error("--vertex-layout " + config.vertexLayout +
+                             " needs a --mesh-file or --stream-dir");
+  return config;
+}
+
+// Unit cube, tinted per mesh so distinct meshes really hold distinct data
+static void buildCube(uint32_t meshIndex, std::vector<Vertex> &vertices,
+                      std::vector<uint32_t> &indices) {
+  float t = static_cast<float>(meshIndex % 16) / 16.0f;
+  glm::vec3 tint{0.3f + 0.7f * t, 0.5f, 1.0f - 0.7f * t};
+
+  vertices.clear();
+  for (int i = 0; i < 8; i++) {
+    glm::vec3 pos{(i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f,
+                  (i & 4) ? 0.5f : -0.5f};
+    vertices.push_back({pos, tint * (0.6f + 0.4f * (pos.y + 0.5f))});
+  }
+
+  indices = {0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+             2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5};
+}
+
+int main(int argc, char **argv) {
+  try {
+    BenchConfig config = parseArgs(argc, argv);
+    PROFILE_THREAD("bench");
+
+    Instance instance(config.validation, true);
+    Device device(instance, VK_NULL_HANDLE, config.validation);
+    OffscreenTarget offscreen(device, VkExtent2D{config.width, config.height},
+                              config.framesInFlight);
+    Pipeline pipeline(device.getLogical(), offscreen.getColorFormat(),
+                      parseLayout(config.vertexLayout));
+    CommandContext commandContext(device.getPhysical(), device.getLogical(),
+                                  VK_NULL_HANDLE);
+    RenderRecorder recorder(pipeline);
+    Frame frame(device, VK_NULL_HANDLE, config.framesInFlight);
+    // Streamed regions hold any number of submeshes, --items bounds them
+    Renderer renderer(device, nullptr, &offscreen, commandContext, recorder,
+                      frame, std::max(config.items, 1u));
+
+    commandContext.allocate(frame.getMaxFramesInFlight());
+
+    GpuProfiler gpuProfiler(device, frame.getMaxFramesInFlight());
+    renderer.setProfiler(&gpuProfiler);
+    recorder.setDrawRangeSize(config.gpuDrawRange);
+    renderer.setIndirect(!config.direct);
+    renderer.setRecordThreads(config.recordThreads);
+    std::unique_ptr<JobSystem> jobs;
+    if (config.jobThreads > 0) {
+      jobs = std::make_unique<JobSystem>(config.jobThreads);
+      renderer.setJobSystem(jobs.get());
+    }
+    renderer.setGpuCulling(config.gpuCull);
+    renderer.setOcclusionCulling(config.occlusion);
+    renderer.setMeshletCulling(config.meshlets);
+    renderer.setCpuCulling(!config.noCpuCull);
+    renderer.setLodThreshold(config.lodThreshold);
+
+    Camera camera;
+    camera.setPerspective(60.0f,
+                          static_cast<float>(config.width) /
+                              static_cast<float>(config.height),
+                          0.1f, 1000.0f);
+
+    using Clock = std::chrono::steady_clock;
+    auto toMs = [](Clock::duration d) {
+      return std::chrono::duration<double, std::milli>(d).count();
+    };
+
+    // --- Meshes, timed until the copies have landed ---
+    std::vector<std::unique_ptr<Mesh>> meshes;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    auto loadStart = Clock::now();
+    if (!config.streamDir.empty()) {
+      // Regions bring their own meshes
+    } else if (config.meshFile.empty()) {
+      for (uint32_t m = 0; m < config.meshes; m++) {
+        buildCube(m, vertices, indices);
+
+        meshes.push_back(renderer.createMesh(vertices, indices));
+      }
+    } else {
+      meshes = renderer.createMeshes(MeshFile(config.meshFile));
+      if (meshes.empty())
+        throw std::runtime_error(config.meshFile + " has no submeshes");
+    }
+    renderer.getUploadQueue().waitIdle();
+    double meshLoadMs = toMs(Clock::now() - loadStart);
+    uint64_t uploadSubmits = renderer.getUploadQueue().getSubmitCount();
+
+    // --- Items, laid out on a square grid facing the camera ---
+    uint32_t side = static_cast<uint32_t>(
+        std::ceil(std::sqrt(static_cast<double>(config.items))));
+    float spacing = 1.5f;
+    float half = 0.5f * spacing * static_cast<float>(side);
+
+    std::vector<std::unique_ptr<RenderItem>> renderItems;
+    renderItems.reserve(config.items);
+    for (uint32_t i = 0; i < config.items && !meshes.empty(); i++) {
+      auto item = std::make_unique<RenderItem>();
+      item->mesh = meshes[i % meshes.size()].get();
+
+      float x = static_cast<float>(i % side) * spacing - half;
+      float y = static_cast<float>(i / side) * spacing - half;
+      item->transform = glm::translate(glm::mat4(1.0f), {x, y, 0.0f});
+      renderItems.push_back(std::move(item));
+    }
+
+    camera.setPosition({0.0f, 0.0f, half * 1.8f + 2.0f});
+    camera.lookAt({0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f});
+
+    std::vector<RenderItem *> rawPtrs;
+    rawPtrs.reserve(renderItems.size());
+    for (auto &r : renderItems)
+      rawPtrs.push_back(r.get());
+
+    // --- Streaming: one region per file, the camera flies from the first
+    // to the last over all frames and every region is submitted throughout
+    std::unique_ptr<AssetStreamer> streamer;
+    std::vector<MeshAsset *> regions;
+    std::vector<bool> placed;
+    uint64_t peakResident = 0;
+    uint32_t framesOverBudget = 0;
+    if (!config.streamDir.empty()) {
+      std::vector<std::string> paths;
+      for (const auto &entry :
+           std::filesystem::directory_iterator(config.streamDir)) {
+        if (entry.path().extension() == ".mesh")
+          paths.push_back(entry.path().string());
+      }
+      if (paths.empty())
+        throw std::runtime_error(config.streamDir + " has no .mesh files");
+      std::sort(paths.begin(), paths.end());
+
+      streamer = std::make_unique<AssetStreamer>(
+          renderer, config.budgetMb * 1024 * 1024);
+      for (const std::string &path : paths)
+        regions.push_back(streamer->requestMesh(path));
+      placed.assign(regions.size(), false);
+    }
+    uint32_t totalFrames =
+        config.warmupFrames + config.frames + config.gpuFrames;
+    uint32_t frameIndex = 0;
+
+    auto nextFrame = [&]() {
+      if (streamer) {
+        float t = static_cast<float>(frameIndex) /
+                  static_cast<float>(std::max(totalFrames, 2u) - 1);
+        float x = t * config.regionSpacing *
+                  static_cast<float>(regions.size() - 1);
+        camera.setPosition({x, 0.0f, config.regionSpacing * 0.5f});
+        camera.lookAt({x, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f});
+      }
+      frameIndex++;
+      RenderResult result = renderer.drawFrame(rawPtrs, camera);
+      if (!streamer)
+        return result;
+
+      streamer->update();
+      for (size_t r = 0; r < regions.size(); r++) {
+        if (regions[r]->getState() == MeshAsset::State::Failed)
+          throw std::runtime_error(regions[r]->getPath() + ": " +
+                                   regions[r]->getError());
+        if (placed[r] || regions[r]->getMeshes().empty())
+          continue;
+        glm::mat4 transform = glm::translate(
+            glm::mat4(1.0f),
+            {config.regionSpacing * static_cast<float>(r), 0.0f, 0.0f});
+        for (const auto &mesh : regions[r]->getMeshes()) {
+          if (rawPtrs.size() == config.items)
+            throw std::runtime_error("regions hold more than --items items");
+          auto item = std::make_unique<RenderItem>();
+          item->mesh = mesh.get();
+          item->transform = transform;
+          rawPtrs.push_back(item.get());
+          renderItems.push_back(std::move(item));
+        }
+        placed[r] = true;
+      }
+      uint64_t resident = streamer->getResidentBytes();
+      peakResident = std::max(peakResident, resident);
+      if (resident > streamer->getBudget())
+        framesOverBudget++;
+      return result;
+    };
+
+    for (uint32_t f = 0; f < config.warmupFrames; f++)
+      nextFrame();
+
+    // --- Pipelined frames: CPU cost of drawFrame ---
+    std::vector<double> cpuMs;
+    cpuMs.reserve(config.frames);
+    // Per zone name: summed ms over frames, frames seen
+    std::map<std::string, std::pair<double, uint32_t>> gpuZones;
+    auto runStart = Clock::now();
+    for (uint32_t f = 0; f < config.frames; f++) {
+      auto start = Clock::now();
+      if (nextFrame() != RenderResult::Ok)
+        throw std::runtime_error("drawFrame failed");
+      cpuMs.push_back(toMs(Clock::now() - start));
+
+      std::map<std::string, double> frameZones;
+      for (const GpuZone &zone : gpuProfiler.getResults())
+        frameZones[zone.name] += zone.ms;
+      for (const auto &[name, ms] : frameZones) {
+        gpuZones[name].first += ms;
+        gpuZones[name].second++;
+      }
+    }
+    vkDeviceWaitIdle(device.getLogical());
+    double wallMs = toMs(Clock::now() - runStart);
+
+    // --- Serialized frames: submit-to-fence latency ---
+    std::vector<double> gpuMs;
+    gpuMs.reserve(config.gpuFrames);
+    for (uint32_t f = 0; f < config.gpuFrames; f++) {
+      uint32_t slot = renderer.getCurrentFrame();
+      if (nextFrame() != RenderResult::Ok)
+        throw std::runtime_error("drawFrame failed");
+      vkWaitForFences(device.getLogical(), 1, &frame.getInFlightFence(slot),
+                      VK_TRUE, UINT64_MAX);
+      gpuMs.push_back(toMs(Clock::now() - renderer.getLastSubmitTime()));
+    }
+
+    const RenderStats &stats = renderer.getStats();
+
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"items\": " << renderItems.size() << ",\n";
+    json << "  \"meshes\": " << meshes.size() << ",\n";
+    if (streamer) {
+      json << "  \"streaming\": {\"regions\": " << regions.size()
+           << ", \"budgetBytes\": " << streamer->getBudget()
+           << ", \"peakResidentBytes\": " << peakResident
+           << ", \"framesOverBudget\": " << framesOverBudget
+           << ", \"evictions\": " << streamer->getEvictionCount() << "},\n";
+    }
+    json << "  \"vertexLayout\": \"" << config.vertexLayout << "\",\n";
+    json << "  \"vertexStride\": "
+         << pipeline.getVertexLayout().getStride() << ",\n";
+    json << "  \"frames\": " << config.frames << ",\n";
+    json << "  \"width\": " << config.width << ",\n";
+    json << "  \"height\": " << config.height << ",\n";
+    json << "  \"framesInFlight\": " << config.framesInFlight << ",\n";
+    json << "  \"drawPath\": \""
+         << (renderer.isIndirect() ? "indirect" : "direct") << "\",\n";
+    json << "  \"meshLoadMs\": " << meshLoadMs << ",\n";
+    json << "  \"uploadSubmits\": " << uploadSubmits << ",\n";
+    json << "  \"wallMs\": " << wallMs << ",\n";
+    json << "  \"cpuFrameMs\": ";
+    writePercentiles(json, computePercentiles(cpuMs));
+    json << ",\n  \"gpuSubmitToFenceMs\": ";
+    writePercentiles(json, computePercentiles(gpuMs));
+    json << ",\n  \"gpuZonesMs\": {";
+    bool firstZone = true;
+    for (const auto &[name, total] : gpuZones) {
+      json << (firstZone ? "" : ", ") << "\"" << name
+           << "\": " << total.first / total.second;
+      firstZone = false;
+    }
+    json << "}";
+    json << ",\n  \"itemsSubmitted\": " << stats.itemsSubmitted << ",\n";
+    json << "  \"trianglesSubmitted\": " << stats.trianglesSubmitted << ",\n";
+    json << "  \"lodThreshold\": " << renderer.getLodThreshold() << ",\n";
+    json << "  \"drawCalls\": " << stats.drawCalls << ",\n";
+    json << "  \"indirectCalls\": " << stats.indirectCalls << ",\n";
+    json << "  \"gpuCulling\": "
+         << (renderer.isGpuCulling() ? "true" : "false") << ",\n";
+    json << "  \"recordThreads\": " << config.recordThreads << ",\n";
+    json << "  \"jobThreads\": " << config.jobThreads << ",\n";
+    json << "  \"occlusionCulling\": "
+         << (renderer.isOcclusionCulling() ? "true" : "false") << ",\n";
+    json << "  \"meshletCulling\": "
+         << (renderer.isMeshletCulling() ? "true" : "false") << ",\n";
+    json << "  \"cpuCulling\": ";
+    if (renderer.isCpuCulling())
+      json << "\"" << CpuCuller::getPath() << "\",\n";
+    else
+      json << "false,\n";
+    json << "  \"itemsCulled\": " << stats.itemsCulled << ",\n";
+    if (renderer.isGpuCulling())
+      json << "  \"gpuVisible\": " << renderer.getGpuVisibleCount() << ",\n";
+    if (renderer.isMeshletCulling()) {
+      json << "  \"meshletsSubmitted\": " << stats.meshletsSubmitted << ",\n";
+      json << "  \"gpuVisibleMeshlets\": "
+           << renderer.getGpuVisibleMeshletCount() << ",\n";
+    }
+    json << "  \"descriptorWrites\": " << stats.descriptorWrites << ",\n";
+
+    MemoryStats memory = device.getAllocator().getStats();
+    json << "  \"deviceMemory\": {\"blocks\": " << memory.blockCount
+         << ", \"allocations\": " << memory.allocationCount
+         << ", \"reservedBytes\": " << memory.bytesReserved
+         << ", \"usedBytes\": " << memory.bytesUsed << "}\n";
+    json << "}\n";
+
+    if (config.out.empty()) {
+      std::cout << json.str();
+    } else {
+      std::ofstream file(config.out);
+      if (!file)
+        throw std::runtime_error("failed to open " + config.out);
+      file << json.str();
+    }
+
+    if (!config.trace.empty() && !CpuProfiler::dumpChromeTrace(config.trace))
+      throw std::runtime_error("failed to write " + config.trace);
+
+    vkDeviceWaitIdle(device.getLogical());
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,552 @@
+#include "cooker/json.h"
+#include "cooker/sourceMesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+constexpr uint32_t GlbMagic = 0x46546c67; // "glTF"
+constexpr uint32_t GlbJsonChunk = 0x4e4f534a;
+constexpr uint32_t GlbBinChunk = 0x004e4942;
+constexpr int TriangleMode = 4;
+
+struct Gltf {
+  std::string path;
+  JsonValue json;
+  std::vector<std::vector<uint8_t>> buffers;
+};
+
+// Column-major like glTF
+struct Mat4 {
+  float m[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+  Mat4 operator*(const Mat4 &b) const {
+    Mat4 r;
+    for (int c = 0; c < 4; c++)
+      for (int row = 0; row < 4; row++) {
+        float sum = 0.0f;
+        for (int k = 0; k < 4; k++)
+          sum += m[k * 4 + row] * b.m[c * 4 + k];
+        r.m[c * 4 + row] = sum;
+      }
+    return r;
+  }
+};
+
+[[noreturn]] void fail(const Gltf &gltf, const std::string &what) {
+  throw std::runtime_error(gltf.path + ": " + what);
+}
+
+std::vector<uint8_t> readBinary(const std::string &path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file)
+    throw std::runtime_error("failed to open " + path);
+  std::vector<uint8_t> bytes(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(bytes.data()),
+            static_cast<std::streamsize>(bytes.size()));
+  return bytes;
+}
+
+uint32_t readU32(const uint8_t *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+std::vector<uint8_t> decodeBase64(const Gltf &gltf, std::string_view text) {
+  auto digit = [&](char c) -> uint32_t {
+    if (c >= 'A' && c <= 'Z')
+      return c - 'A';
+    if (c >= 'a' && c <= 'z')
+      return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+      return c - '0' + 52;
+    if (c == '+')
+      return 62;
+    if (c == '/')
+      return 63;
+    fail(gltf, "invalid base64 in data URI");
+  };
+
+  std::vector<uint8_t> out;
+  out.reserve(text.size() / 4 * 3);
+  uint32_t bits = 0;
+  int count = 0;
+  for (char c : text) {
+    if (c == '=')
+      break;
+    bits = bits << 6 | digit(c);
+    if (++count == 4) {
+      out.push_back(static_cast<uint8_t>(bits >> 16));
+      out.push_back(static_cast<uint8_t>(bits >> 8));
+      out.push_back(static_cast<uint8_t>(bits));
+      bits = 0;
+      count = 0;
+    }
+  }
+  if (count == 2) {
+    out.push_back(static_cast<uint8_t>(bits >> 4));
+  } else if (count == 3) {
+    out.push_back(static_cast<uint8_t>(bits >> 10));
+    out.push_back(static_cast<uint8_t>(bits >> 2));
+  }
+  return out;
+}
+
+Gltf load(const std::string &path) {
+  Gltf gltf;
+  gltf.path = path;
+  std::vector<uint8_t> file = readBinary(path);
+
+  std::vector<uint8_t> glbBinary;
+  bool glb = file.size() >= 12 && readU32(file.data()) == GlbMagic;
+  if (glb) {
+    // 12-byte header, then chunks of length, type, payload
+    size_t pos = 12;
+    bool haveJson = false;
+    while (pos + 8 <= file.size()) {
+      uint32_t length = readU32(file.data() + pos);
+      uint32_t type = readU32(file.data() + pos + 4);
+      pos += 8;
+      if (length > file.size() - pos)
+        fail(gltf, "truncated GLB chunk");
+      if (type == GlbJsonChunk && !haveJson) {
+        gltf.json = JsonValue::parse(std::string_view(
+            reinterpret_cast<const char *>(file.data() + pos), length));
+        haveJson = true;
+      } else if (type == GlbBinChunk && glbBinary.empty()) {
+        glbBinary.assign(file.begin() + pos, file.begin() + pos + length);
+      }
+      pos += length;
+    }
+    if (!haveJson)
+      fail(gltf, "GLB without a JSON chunk");
+  } else {
+    gltf.json = JsonValue::parse(
+        std::string_view(reinterpret_cast<const char *>(file.data()),
+                         file.size()));
+  }
+
+  std::string directory;
+  size_t slash = path.find_last_of("/\\");
+  if (slash != std::string::npos)
+    directory = path.substr(0, slash + 1);
+
+  const JsonValue &buffers = gltf.json["buffers"];
+  for (size_t i = 0; i < buffers.size(); i++) {
+    const JsonValue &buffer = buffers[i];
+    if (!buffer.has("uri")) {
+      // Only the first buffer of a GLB may live in the BIN chunk
+      if (!glb || i != 0)
+        fail(gltf, "buffer without uri");
+      gltf.buffers.push_back(std::move(glbBinary));
+      continue;
+    }
+
+    const std::string &uri = buffer["uri"].asString();
+    if (uri.rfind("data:", 0) == 0) {
+      size_t comma = uri.find(',');
+      if (comma == std::string::npos ||
+          uri.substr(0, comma).find(";base64") == std::string::npos)
+        fail(gltf, "unsupported data URI");
+      gltf.buffers.push_back(
+          decodeBase64(gltf, std::string_view(uri).substr(comma + 1)));
+    } else {
+      gltf.buffers.push_back(readBinary(directory + uri));
+    }
+
+    auto byteLength = static_cast<size_t>(buffer["byteLength"].asNumber());
+    if (gltf.buffers.back().size() < byteLength)
+      fail(gltf, "buffer shorter than its byteLength");
+  }
+  return gltf;
+}
+
+size_t componentSize(const Gltf &gltf, int componentType) {
+  switch (componentType) {
+  case 5120: // BYTE
+  case 5121: // UNSIGNED_BYTE
+    return 1;
+  case 5122: // SHORT
+  case 5123: // UNSIGNED_SHORT
+    return 2;
+  case 5125: // UNSIGNED_INT
+  case 5126: // FLOAT
+    return 4;
+  }
+  fail(gltf, "unknown component type " + std::to_string(componentType));
+}
+
+int componentCount(const Gltf &gltf, const std::string &type) {
+  if (type == "SCALAR")
+    return 1;
+  if (type == "VEC2")
+    return 2;
+  if (type == "VEC3")
+    return 3;
+  if (type == "VEC4")
+    return 4;
+  fail(gltf, "unsupported accessor type " + type);
+}
+
+// Accessor as count * components doubles; normalized integers map to
+// [0, 1] or [-1, 1], others keep their value
+std::vector<double> readAccessor(const Gltf &gltf, size_t index,
+                                 int &components) {
+  const JsonValue &accessor = gltf.json["accessors"][index];
+  if (accessor.isNull())
+    fail(gltf, "missing accessor " + std::to_string(index));
+  if (accessor.has("sparse"))
+    fail(gltf, "sparse accessors are not supported");
+
+  int type = static_cast<int>(accessor["componentType"].asNumber());
+  components = componentCount(gltf, accessor["type"].asString());
+  bool normalized = accessor["normalized"].asBool();
+  auto count = static_cast<size_t>(accessor["count"].asNumber());
+  size_t elementSize = componentSize(gltf, type) * components;
+
+  std::vector<double> out(count * components, 0.0);
+  // No bufferView means all zeros
+  if (!accessor.has("bufferView"))
+    return out;
+
+  const JsonValue &view = gltf.json["bufferViews"][static_cast<size_t>(
+      accessor["bufferView"].asNumber())];
+  auto bufferIndex = static_cast<size_t>(view["buffer"].asNumber());
+  if (view.isNull() || bufferIndex >= gltf.buffers.size())
+    fail(gltf, "accessor " + std::to_string(index) + " has no buffer");
+  const std::vector<uint8_t> &buffer = gltf.buffers[bufferIndex];
+
+  auto viewOffset = static_cast<size_t>(view["byteOffset"].asNumber());
+  auto viewLength = static_cast<size_t>(view["byteLength"].asNumber());
+  auto offset = static_cast<size_t>(accessor["byteOffset"].asNumber());
+  auto stride = static_cast<size_t>(view["byteStride"].asNumber());
+  if (stride == 0)
+    stride = elementSize;
+  if (viewOffset > buffer.size() || viewLength > buffer.size() - viewOffset ||
+      (count > 0 && offset + (count - 1) * stride + elementSize > viewLength))
+    fail(gltf, "accessor " + std::to_string(index) + " out of bounds");
+
+  const uint8_t *base = buffer.data() + viewOffset + offset;
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t *element = base + i * stride;
+    for (int c = 0; c < components; c++) {
+      double value = 0.0;
+      switch (type) {
+      case 5120: {
+        int8_t v;
+        std::memcpy(&v, element + c, 1);
+        value = normalized ? std::max(v / 127.0, -1.0) : v;
+        break;
+      }
+      case 5121:
+        value = normalized ? element[c] / 255.0 : element[c];
+        break;
+      case 5122: {
+        int16_t v;
+        std::memcpy(&v, element + c * 2, 2);
+        value = normalized ? std::max(v / 32767.0, -1.0) : v;
+        break;
+      }
+      case 5123: {
+        uint16_t v;
+        std::memcpy(&v, element + c * 2, 2);
+        value = normalized ? v / 65535.0 : v;
+        break;
+      }
+      case 5125: {
+        uint32_t v;
+        std::memcpy(&v, element + c * 4, 4);
+        value = v;
+        break;
+      }
+      case 5126: {
+        float v;
+        std::memcpy(&v, element + c * 4, 4);
+        value = v;
+        break;
+      }
+      }
+      out[i * components + c] = value;
+    }
+  }
+  return out;
+}
+
+Mat4 localMatrix(const JsonValue &node) {
+  Mat4 result;
+  const JsonValue &matrix = node["matrix"];
+  if (matrix.size() == 16) {
+    for (size_t i = 0; i < 16; i++)
+      result.m[i] = static_cast<float>(matrix[i].asNumber());
+    return result;
+  }
+
+  const JsonValue &t = node["translation"];
+  const JsonValue &r = node["rotation"];
+  const JsonValue &s = node["scale"];
+  float tx = static_cast<float>(t[size_t{0}].asNumber());
+  float ty = static_cast<float>(t[1].asNumber());
+  float tz = static_cast<float>(t[2].asNumber());
+  float qx = static_cast<float>(r[size_t{0}].asNumber());
+  float qy = static_cast<float>(r[1].asNumber());
+  float qz = static_cast<float>(r[2].asNumber());
+  float qw = static_cast<float>(r[3].asNumber(1.0));
+  float sx = static_cast<float>(s[size_t{0}].asNumber(1.0));
+  float sy = static_cast<float>(s[1].asNumber(1.0));
+  float sz = static_cast<float>(s[2].asNumber(1.0));
+
+  // T * R * S
+  float *m = result.m;
+  m[0] = (1 - 2 * (qy * qy + qz * qz)) * sx;
+  m[1] = (2 * (qx * qy + qz * qw)) * sx;
+  m[2] = (2 * (qx * qz - qy * qw)) * sx;
+  m[4] = (2 * (qx * qy - qz * qw)) * sy;
+  m[5] = (1 - 2 * (qx * qx + qz * qz)) * sy;
+  m[6] = (2 * (qy * qz + qx * qw)) * sy;
+  m[8] = (2 * (qx * qz + qy * qw)) * sz;
+  m[9] = (2 * (qy * qz - qx * qw)) * sz;
+  m[10] = (1 - 2 * (qx * qx + qy * qy)) * sz;
+  m[12] = tx;
+  m[13] = ty;
+  m[14] = tz;
+  return result;
+}
+
+Float3 transformPoint(const Mat4 &m, const Float3 &p) {
+  return {m.m[0] * p[0] + m.m[4] * p[1] + m.m[8] * p[2] + m.m[12],
+          m.m[1] * p[0] + m.m[5] * p[1] + m.m[9] * p[2] + m.m[13],
+          m.m[2] * p[0] + m.m[6] * p[1] + m.m[10] * p[2] + m.m[14]};
+}
+
+float determinant3(const Mat4 &m) {
+  const float *a = m.m;
+  return a[0] * (a[5] * a[10] - a[9] * a[6]) -
+         a[4] * (a[1] * a[10] - a[9] * a[2]) +
+         a[8] * (a[1] * a[6] - a[5] * a[2]);
+}
+
+// Tangents are directions on the surface, they follow the upper 3x3
+Float3 transformDirection(const Mat4 &m, const Float3 &d) {
+  Float3 out{m.m[0] * d[0] + m.m[4] * d[1] + m.m[8] * d[2],
+             m.m[1] * d[0] + m.m[5] * d[1] + m.m[9] * d[2],
+             m.m[2] * d[0] + m.m[6] * d[1] + m.m[10] * d[2]};
+  float length =
+      std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+  if (length > 0.0f)
+    for (float &v : out)
+      v /= length;
+  return out;
+}
+
+// Normals go through the cofactor matrix, the inverse transpose scaled by
+// the determinant; a mirroring transform would turn them inside out
+Float3 transformNormal(const Mat4 &m, const Float3 &n) {
+  auto a = [&](int row, int col) { return m.m[col * 4 + row]; };
+  float c[3][3];
+  for (int row = 0; row < 3; row++)
+    for (int col = 0; col < 3; col++) {
+      int r0 = (row + 1) % 3, r1 = (row + 2) % 3;
+      int c0 = (col + 1) % 3, c1 = (col + 2) % 3;
+      c[row][col] = a(r0, c0) * a(r1, c1) - a(r0, c1) * a(r1, c0);
+    }
+  Float3 out{c[0][0] * n[0] + c[0][1] * n[1] + c[0][2] * n[2],
+             c[1][0] * n[0] + c[1][1] * n[1] + c[1][2] * n[2],
+             c[2][0] * n[0] + c[2][1] * n[1] + c[2][2] * n[2]};
+  float length =
+      std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+  if (determinant3(m) < 0.0f)
+    length = -length;
+  if (length != 0.0f)
+    for (float &v : out)
+      v /= length;
+  return out;
+}
+
+void appendPrimitive(const Gltf &gltf, const JsonValue &primitive,
+                     const Mat4 &world, const std::string &name,
+                     SourceMesh &mesh, bool &anyNormal, bool &anyTangent,
+                     bool &anyUv, bool &anyColor) {
+  int mode = static_cast<int>(primitive["mode"].asNumber(TriangleMode));
+  if (mode != TriangleMode) {
+    std::cerr << gltf.path << ": skipping non-triangle primitive " << name
+              << "\n";
+    return;
+  }
+  const JsonValue &attributes = primitive["attributes"];
+  if (!attributes.has("POSITION"))
+    fail(gltf, name + " has no POSITION");
+
+  int components = 0;
+  std::vector<double> positions = readAccessor(
+      gltf, static_cast<size_t>(attributes["POSITION"].asNumber()),
+      components);
+  if (components != 3)
+    fail(gltf, name + ": POSITION is not VEC3");
+  size_t vertexCount = positions.size() / 3;
+
+  // Optional attributes, resized to vertexCount when present
+  auto optional = [&](const char *semantic, int minComponents,
+                      int &count) -> std::vector<double> {
+    if (!attributes.has(semantic))
+      return {};
+    std::vector<double> values = readAccessor(
+        gltf, static_cast<size_t>(attributes[semantic].asNumber()), count);
+    if (count < minComponents || values.size() / count != vertexCount)
+      fail(gltf, name + ": bad " + semantic);
+    return values;
+  };
+  int normalComponents = 0, tangentComponents = 0, uvComponents = 0,
+      colorComponents = 0;
+  std::vector<double> normals = optional("NORMAL", 3, normalComponents);
+  std::vector<double> tangents = optional("TANGENT", 4, tangentComponents);
+  std::vector<double> uvs = optional("TEXCOORD_0", 2, uvComponents);
+  std::vector<double> colors = optional("COLOR_0", 3, colorComponents);
+
+  std::vector<uint32_t> indices;
+  if (primitive.has("indices")) {
+    int indexComponents = 0;
+    for (double index :
+         readAccessor(gltf, static_cast<size_t>(primitive["indices"].asNumber()),
+                      indexComponents)) {
+      if (index >= static_cast<double>(vertexCount))
+        fail(gltf, name + ": index out of range");
+      indices.push_back(static_cast<uint32_t>(index));
+    }
+  } else {
+    for (uint32_t i = 0; i < vertexCount; i++)
+      indices.push_back(i);
+  }
+  if (indices.size() % 3 != 0)
+    fail(gltf, name + ": index count is not a multiple of 3");
+
+  SourceSubmesh submesh;
+  submesh.name = name;
+  submesh.firstVertex = static_cast<uint32_t>(mesh.positions.size());
+  submesh.vertexCount = static_cast<uint32_t>(vertexCount);
+  submesh.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+  submesh.indexCount = static_cast<uint32_t>(indices.size());
+
+  // A mirroring transform flips the winding and the tangent frame
+  bool flip = determinant3(world) < 0.0f;
+  for (size_t v = 0; v < vertexCount; v++) {
+    Float3 p{static_cast<float>(positions[v * 3]),
+             static_cast<float>(positions[v * 3 + 1]),
+             static_cast<float>(positions[v * 3 + 2])};
+    mesh.positions.push_back(transformPoint(world, p));
+
+    Float3 n{};
+    if (!normals.empty()) {
+      n = transformNormal(
+          world, {static_cast<float>(normals[v * normalComponents]),
+                  static_cast<float>(normals[v * normalComponents + 1]),
+                  static_cast<float>(normals[v * normalComponents + 2])});
+    }
+    mesh.normals.push_back(n);
+
+    Float4 tangent{};
+    if (!tangents.empty()) {
+      const double *src = &tangents[v * tangentComponents];
+      Float3 d = transformDirection(
+          world, {static_cast<float>(src[0]), static_cast<float>(src[1]),
+                  static_cast<float>(src[2])});
+      float sign = (src[3] < 0.0) != flip ? -1.0f : 1.0f;
+      tangent = {d[0], d[1], d[2], sign};
+    }
+    mesh.tangents.push_back(tangent);
+
+    Float2 t{};
+    if (!uvs.empty()) {
+      t = {static_cast<float>(uvs[v * uvComponents]),
+           static_cast<float>(uvs[v * uvComponents + 1])};
+    }
+    mesh.uvs.push_back(t);
+
+    // Alpha, when present, is dropped
+    Float3 c{1.0f, 1.0f, 1.0f};
+    if (!colors.empty()) {
+      c = {static_cast<float>(colors[v * colorComponents]),
+           static_cast<float>(colors[v * colorComponents + 1]),
+           static_cast<float>(colors[v * colorComponents + 2])};
+    }
+    mesh.colors.push_back(c);
+  }
+  anyNormal |= !normals.empty();
+  anyTangent |= !tangents.empty();
+  anyUv |= !uvs.empty();
+  anyColor |= !colors.empty();
+
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    mesh.indices.push_back(indices[i]);
+    mesh.indices.push_back(indices[flip ? i + 2 : i + 1]);
+    mesh.indices.push_back(indices[flip ? i + 1 : i + 2]);
+  }
+  mesh.submeshes.push_back(submesh);
+}
+} // namespace
+
+SourceMesh readGltf(const std::string &path) {
+  Gltf gltf = load(path);
+  const JsonValue &json = gltf.json;
+  const JsonValue &nodes = json["nodes"];
+
+  SourceMesh mesh;
+  bool anyNormal = false, anyTangent = false, anyUv = false,
+       anyColor = false;
+
+  auto appendMesh = [&](size_t meshIndex, const Mat4 &world) {
+    const JsonValue &source = json["meshes"][meshIndex];
+    if (source.isNull())
+      fail(gltf, "missing mesh " + std::to_string(meshIndex));
+    std::string base = source.has("name") ? source["name"].asString()
+                                          : "mesh" + std::to_string(meshIndex);
+    const JsonValue &primitives = source["primitives"];
+    for (size_t p = 0; p < primitives.size(); p++) {
+      appendPrimitive(gltf, primitives[p], world,
+                      base + "/" + std::to_string(p), mesh, anyNormal,
+                      anyTangent, anyUv, anyColor);
+    }
+  };
+
+  // Depth-first over the node tree; the depth bound stops cycles
+  auto visit = [&](auto &self, size_t nodeIndex, const Mat4 &parent,
+                   size_t depth) -> void {
+    const JsonValue &node = nodes[nodeIndex];
+    if (node.isNull() || depth > nodes.size())
+      fail(gltf, "invalid node hierarchy");
+    Mat4 world = parent * localMatrix(node);
+    if (node.has("mesh"))
+      appendMesh(static_cast<size_t>(node["mesh"].asNumber()), world);
+    const JsonValue &children = node["children"];
+    for (size_t c = 0; c < children.size(); c++)
+      self(self, static_cast<size_t>(children[c].asNumber()), world,
+           depth + 1);
+  };
+
+  const JsonValue &scenes = json["scenes"];
+  if (scenes.size() > 0) {
+    const JsonValue &scene =
+        scenes[static_cast<size_t>(json["scene"].asNumber())];
+    const JsonValue &roots = scene["nodes"];
+    for (size_t r = 0; r < roots.size(); r++)
+      visit(visit, static_cast<size_t>(roots[r].asNumber()), Mat4{}, 0);
+  } else {
+    // No scene to place them, take every mesh as is
+    for (size_t m = 0; m < json["meshes"].size(); m++)
+      appendMesh(m, Mat4{});
+  }
+
+  if (!anyNormal)
+    mesh.normals.clear();
+  if (!anyTangent)
+    mesh.tangents.clear();
+  if (!anyUv)
+    mesh.uvs.clear();
+  if (!anyColor)
+    mesh.colors.clear();
+  return mesh;
+}
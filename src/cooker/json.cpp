@@ -0,0 +1,250 @@
+#include "cooker/json.h"
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+const JsonValue NullValue;
+} // namespace
+
+class JsonValue::Parser {
+public:
+  explicit Parser(std::string_view text) : text(text) {}
+
+  JsonValue parseDocument() {
+    JsonValue value = parseValue(0);
+    skipSpace();
+    if (pos != text.size())
+      fail("trailing characters");
+    return value;
+  }
+
+private:
+  // Deeper than any real glTF, keeps hostile input off the stack limit
+  static constexpr int MaxDepth = 256;
+
+  [[noreturn]] void fail(const char *what) const {
+    throw std::runtime_error(std::string("json: ") + what + " at byte " +
+                             std::to_string(pos));
+  }
+
+  void skipSpace() {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' ||
+                                 text[pos] == '\n' || text[pos] == '\r'))
+      pos++;
+  }
+
+  bool consume(std::string_view token) {
+    if (text.substr(pos, token.size()) != token)
+      return false;
+    pos += token.size();
+    return true;
+  }
+
+  JsonValue parseValue(int depth) {
+    if (depth > MaxDepth)
+      fail("nesting too deep");
+    skipSpace();
+    if (pos >= text.size())
+      fail("unexpected end");
+
+    JsonValue value;
+    char c = text[pos];
+    if (c == '{') {
+      value.type = Type::Object;
+      pos++;
+      skipSpace();
+      if (consume("}"))
+        return value;
+      for (;;) {
+        skipSpace();
+        if (pos >= text.size() || text[pos] != '"')
+          fail("expected member name");
+        std::string key = parseString();
+        skipSpace();
+        if (!consume(":"))
+          fail("expected ':'");
+        value.members[std::move(key)] = parseValue(depth + 1);
+        skipSpace();
+        if (consume("}"))
+          return value;
+        if (!consume(","))
+          fail("expected ',' or '}'");
+      }
+    }
+    if (c == '[') {
+      value.type = Type::Array;
+      pos++;
+      skipSpace();
+      if (consume("]"))
+        return value;
+      for (;;) {
+        value.elements.push_back(parseValue(depth + 1));
+        skipSpace();
+        if (consume("]"))
+          return value;
+        if (!consume(","))
+          fail("expected ',' or ']'");
+      }
+    }
+    if (c == '"') {
+      value.type = Type::String;
+      value.string = parseString();
+      return value;
+    }
+    if (consume("true")) {
+      value.type = Type::Bool;
+      value.boolean = true;
+      return value;
+    }
+    if (consume("false")) {
+      value.type = Type::Bool;
+      return value;
+    }
+    if (consume("null"))
+      return value;
+
+    // strtod needs a terminator, numbers are short
+    size_t end = pos;
+    while (end < text.size() &&
+           std::string_view("+-0123456789.eE").find(text[end]) !=
+               std::string_view::npos)
+      end++;
+    std::string digits(text.substr(pos, end - pos));
+    char *parsed = nullptr;
+    value.number = std::strtod(digits.c_str(), &parsed);
+    if (digits.empty() || parsed != digits.c_str() + digits.size())
+      fail("invalid value");
+    value.type = Type::Number;
+    pos = end;
+    return value;
+  }
+
+  std::string parseString() {
+    pos++; // opening quote
+    std::string out;
+    for (;;) {
+      if (pos >= text.size())
+        fail("unterminated string");
+      char c = text[pos++];
+      if (c == '"')
+        return out;
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (pos >= text.size())
+        fail("unterminated escape");
+      char e = text[pos++];
+      switch (e) {
+      case '"':
+      case '\\':
+      case '/':
+        out += e;
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'u':
+        appendUtf8(out, parseCodePoint());
+        break;
+      default:
+        fail("invalid escape");
+      }
+    }
+  }
+
+  uint32_t parseHex4() {
+    if (pos + 4 > text.size())
+      fail("short \\u escape");
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+      char h = text[pos++];
+      value <<= 4;
+      if (h >= '0' && h <= '9')
+        value |= h - '0';
+      else if (h >= 'a' && h <= 'f')
+        value |= h - 'a' + 10;
+      else if (h >= 'A' && h <= 'F')
+        value |= h - 'A' + 10;
+      else
+        fail("invalid \\u escape");
+    }
+    return value;
+  }
+
+  uint32_t parseCodePoint() {
+    uint32_t cp = parseHex4();
+    // Surrogate pair
+    if (cp >= 0xd800 && cp < 0xdc00 && consume("\\u")) {
+      uint32_t low = parseHex4();
+      if (low < 0xdc00 || low >= 0xe000)
+        fail("invalid surrogate pair");
+      cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+    }
+    return cp;
+  }
+
+  static void appendUtf8(std::string &out, uint32_t cp) {
+    auto put = [&](uint32_t byte) { out += static_cast<char>(byte); };
+    if (cp < 0x80) {
+      put(cp);
+    } else if (cp < 0x800) {
+      put(0xc0 | (cp >> 6));
+      put(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+      put(0xe0 | (cp >> 12));
+      put(0x80 | ((cp >> 6) & 0x3f));
+      put(0x80 | (cp & 0x3f));
+    } else {
+      put(0xf0 | (cp >> 18));
+      put(0x80 | ((cp >> 12) & 0x3f));
+      put(0x80 | ((cp >> 6) & 0x3f));
+      put(0x80 | (cp & 0x3f));
+    }
+  }
+
+  std::string_view text;
+  size_t pos = 0;
+};
+
+JsonValue JsonValue::parse(std::string_view text) {
+  return Parser(text).parseDocument();
+}
+
+const JsonValue &JsonValue::operator[](std::string_view key) const {
+  auto it = members.find(key);
+  return it == members.end() ? NullValue : it->second;
+}
+
+const JsonValue &JsonValue::operator[](size_t index) const {
+  return index < elements.size() ? elements[index] : NullValue;
+}
+
+size_t JsonValue::size() const noexcept {
+  return type == Type::Object ? members.size() : elements.size();
+}
+
+bool JsonValue::has(std::string_view key) const {
+  return members.find(key) != members.end();
+}
+
+double JsonValue::asNumber(double fallback) const noexcept {
+  return type == Type::Number ? number : fallback;
+}
+
+bool JsonValue::asBool(bool fallback) const noexcept {
+  return type == Type::Bool ? boolean : fallback;
+}
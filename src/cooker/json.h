@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Just enough JSON for glTF: a DOM of null, bool, number, string, array and
+// object values. Lookups of missing members or elements yield null.
+class JsonValue {
+public:
+  enum class Type { Null, Bool, Number, String, Array, Object };
+
+  // Throws std::runtime_error with the byte offset on malformed input
+  static JsonValue parse(std::string_view text);
+
+  Type getType() const noexcept { return type; }
+  bool isNull() const noexcept { return type == Type::Null; }
+
+  // Member or element, null when absent
+  const JsonValue &operator[](std::string_view key) const;
+  const JsonValue &operator[](size_t index) const;
+  size_t size() const noexcept;
+  bool has(std::string_view key) const;
+
+  // fallback when the value has another type
+  double asNumber(double fallback = 0.0) const noexcept;
+  bool asBool(bool fallback = false) const noexcept;
+  const std::string &asString() const noexcept { return string; }
+
+private:
+  class Parser;
+
+  Type type = Type::Null;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<JsonValue> elements;
+  std::map<std::string, JsonValue, std::less<>> members;
+};
@@ -0,0 +1,329 @@
+#include "cooker/sourceMesh.h"
+#include "renderer/meshFile.h"
+#include "renderer/vertexLayout.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Offline converter from OBJ / glTF to the cooked .mesh container the
+// runtime maps, see renderer/meshFile.h. The layout has to match the one
+// the renderer's pipeline is built with, compact by default. Triangles and
+// vertices are reordered for the GPU unless --no-optimize is given. Each
+// submesh gets up to --lods levels of detail, 1 keeps only the full mesh,
+// and its full level is split into meshlets for cluster culling.
+//   mesh_cooker [--layout compact|lit|full] [--no-optimize] [--lods N]
+//               <input.obj|.gltf|.glb> <output.mesh>
+
+namespace {
+bool parseLayout(const std::string &name, VertexLayout &layout) {
+  if (name == "compact")
+    layout = VertexLayout::compact();
+  else if (name == "lit")
+    layout = VertexLayout::lit();
+  else if (name == "full")
+    layout = VertexLayout::full();
+  else
+    return false;
+  return true;
+}
+
+bool endsWith(const std::string &s, const char *suffix) {
+  size_t n = std::strlen(suffix);
+  if (s.size() < n)
+    return false;
+  for (size_t i = 0; i < n; i++) {
+    if (std::tolower(static_cast<unsigned char>(s[s.size() - n + i])) !=
+        suffix[i])
+      return false;
+  }
+  return true;
+}
+
+// Same box-centered sphere as computeBounds
+MeshFileBounds computeBounds(const SourceMesh &mesh, uint32_t first,
+                             uint32_t count) {
+  MeshFileBounds bounds{};
+  if (count == 0)
+    return bounds;
+
+  Float3 lo = mesh.positions[first];
+  Float3 hi = lo;
+  for (uint32_t v = first; v < first + count; v++) {
+    for (int c = 0; c < 3; c++) {
+      lo[c] = std::min(lo[c], mesh.positions[v][c]);
+      hi[c] = std::max(hi[c], mesh.positions[v][c]);
+    }
+  }
+  for (int c = 0; c < 3; c++) {
+    bounds.center[c] = (lo[c] + hi[c]) * 0.5f;
+    bounds.extents[c] = (hi[c] - lo[c]) * 0.5f;
+  }
+
+  float radiusSq = 0.0f;
+  for (uint32_t v = first; v < first + count; v++) {
+    float d2 = 0.0f;
+    for (int c = 0; c < 3; c++) {
+      float d = mesh.positions[v][c] - bounds.center[c];
+      d2 += d * d;
+    }
+    radiusSq = std::max(radiusSq, d2);
+  }
+  bounds.radius = std::sqrt(radiusSq);
+  return bounds;
+}
+
+uint64_t alignUp(uint64_t value) {
+  uint64_t a = MeshFormat::SectionAlignment;
+  return (value + a - 1) / a * a;
+}
+
+// Encodes every vertex in layout; quantized positions are relative to their
+// submesh's box, the mesh the runtime draws them with
+std::vector<std::byte> encodeVertices(const SourceMesh &mesh,
+                                      const VertexLayout &layout,
+                                      std::span<const MeshFileBounds> bounds) {
+  const uint32_t stride = layout.getStride();
+  std::vector<std::byte> vertices(mesh.positions.size() * stride);
+  VertexEncoder encoder(layout);
+  for (size_t s = 0; s < mesh.submeshes.size(); s++) {
+    const SourceSubmesh &submesh = mesh.submeshes[s];
+    // bounds[0] is the whole mesh
+    if (layout.isPositionQuantized()) {
+      encoder.setPositionBox(
+          makePositionBox(bounds[s + 1].center, bounds[s + 1].extents));
+    }
+    for (uint32_t v = submesh.firstVertex;
+         v < submesh.firstVertex + submesh.vertexCount; v++) {
+      std::byte *out = vertices.data() + size_t{v} * stride;
+      Float3 color = mesh.colors.empty() ? Float3{1.0f, 1.0f, 1.0f}
+                                         : mesh.colors[v];
+      // Position goes before the tangent, which may share its slot
+      encoder.write(out, VertexAttribute::Position, mesh.positions[v].data());
+      encoder.write(out, VertexAttribute::Color, color.data());
+      if (layout.has(VertexAttribute::Normal))
+        encoder.write(out, VertexAttribute::Normal, mesh.normals[v].data());
+      if (layout.has(VertexAttribute::Tangent))
+        encoder.write(out, VertexAttribute::Tangent, mesh.tangents[v].data());
+      if (layout.has(VertexAttribute::Uv)) {
+        Float2 uv = mesh.uvs.empty() ? Float2{} : mesh.uvs[v];
+        encoder.write(out, VertexAttribute::Uv, uv.data());
+      }
+    }
+  }
+  return vertices;
+}
+
+// Appends indices to out as indexSize-byte integers
+void appendIndices(std::vector<std::byte> &out,
+                   std::span<const uint32_t> indices, uint32_t indexSize) {
+  size_t offset = out.size();
+  out.resize(offset + indices.size() * indexSize);
+  for (size_t i = 0; i < indices.size(); i++) {
+    std::byte *dst = out.data() + offset + i * indexSize;
+    if (indexSize == sizeof(uint16_t)) {
+      auto narrow = static_cast<uint16_t>(indices[i]);
+      std::memcpy(dst, &narrow, sizeof(narrow));
+    } else {
+      std::memcpy(dst, &indices[i], sizeof(uint32_t));
+    }
+  }
+}
+
+void writeMesh(SourceMesh &mesh, const VertexLayout &layout,
+               const std::string &path) {
+  if (layout.has(VertexAttribute::Tangent))
+    generateTangents(mesh);
+  else if (layout.has(VertexAttribute::Normal))
+    generateNormals(mesh);
+
+  // Each submesh's indices in the narrowest type its vertex count allows,
+  // the full level followed by the coarser ones
+  std::vector<MeshFileSubmesh> submeshes;
+  std::vector<MeshFileBounds> bounds;
+  std::vector<MeshFileLod> lods;
+  std::vector<Meshlet> meshlets;
+  std::vector<std::byte> indices;
+  uint32_t indexCount = 0;
+  uint32_t shortIndexCount = 0;
+  bounds.push_back(computeBounds(
+      mesh, 0, static_cast<uint32_t>(mesh.positions.size())));
+  for (const SourceSubmesh &source : mesh.submeshes) {
+    MeshFileSubmesh submesh;
+    submesh.firstVertex = source.firstVertex;
+    submesh.vertexCount = source.vertexCount;
+    submesh.indexSize =
+        source.vertexCount <= MeshFormat::MaxShortIndexVertices
+            ? sizeof(uint16_t)
+            : sizeof(uint32_t);
+    // 32-bit indices after an odd number of 16-bit ones need padding
+    indices.resize((indices.size() + submesh.indexSize - 1) /
+                   submesh.indexSize * submesh.indexSize);
+    submesh.indexOffset = static_cast<uint32_t>(indices.size());
+    submesh.firstLod = static_cast<uint32_t>(lods.size());
+
+    auto addLevel = [&](std::span<const uint32_t> levelIndices,
+                        float error) {
+      lods.push_back({submesh.indexCount,
+                      static_cast<uint32_t>(levelIndices.size()), error});
+      appendIndices(indices, levelIndices, submesh.indexSize);
+      submesh.indexCount += static_cast<uint32_t>(levelIndices.size());
+    };
+    addLevel(std::span<const uint32_t>(mesh.indices)
+                 .subspan(source.firstIndex, source.indexCount),
+             0.0f);
+    for (const SourceLod &lod : source.lods)
+      addLevel(lod.indices, lod.error);
+    submesh.lodCount = static_cast<uint32_t>(lods.size()) - submesh.firstLod;
+    // The full level starts the submesh's indices, meshlets need no shift
+    submesh.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+    submesh.meshletCount = static_cast<uint32_t>(source.meshlets.size());
+    meshlets.insert(meshlets.end(), source.meshlets.begin(),
+                    source.meshlets.end());
+
+    indexCount += submesh.indexCount;
+    if (submesh.indexSize == sizeof(uint16_t))
+      shortIndexCount += submesh.indexCount;
+    submeshes.push_back(submesh);
+    bounds.push_back(
+        computeBounds(mesh, source.firstVertex, source.vertexCount));
+  }
+  std::vector<std::byte> vertices = encodeVertices(mesh, layout, bounds);
+
+  MeshFileHeader header;
+  header.vertexStride = layout.getStride();
+  header.shortIndexCount = shortIndexCount;
+  header.vertexCount = static_cast<uint32_t>(mesh.positions.size());
+  header.indexCount = indexCount;
+  header.submeshCount = static_cast<uint32_t>(submeshes.size());
+  header.vertexLayout = layout.getKey();
+  header.lodCount = static_cast<uint32_t>(lods.size());
+  header.meshletCount = static_cast<uint32_t>(meshlets.size());
+
+  uint64_t offset = alignUp(sizeof(MeshFileHeader));
+  auto place = [&](MeshFileSection &section, uint64_t size) {
+    section.offset = offset;
+    section.size = size;
+    offset = alignUp(offset + size);
+  };
+  place(header.vertices, vertices.size());
+  place(header.indices, indices.size());
+  place(header.bounds, bounds.size() * sizeof(MeshFileBounds));
+  place(header.submeshes, submeshes.size() * sizeof(MeshFileSubmesh));
+  place(header.lods, lods.size() * sizeof(MeshFileLod));
+  place(header.meshlets, meshlets.size() * sizeof(Meshlet));
+
+  std::vector<char> file(offset, 0);
+  auto put = [&](const MeshFileSection &section, const void *data) {
+    if (section.size > 0)
+      std::memcpy(file.data() + section.offset, data, section.size);
+  };
+  std::memcpy(file.data(), &header, sizeof(header));
+  put(header.vertices, vertices.data());
+  put(header.indices, indices.data());
+  put(header.bounds, bounds.data());
+  put(header.submeshes, submeshes.data());
+  put(header.lods, lods.data());
+  put(header.meshlets, meshlets.data());
+
+  std::ofstream out(path, std::ios::binary);
+  if (!out)
+    throw std::runtime_error("failed to open " + path);
+  out.write(file.data(), static_cast<std::streamsize>(file.size()));
+  if (!out)
+    throw std::runtime_error("failed to write " + path);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  VertexLayout layout = VertexLayout::compact();
+  bool optimize = true;
+  uint32_t maxLods = 4;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+      if (!parseLayout(argv[++i], layout)) {
+        std::cerr << "unknown layout " << argv[i] << "\n";
+        return EXIT_FAILURE;
+      }
+    } else if (std::strcmp(argv[i], "--no-optimize") == 0) {
+      optimize = false;
+    } else if (std::strcmp(argv[i], "--lods") == 0 && i + 1 < argc) {
+      int lods = std::atoi(argv[++i]);
+      if (lods < 1 || lods > static_cast<int>(MeshFormat::MaxLods)) {
+        std::cerr << "--lods takes 1 to " << MeshFormat::MaxLods << "\n";
+        return EXIT_FAILURE;
+      }
+      maxLods = static_cast<uint32_t>(lods);
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.size() != 2) {
+    std::cerr << "usage: mesh_cooker [--layout compact|lit|full] "
+                 "[--no-optimize] [--lods N]\n"
+                 "                   <input.obj|.gltf|.glb> <output.mesh>\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    const std::string &input = paths[0];
+    SourceMesh mesh;
+    if (endsWith(input, ".obj"))
+      mesh = readObj(input);
+    else if (endsWith(input, ".gltf") || endsWith(input, ".glb"))
+      mesh = readGltf(input);
+    else
+      throw std::runtime_error("unknown input format: " + input);
+
+    if (mesh.submeshes.empty())
+      throw std::runtime_error(input + " contains no triangles");
+
+    MeshOptimizeStats stats;
+    if (optimize)
+      stats = optimizeMesh(mesh);
+    uint32_t lodCount = generateLods(mesh, maxLods);
+    size_t meshletCount = generateMeshlets(mesh);
+
+    writeMesh(mesh, layout, paths[1]);
+    std::cout << paths[1] << ": " << mesh.submeshes.size() << " submeshes, "
+              << mesh.positions.size() << " vertices, "
+              << mesh.indices.size() / 3 << " triangles, "
+              << layout.getStride() << " bytes per vertex, "
+              << meshletCount << " meshlets\n";
+    if (optimize) {
+      // Cache misses per triangle and per vertex, lower is better
+      std::cout << std::fixed << std::setprecision(3)
+                << "vertex cache ACMR " << stats.before.getAcmr() << " -> "
+                << stats.after.getAcmr() << ", ATVR "
+                << stats.before.getAtvr() << " -> " << stats.after.getAtvr()
+                << " (" << VertexCacheSize << " entry FIFO)\n";
+    }
+    // Triangles over all submeshes and the largest object-space error
+    for (uint32_t level = 1; level < lodCount; level++) {
+      size_t triangles = 0;
+      float error = 0.0f;
+      for (const SourceSubmesh &submesh : mesh.submeshes) {
+        if (level > submesh.lods.size())
+          continue;
+        const SourceLod &lod = submesh.lods[level - 1];
+        triangles += lod.indices.size() / 3;
+        error = std::max(error, lod.error);
+      }
+      std::cout << std::defaultfloat << "lod " << level << ": " << triangles
+                << " triangles, error " << error << "\n";
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
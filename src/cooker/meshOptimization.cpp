@@ -0,0 +1,55 @@
+#include "cooker/sourceMesh.h"
+
+namespace {
+// Applies a submesh-local remap to one attribute array, if present
+template <typename T>
+void remapAttribute(std::vector<T> &attribute, const SourceSubmesh &submesh,
+                    std::span<const uint32_t> remap) {
+  if (attribute.empty())
+    return;
+  remapVertices(std::span<T>(attribute).subspan(submesh.firstVertex,
+                                                submesh.vertexCount),
+                remap);
+}
+} // namespace
+
+MeshOptimizeStats optimizeMesh(SourceMesh &mesh) {
+  MeshOptimizeStats stats;
+  for (const SourceSubmesh &submesh : mesh.submeshes) {
+    if (submesh.indexCount == 0)
+      continue;
+    std::span<uint32_t> indices = std::span<uint32_t>(mesh.indices).subspan(
+        submesh.firstIndex, submesh.indexCount);
+    stats.before += analyzeVertexCache(indices, submesh.vertexCount);
+
+    optimizeVertexCache(indices, submesh.vertexCount);
+    optimizeOverdraw(indices, mesh.positions[submesh.firstVertex].data(),
+                     sizeof(Float3), submesh.vertexCount);
+    std::vector<uint32_t> remap =
+        optimizeVertexFetch(indices, submesh.vertexCount);
+    remapAttribute(mesh.positions, submesh, remap);
+    remapAttribute(mesh.normals, submesh, remap);
+    remapAttribute(mesh.tangents, submesh, remap);
+    remapAttribute(mesh.uvs, submesh, remap);
+    remapAttribute(mesh.colors, submesh, remap);
+
+    stats.after += analyzeVertexCache(indices, submesh.vertexCount);
+  }
+  return stats;
+}
+
+size_t generateMeshlets(SourceMesh &mesh) {
+  size_t count = 0;
+  for (SourceSubmesh &submesh : mesh.submeshes) {
+    submesh.meshlets.clear();
+    if (submesh.indexCount == 0)
+      continue;
+    submesh.meshlets = buildMeshlets(
+        std::span<const uint32_t>(mesh.indices)
+            .subspan(submesh.firstIndex, submesh.indexCount),
+        mesh.positions[submesh.firstVertex].data(), sizeof(Float3),
+        submesh.vertexCount);
+    count += submesh.meshlets.size();
+  }
+  return count;
+}
@@ -0,0 +1,161 @@
+#include "cooker/sourceMesh.h"
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+struct ObjData {
+  std::vector<Float3> positions;
+  std::vector<Float3> colors;
+  std::vector<Float3> normals;
+  std::vector<Float2> uvs;
+};
+
+// Resolves a 1-based or negative (relative to the end) OBJ index
+uint32_t resolveIndex(long index, size_t count, const std::string &path,
+                      int line) {
+  long resolved = index > 0 ? index - 1 : static_cast<long>(count) + index;
+  if (index == 0 || resolved < 0 || static_cast<size_t>(resolved) >= count)
+    throw std::runtime_error(path + ":" + std::to_string(line) +
+                             ": index out of range");
+  return static_cast<uint32_t>(resolved);
+}
+} // namespace
+
+SourceMesh readObj(const std::string &path) {
+  std::ifstream file(path);
+  if (!file)
+    throw std::runtime_error("failed to open " + path);
+
+  ObjData obj;
+  SourceMesh mesh;
+  bool anyColor = false;
+  bool anyNormal = false;
+  bool anyUv = false;
+
+  // Deduplicates position/uv/normal triples inside the current submesh,
+  // -1 marks an absent attribute
+  using Key = std::tuple<long, long, long>;
+  std::map<Key, uint32_t> vertexIds;
+  std::vector<Key> submeshKeys;
+
+  std::string name = "default";
+  auto closeSubmesh = [&]() {
+    SourceSubmesh submesh;
+    submesh.name = name;
+    submesh.firstVertex = mesh.submeshes.empty()
+                              ? 0
+                              : mesh.submeshes.back().firstVertex +
+                                    mesh.submeshes.back().vertexCount;
+    submesh.firstIndex = mesh.submeshes.empty()
+                             ? 0
+                             : mesh.submeshes.back().firstIndex +
+                                   mesh.submeshes.back().indexCount;
+    submesh.vertexCount =
+        static_cast<uint32_t>(mesh.positions.size()) - submesh.firstVertex;
+    submesh.indexCount =
+        static_cast<uint32_t>(mesh.indices.size()) - submesh.firstIndex;
+    if (submesh.indexCount > 0)
+      mesh.submeshes.push_back(submesh);
+    vertexIds.clear();
+  };
+
+  std::string text;
+  int lineNumber = 0;
+  std::vector<uint32_t> polygon;
+  while (std::getline(file, text)) {
+    lineNumber++;
+    std::istringstream line(text);
+    std::string tag;
+    if (!(line >> tag) || tag[0] == '#')
+      continue;
+
+    if (tag == "v") {
+      Float3 p{}, c{1.0f, 1.0f, 1.0f};
+      line >> p[0] >> p[1] >> p[2];
+      // Common extension: v x y z r g b
+      if (line >> c[0] >> c[1] >> c[2])
+        anyColor = true;
+      obj.positions.push_back(p);
+      obj.colors.push_back(c);
+    } else if (tag == "vn") {
+      Float3 n{};
+      line >> n[0] >> n[1] >> n[2];
+      obj.normals.push_back(n);
+    } else if (tag == "vt") {
+      Float2 t{};
+      line >> t[0] >> t[1];
+      obj.uvs.push_back(t);
+    } else if (tag == "o" || tag == "g" || tag == "usemtl") {
+      closeSubmesh();
+      std::getline(line >> std::ws, name);
+    } else if (tag == "f") {
+      polygon.clear();
+      std::string corner;
+      while (line >> corner) {
+        // v, v/vt, v//vn or v/vt/vn
+        long v = 0, vt = 0, vn = 0;
+        const char *s = corner.c_str();
+        char *end;
+        v = std::strtol(s, &end, 10);
+        if (*end == '/') {
+          s = end + 1;
+          if (*s != '/')
+            vt = std::strtol(s, &end, 10);
+          else
+            end = const_cast<char *>(s);
+          if (*end == '/')
+            vn = std::strtol(end + 1, &end, 10);
+        }
+
+        Key key{static_cast<long>(
+                    resolveIndex(v, obj.positions.size(), path, lineNumber)),
+                vt ? static_cast<long>(
+                         resolveIndex(vt, obj.uvs.size(), path, lineNumber))
+                   : -1,
+                vn ? static_cast<long>(resolveIndex(vn, obj.normals.size(),
+                                                    path, lineNumber))
+                   : -1};
+
+        auto [it, inserted] = vertexIds.try_emplace(
+            key, static_cast<uint32_t>(mesh.positions.size()));
+        if (inserted) {
+          auto [pi, ti, ni] = key;
+          mesh.positions.push_back(obj.positions[pi]);
+          mesh.colors.push_back(obj.colors[pi]);
+          mesh.uvs.push_back(ti >= 0 ? obj.uvs[ti] : Float2{});
+          mesh.normals.push_back(ni >= 0 ? obj.normals[ni] : Float3{});
+          anyUv |= ti >= 0;
+          anyNormal |= ni >= 0;
+        }
+        polygon.push_back(it->second);
+      }
+      if (polygon.size() < 3)
+        throw std::runtime_error(path + ":" + std::to_string(lineNumber) +
+                                 ": face with fewer than 3 corners");
+
+      uint32_t base = mesh.submeshes.empty()
+                          ? 0
+                          : mesh.submeshes.back().firstVertex +
+                                mesh.submeshes.back().vertexCount;
+      for (size_t i = 1; i + 1 < polygon.size(); i++) {
+        mesh.indices.push_back(polygon[0] - base);
+        mesh.indices.push_back(polygon[i] - base);
+        mesh.indices.push_back(polygon[i + 1] - base);
+      }
+    }
+    // mtllib, s, l, p and the rest carry nothing the cooker uses
+  }
+  closeSubmesh();
+
+  if (!anyColor)
+    mesh.colors.clear();
+  if (!anyNormal)
+    mesh.normals.clear();
+  if (!anyUv)
+    mesh.uvs.clear();
+  return mesh;
+}
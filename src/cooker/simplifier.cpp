@@ -0,0 +1,442 @@
+#include "cooker/sourceMesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+// Border planes weigh more than faces, so open edges keep their outline
+constexpr double BorderWeight = 10.0;
+// A collapse may tilt no remaining triangle further than this, as the
+// cosine between its normals before and after
+constexpr double MinNormalCosine = 0.25;
+// Each LOD aims at this fraction of the previous one's triangles
+constexpr float LodReduction = 0.5f;
+// Levels that keep more of the previous one than this are not worth it
+constexpr float MinLodReduction = 0.8f;
+constexpr uint32_t MinLodTriangles = 16;
+
+using Vec3d = std::array<double, 3>;
+
+Vec3d toVec3d(const Float3 &p) { return {p[0], p[1], p[2]}; }
+
+Vec3d sub(const Vec3d &a, const Vec3d &b) {
+  return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+Vec3d cross(const Vec3d &a, const Vec3d &b) {
+  return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2],
+          a[0] * b[1] - a[1] * b[0]};
+}
+
+double dot(const Vec3d &a, const Vec3d &b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Sum of weighted squared distances to a set of planes: for a plane n.p + d
+// the error at p is (n.p + d)^2, expanded into p'Ap + 2b.p + c
+struct Quadric {
+  double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+  double b0 = 0, b1 = 0, b2 = 0;
+  double c = 0;
+  double weight = 0;
+
+  void addPlane(const Vec3d &n, double d, double w) {
+    a00 += w * n[0] * n[0];
+    a11 += w * n[1] * n[1];
+    a22 += w * n[2] * n[2];
+    a01 += w * n[0] * n[1];
+    a02 += w * n[0] * n[2];
+    a12 += w * n[1] * n[2];
+    b0 += w * n[0] * d;
+    b1 += w * n[1] * d;
+    b2 += w * n[2] * d;
+    c += w * d * d;
+    weight += w;
+  }
+
+  Quadric &operator+=(const Quadric &q) {
+    a00 += q.a00, a11 += q.a11, a22 += q.a22;
+    a01 += q.a01, a02 += q.a02, a12 += q.a12;
+    b0 += q.b0, b1 += q.b1, b2 += q.b2;
+    c += q.c;
+    weight += q.weight;
+    return *this;
+  }
+
+  double evaluate(const Vec3d &p) const {
+    double x = p[0], y = p[1], z = p[2];
+    double e = a00 * x * x + a11 * y * y + a22 * z * z +
+               2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+               2 * (b0 * x + b1 * y + b2 * z) + c;
+    return std::max(e, 0.0);
+  }
+};
+
+enum class VertexKind : uint8_t {
+  // Interior of a manifold surface, collapses towards any neighbour
+  Manifold,
+  // On an open edge, only collapses along it
+  Border,
+  // Seams, non-manifold edges and the like, never moves
+  Locked,
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b) {
+  return (uint64_t{std::min(a, b)} << 32) | std::max(a, b);
+}
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+// Vertices sharing a position with another one sit on an attribute seam;
+// moving one without the others would tear the surface
+std::vector<bool> findSeams(std::span<const Float3> positions) {
+  std::unordered_map<uint64_t, uint32_t> firstAt;
+  std::vector<uint32_t> canonical(positions.size());
+  std::vector<uint32_t> wedges(positions.size(), 0);
+  for (uint32_t v = 0; v < positions.size(); v++) {
+    uint32_t bits[3];
+    std::memcpy(bits, positions[v].data(), sizeof(bits));
+    uint64_t hash = (uint64_t{bits[0]} * 73856093u) ^
+                    (uint64_t{bits[1]} * 19349663u) ^
+                    (uint64_t{bits[2]} * 83492791u);
+    // Probe past collisions of different positions
+    for (;;) {
+      auto [it, inserted] = firstAt.try_emplace(hash, v);
+      if (inserted || positions[it->second] == positions[v]) {
+        canonical[v] = it->second;
+        break;
+      }
+      hash++;
+    }
+    wedges[canonical[v]]++;
+  }
+
+  std::vector<bool> seam(positions.size());
+  for (uint32_t v = 0; v < positions.size(); v++)
+    seam[v] = wedges[canonical[v]] > 1;
+  return seam;
+}
+
+class Simplifier {
+public:
+  Simplifier(std::span<const Float3> positions,
+             std::span<const uint32_t> indices)
+      : positions(positions), indices(indices.begin(), indices.end()),
+        seams(findSeams(positions)) {
+    // Quadrics come from the full mesh, so every level measures its error
+    // against the original surface
+    quadrics.assign(positions.size(), Quadric{});
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+      Vec3d p0 = position(indices[i]);
+      Vec3d n = cross(sub(position(indices[i + 1]), p0),
+                      sub(position(indices[i + 2]), p0));
+      double length = std::sqrt(dot(n, n));
+      if (length == 0.0)
+        continue;
+      for (double &x : n)
+        x /= length;
+      double area = length * 0.5;
+      for (int k = 0; k < 3; k++)
+        quadrics[indices[i + k]].addPlane(n, -dot(n, p0), area);
+    }
+    addBorderPlanes();
+  }
+
+  // Collapses edges until at most targetIndexCount indices are left or
+  // nothing can go. Returns the largest collapse error, as a distance.
+  double simplify(uint32_t targetIndexCount) {
+    double maxCost = 0.0;
+    while (indices.size() > targetIndexCount) {
+      uint32_t collapsed = runPass(targetIndexCount, maxCost);
+      if (collapsed == 0)
+        break;
+    }
+    return std::sqrt(maxCost);
+  }
+
+  const std::vector<uint32_t> &getIndices() const { return indices; }
+
+private:
+  Vec3d position(uint32_t v) const { return toVec3d(positions[v]); }
+
+  void addBorderPlanes() {
+    std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+      for (int k = 0; k < 3; k++)
+        edgeTriangles[edgeKey(indices[i + k], indices[i + (k + 1) % 3])]++;
+    }
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+      Vec3d p0 = position(indices[i]);
+      Vec3d n = cross(sub(position(indices[i + 1]), p0),
+                      sub(position(indices[i + 2]), p0));
+      for (int k = 0; k < 3; k++) {
+        uint32_t a = indices[i + k];
+        uint32_t b = indices[i + (k + 1) % 3];
+        if (edgeTriangles[edgeKey(a, b)] != 1)
+          continue;
+        // Plane through the edge, perpendicular to its triangle
+        Vec3d edge = sub(position(b), position(a));
+        Vec3d normal = cross(edge, n);
+        double length = std::sqrt(dot(normal, normal));
+        if (length == 0.0)
+          continue;
+        for (double &x : normal)
+          x /= length;
+        double d = -dot(normal, position(a));
+        double w = dot(edge, edge) * BorderWeight;
+        quadrics[a].addPlane(normal, d, w);
+        quadrics[b].addPlane(normal, d, w);
+      }
+    }
+  }
+
+  // One round of independent collapses, cheapest first. Returns how many
+  // were applied.
+  uint32_t runPass(uint32_t targetIndexCount, double &maxCost) {
+    const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+    // Triangles around each vertex
+    std::vector<uint32_t> first(vertexCount + 1, 0);
+    for (uint32_t index : indices)
+      first[index + 1]++;
+    for (uint32_t v = 0; v < vertexCount; v++)
+      first[v + 1] += first[v];
+    std::vector<uint32_t> around(indices.size());
+    {
+      std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+      for (uint32_t i = 0; i < indices.size(); i++)
+        around[fill[indices[i]]++] = i / 3;
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+    edgeTriangles.reserve(indices.size());
+    for (uint32_t i = 0; i < indices.size(); i += 3) {
+      for (int k = 0; k < 3; k++)
+        edgeTriangles[edgeKey(indices[i + k], indices[i + (k + 1) % 3])]++;
+    }
+
+    std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+    std::vector<uint8_t> borderEdges(vertexCount, 0);
+    for (auto [key, count] : edgeTriangles) {
+      auto a = static_cast<uint32_t>(key >> 32);
+      auto b = static_cast<uint32_t>(key);
+      if (count > 2) {
+        kinds[a] = kinds[b] = VertexKind::Locked;
+      } else if (count == 1) {
+        borderEdges[a]++;
+        borderEdges[b]++;
+      }
+    }
+    for (uint32_t v = 0; v < vertexCount; v++) {
+      // A border vertex on more than one open loop is pinched
+      if (seams[v] || borderEdges[v] > 2)
+        kinds[v] = VertexKind::Locked;
+      else if (kinds[v] == VertexKind::Manifold && borderEdges[v] > 0)
+        kinds[v] = VertexKind::Border;
+    }
+
+    std::vector<Collapse> collapses;
+    collapses.reserve(edgeTriangles.size());
+    for (auto [key, count] : edgeTriangles) {
+      auto a = static_cast<uint32_t>(key >> 32);
+      auto b = static_cast<uint32_t>(key);
+      bool border = count == 1;
+      Collapse best{0, 0, -1.0};
+      for (auto [from, to] : {std::pair{a, b}, std::pair{b, a}}) {
+        if (!canCollapse(kinds[from], border))
+          continue;
+        Quadric q = quadrics[from];
+        q += quadrics[to];
+        double cost =
+            q.weight > 0.0 ? q.evaluate(position(to)) / q.weight : 0.0;
+        if (best.cost < 0.0 || cost < best.cost)
+          best = {from, to, cost};
+      }
+      if (best.cost >= 0.0)
+        collapses.push_back(best);
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse &x, const Collapse &y) {
+                return x.cost < y.cost;
+              });
+
+    // Interior collapses remove two triangles, border ones one
+    uint32_t trianglesToRemove =
+        triangleCount - std::min(triangleCount, targetIndexCount / 3);
+    std::vector<uint32_t> remap(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++)
+      remap[v] = v;
+    std::vector<bool> touched(vertexCount, false);
+    uint32_t removed = 0;
+    uint32_t applied = 0;
+
+    for (const Collapse &collapse : collapses) {
+      if (removed >= trianglesToRemove)
+        break;
+      if (touched[collapse.from] || touched[collapse.to])
+        continue;
+      std::span<const uint32_t> triangles(&around[first[collapse.from]],
+                                          first[collapse.from + 1] -
+                                              first[collapse.from]);
+      if (!isTopologyKept(collapse, triangles, around, first) ||
+          flipsTriangle(collapse, triangles))
+        continue;
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      maxCost = std::max(maxCost, collapse.cost);
+      // Everything whose triangles changed waits for the next pass
+      for (uint32_t t : triangles) {
+        for (int k = 0; k < 3; k++)
+          touched[indices[t * 3 + k]] = true;
+      }
+      for (uint32_t t : triangles) {
+        const uint32_t *tri = &indices[t * 3];
+        if (tri[0] == collapse.to || tri[1] == collapse.to ||
+            tri[2] == collapse.to)
+          removed++;
+      }
+      applied++;
+    }
+
+    // Drop the triangles that collapsed to an edge
+    std::vector<uint32_t> next;
+    next.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+      uint32_t a = remap[indices[i]];
+      uint32_t b = remap[indices[i + 1]];
+      uint32_t c = remap[indices[i + 2]];
+      if (a != b && b != c && a != c)
+        next.insert(next.end(), {a, b, c});
+    }
+    indices.swap(next);
+    return applied;
+  }
+
+  static bool canCollapse(VertexKind kind, bool borderEdge) {
+    switch (kind) {
+    case VertexKind::Manifold:
+      return !borderEdge;
+    case VertexKind::Border:
+      return borderEdge;
+    case VertexKind::Locked:
+      return false;
+    }
+    return false;
+  }
+
+  // The link condition: the edge's endpoints share exactly the vertices
+  // opposite it, otherwise the collapse pinches the surface
+  bool isTopologyKept(const Collapse &collapse,
+                      std::span<const uint32_t> fromTriangles,
+                      const std::vector<uint32_t> &around,
+                      const std::vector<uint32_t> &first) const {
+    std::vector<uint32_t> fromNeighbours;
+    uint32_t opposite = 0;
+    for (uint32_t t : fromTriangles) {
+      const uint32_t *tri = &indices[t * 3];
+      bool onEdge = tri[0] == collapse.to || tri[1] == collapse.to ||
+                    tri[2] == collapse.to;
+      opposite += onEdge;
+      for (int k = 0; k < 3; k++) {
+        if (tri[k] != collapse.from && tri[k] != collapse.to)
+          fromNeighbours.push_back(tri[k]);
+      }
+    }
+    std::sort(fromNeighbours.begin(), fromNeighbours.end());
+    fromNeighbours.erase(
+        std::unique(fromNeighbours.begin(), fromNeighbours.end()),
+        fromNeighbours.end());
+
+    std::vector<uint32_t> shared;
+    for (uint32_t i = first[collapse.to]; i < first[collapse.to + 1]; i++) {
+      const uint32_t *tri = &indices[around[i] * 3];
+      for (int k = 0; k < 3; k++) {
+        if (tri[k] != collapse.to &&
+            std::binary_search(fromNeighbours.begin(), fromNeighbours.end(),
+                               tri[k]))
+          shared.push_back(tri[k]);
+      }
+    }
+    std::sort(shared.begin(), shared.end());
+    shared.erase(std::unique(shared.begin(), shared.end()), shared.end());
+    return shared.size() == opposite;
+  }
+
+  // Whether moving collapse.from onto collapse.to turns over, or squashes
+  // flat, a triangle that survives it
+  bool flipsTriangle(const Collapse &collapse,
+                     std::span<const uint32_t> fromTriangles) const {
+    Vec3d target = position(collapse.to);
+    for (uint32_t t : fromTriangles) {
+      const uint32_t *tri = &indices[t * 3];
+      if (tri[0] == collapse.to || tri[1] == collapse.to ||
+          tri[2] == collapse.to)
+        continue;
+      Vec3d p[3];
+      Vec3d q[3];
+      for (int k = 0; k < 3; k++) {
+        p[k] = position(tri[k]);
+        q[k] = tri[k] == collapse.from ? target : p[k];
+      }
+      Vec3d before = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+      Vec3d after = cross(sub(q[1], q[0]), sub(q[2], q[0]));
+      double d = dot(before, after);
+      if (d <= MinNormalCosine * std::sqrt(dot(before, before) *
+                                           dot(after, after)))
+        return true;
+    }
+    return false;
+  }
+
+  std::span<const Float3> positions;
+  std::vector<uint32_t> indices;
+  std::vector<bool> seams;
+  std::vector<Quadric> quadrics;
+};
+} // namespace
+
+std::vector<uint32_t> simplifyIndices(std::span<const uint32_t> indices,
+                                      std::span<const Float3> positions,
+                                      uint32_t targetIndexCount,
+                                      float &error) {
+  Simplifier simplifier(positions, indices);
+  error = static_cast<float>(simplifier.simplify(targetIndexCount));
+  return simplifier.getIndices();
+}
+
+uint32_t generateLods(SourceMesh &mesh, uint32_t maxLods) {
+  uint32_t levels = 1;
+  for (SourceSubmesh &submesh : mesh.submeshes) {
+    submesh.lods.clear();
+    if (submesh.indexCount == 0)
+      continue;
+    std::span<const uint32_t> full(&mesh.indices[submesh.firstIndex],
+                                   submesh.indexCount);
+    std::span<const Float3> positions(&mesh.positions[submesh.firstVertex],
+                                      submesh.vertexCount);
+
+    uint32_t previous = submesh.indexCount;
+    while (submesh.lods.size() + 1 < maxLods &&
+           previous / 3 >= MinLodTriangles * 2) {
+      auto target = static_cast<uint32_t>(previous / 3 * LodReduction) * 3;
+      SourceLod lod;
+      // From the full mesh every time, so errors are not compounded
+      lod.indices = simplifyIndices(full, positions, target, lod.error);
+      if (lod.indices.size() / 3 < MinLodTriangles ||
+          lod.indices.size() > previous * MinLodReduction)
+        break;
+      optimizeVertexCache(lod.indices, submesh.vertexCount);
+      previous = static_cast<uint32_t>(lod.indices.size());
+      submesh.lods.push_back(std::move(lod));
+    }
+    levels = std::max(levels, static_cast<uint32_t>(submesh.lods.size()) + 1);
+  }
+  return levels;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "renderer/meshOptimizer.h"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+using Float2 = std::array<float, 2>;
+using Float3 = std::array<float, 3>;
+// Tangent xyz and the bitangent sign in w
+using Float4 = std::array<float, 4>;
+
+// Coarser index buffer over the same vertices as its submesh
+struct SourceLod {
+  // Local to the submesh's first vertex, like the full indices
+  std::vector<uint32_t> indices;
+  // Object-space distance the level may stray from the full submesh
+  float error = 0.0f;
+};
+
+struct SourceSubmesh {
+  std::string name;
+  uint32_t firstVertex = 0;
+  uint32_t vertexCount = 0;
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  // Levels below the full one, finest first; filled by generateLods
+  std::vector<SourceLod> lods;
+  // Clusters of the full level, filled by generateMeshlets
+  std::vector<Meshlet> meshlets;
+};
+
+// Triangle mesh as read from an interchange file, before cooking. positions
+// has one entry per vertex; the other attributes are either empty or as
+// long as positions. Indices are local to their submesh's first vertex.
+struct SourceMesh {
+  std::vector<Float3> positions;
+  std::vector<Float3> normals;
+  std::vector<Float4> tangents;
+  std::vector<Float2> uvs;
+  std::vector<Float3> colors;
+  std::vector<uint32_t> indices;
+  std::vector<SourceSubmesh> submeshes;
+};
+
+// Wavefront OBJ. o, g and usemtl start a new submesh; polygons are fanned
+// into triangles. Throws on malformed input.
+SourceMesh readObj(const std::string &path);
+
+// glTF 2.0, .gltf with external or data URI buffers and binary .glb. Every
+// triangle primitive of every mesh instance in the default scene becomes a
+// submesh, baked into world space. Throws on malformed input.
+SourceMesh readGltf(const std::string &path);
+
+// Area-weighted smooth normals for vertices that come without one (all
+// zero)
+void generateNormals(SourceMesh &mesh);
+// Tangents along the UV u direction, orthogonal to the normals, with the
+// handedness of the UV mapping; an arbitrary orthogonal frame where there
+// are no usable UVs. Like generateNormals, only fills in missing ones, and
+// generates missing normals first.
+void generateTangents(SourceMesh &mesh);
+
+struct MeshOptimizeStats {
+  VertexCacheStats before;
+  VertexCacheStats after;
+};
+
+// Reorders each submesh's triangles for the post-transform vertex cache and
+// then for overdraw, and its vertices for fetch locality; every attribute
+// moves with them. Returns the vertex cache statistics over all submeshes.
+MeshOptimizeStats optimizeMesh(SourceMesh &mesh);
+
+// Quadric error edge collapse (Garland and Heckbert) down to about
+// targetIndexCount indices, keeping the vertices: every collapse moves a
+// vertex onto a neighbour. Vertices on attribute seams stay put and open
+// borders only collapse along themselves. error receives the largest
+// object-space deviation from the input surface.
+std::vector<uint32_t> simplifyIndices(std::span<const uint32_t> indices,
+                                      std::span<const Float3> positions,
+                                      uint32_t targetIndexCount, float &error);
+
+// Fills each submesh's lods with up to maxLods - 1 levels, each with about
+// half the triangles of the one before, and optimizes them for the vertex
+// cache. Stops early once a level no longer pays off. Returns the most
+// levels any submesh has, the full one included.
+uint32_t generateLods(SourceMesh &mesh, uint32_t maxLods);
+
+// Splits each submesh's full level into meshlets for cluster culling.
+// Leaves the indices alone, so it may run before or after generateLods but
+// after optimizeMesh. Returns the meshlet count over all submeshes.
+size_t generateMeshlets(SourceMesh &mesh);
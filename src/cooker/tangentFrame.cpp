@@ -0,0 +1,131 @@
+#include "cooker/sourceMesh.h"
+#include <cmath>
+
+namespace {
+Float3 sub(const Float3 &a, const Float3 &b) {
+  return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+Float3 cross(const Float3 &a, const Float3 &b) {
+  return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2],
+          a[0] * b[1] - a[1] * b[0]};
+}
+
+float dot(const Float3 &a, const Float3 &b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+bool normalize(Float3 &v) {
+  float length = std::sqrt(dot(v, v));
+  if (length < 1e-12f)
+    return false;
+  for (float &c : v)
+    c /= length;
+  return true;
+}
+
+// Calls f(a, b, c) with the mesh-wide vertex indices of every triangle
+template <typename F> void forEachTriangle(const SourceMesh &mesh, F &&f) {
+  for (const SourceSubmesh &submesh : mesh.submeshes) {
+    for (uint32_t i = 0; i + 2 < submesh.indexCount; i += 3) {
+      const uint32_t *tri = &mesh.indices[submesh.firstIndex + i];
+      f(submesh.firstVertex + tri[0], submesh.firstVertex + tri[1],
+        submesh.firstVertex + tri[2]);
+    }
+  }
+}
+} // namespace
+
+void generateNormals(SourceMesh &mesh) {
+  // Only vertices without a normal get one, glTF primitives may mix
+  std::vector<bool> missing(mesh.positions.size(), true);
+  if (mesh.normals.empty()) {
+    mesh.normals.assign(mesh.positions.size(), Float3{});
+  } else {
+    for (size_t v = 0; v < mesh.normals.size(); v++)
+      missing[v] = dot(mesh.normals[v], mesh.normals[v]) == 0.0f;
+  }
+
+  // The unnormalized cross product weighs each face by its area
+  std::vector<Float3> sums(mesh.positions.size(), Float3{});
+  forEachTriangle(mesh, [&](uint32_t a, uint32_t b, uint32_t c) {
+    Float3 n = cross(sub(mesh.positions[b], mesh.positions[a]),
+                     sub(mesh.positions[c], mesh.positions[a]));
+    for (uint32_t v : {a, b, c})
+      for (int k = 0; k < 3; k++)
+        sums[v][k] += n[k];
+  });
+
+  for (size_t v = 0; v < mesh.positions.size(); v++) {
+    if (!missing[v])
+      continue;
+    mesh.normals[v] = sums[v];
+    if (!normalize(mesh.normals[v]))
+      mesh.normals[v] = {0.0f, 0.0f, 1.0f};
+  }
+}
+
+void generateTangents(SourceMesh &mesh) {
+  // Fills in only the missing ones
+  generateNormals(mesh);
+
+  std::vector<bool> missing(mesh.positions.size(), true);
+  if (mesh.tangents.empty()) {
+    mesh.tangents.assign(mesh.positions.size(), Float4{});
+  } else {
+    for (size_t v = 0; v < mesh.tangents.size(); v++) {
+      const Float4 &t = mesh.tangents[v];
+      missing[v] = t[0] == 0.0f && t[1] == 0.0f && t[2] == 0.0f;
+    }
+  }
+
+  // Per-triangle derivatives of position along u and v, summed per vertex
+  std::vector<Float3> uSums(mesh.positions.size(), Float3{});
+  std::vector<Float3> vSums(mesh.positions.size(), Float3{});
+  if (!mesh.uvs.empty()) {
+    forEachTriangle(mesh, [&](uint32_t a, uint32_t b, uint32_t c) {
+      Float3 e1 = sub(mesh.positions[b], mesh.positions[a]);
+      Float3 e2 = sub(mesh.positions[c], mesh.positions[a]);
+      float du1 = mesh.uvs[b][0] - mesh.uvs[a][0];
+      float dv1 = mesh.uvs[b][1] - mesh.uvs[a][1];
+      float du2 = mesh.uvs[c][0] - mesh.uvs[a][0];
+      float dv2 = mesh.uvs[c][1] - mesh.uvs[a][1];
+      float det = du1 * dv2 - du2 * dv1;
+      if (std::abs(det) < 1e-20f)
+        return;
+      float r = 1.0f / det;
+      Float3 dPdu, dPdv;
+      for (int k = 0; k < 3; k++) {
+        dPdu[k] = (e1[k] * dv2 - e2[k] * dv1) * r;
+        dPdv[k] = (e2[k] * du1 - e1[k] * du2) * r;
+      }
+      for (uint32_t v : {a, b, c})
+        for (int k = 0; k < 3; k++) {
+          uSums[v][k] += dPdu[k];
+          vSums[v][k] += dPdv[k];
+        }
+    });
+  }
+
+  for (size_t v = 0; v < mesh.positions.size(); v++) {
+    if (!missing[v])
+      continue;
+    const Float3 &n = mesh.normals[v];
+
+    // Gram-Schmidt against the normal
+    Float3 t = uSums[v];
+    float d = dot(n, t);
+    for (int k = 0; k < 3; k++)
+      t[k] -= n[k] * d;
+    if (!normalize(t)) {
+      // No usable UVs: any direction orthogonal to the normal
+      Float3 axis = std::abs(n[0]) < 0.9f ? Float3{1.0f, 0.0f, 0.0f}
+                                          : Float3{0.0f, 1.0f, 0.0f};
+      t = cross(axis, n);
+      if (!normalize(t))
+        t = {1.0f, 0.0f, 0.0f};
+    }
+    float sign = dot(cross(n, t), vSums[v]) < 0.0f ? -1.0f : 1.0f;
+    mesh.tangents[v] = {t[0], t[1], t[2], sign};
+  }
+}
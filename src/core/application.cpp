@@ -1,84 +1,126 @@
 #include "core/application.h"
+#include "core/profiler.h"
 #include "renderer/renderer.h"
 #include "renderer/uniforms.h"
+#include <iostream>
+#include <stdexcept>
 #include <vulkan/vulkan_core.h>
 
-Application::Application()
-    : instance(enableValidationLayers), window("vkPrac", 800, 600),
-      surface(instance.getInstance(), window),
-      device(instance, surface.get(), enableValidationLayers),
-      swapchain(device, surface.get(), window),
-      pipeline(device.getLogical(), swapchain.getSwapchainImageFormat()),
-      commandContext(device.getPhysical(), device.getLogical(), surface.get()),
-      recorder(pipeline), frame(device, swapchain.getSwapchain()),
-      renderer(device, swapchain, commandContext, recorder, frame) {
+static VkSurfaceKHR surfaceOrNull(const std::unique_ptr<Surface> &surface) {
+  return surface ? surface->get() : VK_NULL_HANDLE;
+}
+
+Application::Application(const AppConfig &config)
+    : config(config),
+      window(config.headless ? nullptr
+                             : std::make_unique<Window>(
+                                   "vkPrac", config.width, config.height)),
+      instance(enableValidationLayers, config.headless),
+      surface(window ? std::make_unique<Surface>(instance.getInstance(),
+                                                 *window)
+                     : nullptr),
+      device(instance, surfaceOrNull(surface), enableValidationLayers),
+      swapchain(surface ? std::make_unique<Swapchain>(device, surface->get(),
+                                                      *window)
+                        : nullptr),
+      offscreen(surface ? nullptr
+                        : std::make_unique<OffscreenTarget>(
+                              device, VkExtent2D{config.width, config.height},
+                              config.framesInFlight)),
+      pipeline(device.getLogical(), swapchain
+                                        ? swapchain->getSwapchainImageFormat()
+                                        : offscreen->getColorFormat()),
+      commandContext(device.getPhysical(), device.getLogical(),
+                     surfaceOrNull(surface)),
+      recorder(pipeline),
+      frame(device, swapchain ? swapchain->getSwapchain() : VK_NULL_HANDLE,
+            config.framesInFlight),
+      renderer(device, swapchain.get(), offscreen.get(), commandContext,
+               recorder, frame),
+      streamer(renderer, config.streamingBudget) {
   initVulkan();
 }
 void Application::initVulkan() {
   commandContext.allocate(frame.getMaxFramesInFlight());
 
+  gpuProfiler =
+      std::make_unique<GpuProfiler>(device, frame.getMaxFramesInFlight());
+  renderer.setProfiler(gpuProfiler.get());
+  renderer.setJobSystem(&jobs);
+  renderer.setGpuCulling(true);
+  renderer.setOcclusionCulling(true);
+
   // --- Camera FIRST ---
-  camera = std::make_unique<Camera>(device, commandContext.getPool(),
-                                    frame.getMaxFramesInFlight());
+  camera = std::make_unique<Camera>();
 
-  camera->setPerspective(45.0f, window.getAspectRatio(), 0.1f, 100.0f);
+  float aspect = window ? window->getAspectRatio()
+                       : static_cast<float>(config.width) /
+                             static_cast<float>(config.height);
+  camera->setPerspective(45.0f, aspect, 0.1f, 100.0f);
   camera->setPosition({1.0f, 1.0f, 5.0f});
   camera->lookAt({0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f});
 
   // --- Mesh ---
-  auto mesh = std::make_unique<Mesh>(device, commandContext.getPool());
-
-  VkDeviceSize vbSize = sizeof(Vertex) * pipeline.vertices.size();
-  VkDeviceSize ibSize = sizeof(uint32_t) * pipeline.indices.size();
-
-  mesh->vertexBuffer.create(vbSize,
-                            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-                                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-  mesh->vertexBuffer.uploadViaStaging(pipeline.vertices.data(), vbSize);
-
-  mesh->indexBuffer.create(ibSize,
-                           VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-                               VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-  mesh->indexBuffer.uploadViaStaging(pipeline.indices.data(), ibSize);
-
-  mesh->indexCount = static_cast<uint32_t>(pipeline.indices.size());
-  meshes.push_back(std::move(mesh));
+  if (!config.meshPath.empty()) {
+    // Loads on the streamer's I/O threads, items follow in addLevelItems
+    level = streamer.requestMesh(config.meshPath);
+    return;
+  }
+  quad = renderer.createMesh(pipeline.vertices, pipeline.indices);
 
   // --- RenderItem ---
-  auto item = std::make_unique<RenderItem>(device, commandContext.getPool());
-  item->mesh = meshes.back().get();
+  auto item = std::make_unique<RenderItem>();
+  item->mesh = quad.get();
   item->transform = glm::mat4(1.0f);
-
-  item->modelBuffer.create(sizeof(ModelUBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-  item->descriptorSet = std::make_unique<DescriptorSet>(
-      device, pipeline.getDescriptorSetLayout(), frame.getMaxFramesInFlight());
-
-  for (uint32_t f = 0; f < frame.getMaxFramesInFlight(); f++) {
-    item->descriptorSet->update(f, camera->getBuffer(), sizeof(CameraUBO),
-                                item->modelBuffer.get(), sizeof(ModelUBO));
+  renderItems.push_back(std::move(item));
+}
+void Application::addLevelItems() {
+  // A level that cannot load is reported once and left out, the rest of
+  // the frame still renders
+  if (level->getState() == MeshAsset::State::Failed) {
+    std::cerr << level->getPath() << ": " << level->getError() << std::endl;
+    level = nullptr;
+    return;
   }
 
-  renderItems.push_back(std::move(item));
+  // The meshes keep their address through evictions, so the items are
+  // created once, one per submesh
+  if (!renderItems.empty() || level->getMeshes().empty())
+    return;
+  for (const auto &mesh : level->getMeshes()) {
+    auto item = std::make_unique<RenderItem>();
+    item->mesh = mesh.get();
+    item->transform = glm::mat4(1.0f);
+    renderItems.push_back(std::move(item));
+  }
 }
 void Application::mainLoop() {
-  while (!window.shouldClose()) {
-    window.pollEvents();
+  PROFILE_THREAD("main");
+
+  uint32_t framesRendered = 0;
+  while (!window || !window->shouldClose()) {
+    if (config.frameCount != 0 && framesRendered == config.frameCount)
+      break;
+    framesRendered++;
+
+    PROFILE_SCOPE("frame");
+
+    if (window)
+      window->pollEvents();
     std::vector<RenderItem *> rawPtrs;
     rawPtrs.reserve(renderItems.size());
     for (auto &r : renderItems)
       rawPtrs.push_back(r.get());
     RenderResult result = renderer.drawFrame(rawPtrs, *camera);
+    streamer.update();
+    if (level)
+      addLevelItems();
 
-    if (result == RenderResult::SwapchainOutOfDate ||
-        window.getFrameBufferResized()) {
+    if (swapchain && (result == RenderResult::SwapchainOutOfDate ||
+                      window->getFrameBufferResized())) {
 
-      window.setFrameBufferResized(false);
-      swapchain.recreateSwapchain(surface.get(), window);
+      window->setFrameBufferResized(false);
+      swapchain->recreateSwapchain(surface->get(), *window);
     } else if (result == RenderResult::FatalError) {
       throw std::runtime_error("Fatal render error");
     }
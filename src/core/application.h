@@ -1,4 +1,6 @@
 #pragma once
+#include "core/jobSystem.h"
+#include "renderer/assetStreamer.h"
 #include "renderer/camera.h"
 #include "renderer/renderItem.h"
 #include "renderer/renderer.h"
@@ -6,7 +8,9 @@
 #include "rhi/vulkan/commandContext.h"
 #include "rhi/vulkan/device.h"
 #include "rhi/vulkan/frame.h"
+#include "rhi/vulkan/gpuProfiler.h"
 #include "rhi/vulkan/instance.h"
+#include "rhi/vulkan/offscreenTarget.h"
 #include "rhi/vulkan/pipeline.h"
 #include "rhi/vulkan/renderRecorder.h"
 #include "rhi/vulkan/surface.h"
@@ -17,6 +21,7 @@
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_core.h>
@@ -27,31 +32,60 @@ const bool enableValidationLayers = false;
 const bool enableValidationLayers = true;
 #endif
 
+struct AppConfig {
+  // Render into an offscreen ring instead of a window (no GLFW, no surface)
+  bool headless = false;
+  uint32_t width = 800;
+  uint32_t height = 600;
+  int framesInFlight = 3;
+  // Number of frames to render before returning, 0 = until the window closes
+  uint32_t frameCount = 0;
+  // Cooked .mesh to stream in instead of the built-in quad
+  std::string meshPath;
+  // Device bytes of streamed geometry kept resident
+  uint64_t streamingBudget = 256ull * 1024 * 1024;
+};
+
 class Application {
 public:
   void run() { mainLoop(); }
 
-  Application();
+  Application(const AppConfig &config = {});
   ~Application();
 
+  // GPU zones of the last completed frame
+  const GpuProfiler &getGpuProfiler() const noexcept { return *gpuProfiler; }
+
 private:
   void mainLoop();
 
 private:
   void initVulkan();
+  // One item per mesh of the streamed level once it first arrives
+  void addLevelItems();
 
 private:
-  Window window;
+  AppConfig config;
+  // Engine-wide worker pool, the calling thread of run() is its thread 0
+  JobSystem jobs;
+  // Only present when rendering to a window
+  std::unique_ptr<Window> window;
   Instance instance;
-  Surface surface;
+  std::unique_ptr<Surface> surface;
   Device device;
-  Swapchain swapchain;
+  std::unique_ptr<Swapchain> swapchain;
+  // Only present when headless
+  std::unique_ptr<OffscreenTarget> offscreen;
   Pipeline pipeline;
   CommandContext commandContext;
   Frame frame;
   RenderRecorder recorder;
   Renderer renderer;
-  std::vector<std::unique_ptr<Mesh>> meshes;
+  // Owns every mesh loaded from disk, evicts them under memory pressure
+  AssetStreamer streamer;
+  MeshAsset *level = nullptr;
+  std::unique_ptr<Mesh> quad;
   std::vector<std::unique_ptr<RenderItem>> renderItems;
   std::unique_ptr<Camera> camera;
+  std::unique_ptr<GpuProfiler> gpuProfiler;
 };
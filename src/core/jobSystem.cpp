@@ -0,0 +1,250 @@
+#include "core/jobSystem.h"
+#include "core/profiler.h"
+#include <algorithm>
+#include <stdexcept>
+
+struct Job {
+  std::function<void()> task;
+  JobCounter *counter = nullptr;
+};
+
+namespace {
+// Which system and deque the calling thread belongs to
+thread_local const JobSystem *threadSystem = nullptr;
+thread_local uint32_t threadIndex = 0;
+} // namespace
+
+// Chase-Lev work-stealing deque over a fixed ring (Le et al., "Correct and
+// Efficient Work-Stealing for Weak Memory Models", 2013).
+class JobSystem::Deque {
+public:
+  // Owner only. False when full, the caller then runs the job itself.
+  bool push(Job *job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= Capacity)
+      return false;
+    slots[b & Mask].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Owner only, newest job first
+  Job *pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Job *job = slots[b & Mask].load(std::memory_order_relaxed);
+    if (t == b) {
+      // Last job, race the thieves for it
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+        job = nullptr;
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  // Any thread, oldest job first
+  Job *steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+      return nullptr;
+
+    Job *job = slots[t & Mask].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+      return nullptr;
+    return job;
+  }
+
+private:
+  static constexpr int64_t Capacity = 4096;
+  static constexpr int64_t Mask = Capacity - 1;
+
+  alignas(64) std::atomic<int64_t> top{0};
+  alignas(64) std::atomic<int64_t> bottom{0};
+  std::atomic<Job *> slots[Capacity] = {};
+};
+
+uint32_t JobSystem::defaultWorkerCount() noexcept {
+  return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+JobSystem::JobSystem(uint32_t workerCount) {
+  deques.resize(workerCount + 1);
+  for (auto &deque : deques)
+    deque = std::make_unique<Deque>();
+
+  threadSystem = this;
+  threadIndex = 0;
+
+  workers.reserve(workerCount);
+  for (uint32_t thread = 1; thread <= workerCount; thread++)
+    workers.emplace_back(&JobSystem::workerLoop, this, thread);
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard lock(sleepMutex);
+    stopping = true;
+  }
+  sleep.notify_all();
+  for (std::thread &worker : workers)
+    worker.join();
+
+  // Whatever is still queued never ran
+  for (auto &deque : deques) {
+    while (Job *job = deque->steal())
+      delete job;
+  }
+  if (threadSystem == this)
+    threadSystem = nullptr;
+}
+
+uint32_t JobSystem::currentThread() const {
+  if (threadSystem != this)
+    throw std::runtime_error("job scheduled from a foreign thread");
+  return threadIndex;
+}
+
+void JobSystem::run(std::function<void()> task, JobCounter *counter,
+                    JobCounter *after) {
+  Job *job = new Job{std::move(task), counter};
+  if (counter)
+    counter->value.fetch_add(1, std::memory_order_relaxed);
+
+  if (after) {
+    std::lock_guard lock(after->mutex);
+    if (!after->isDone()) {
+      after->continuations.push_back(job);
+      return;
+    }
+  }
+  schedule(job);
+}
+
+void JobSystem::schedule(Job *job) {
+  if (!deques[currentThread()]->push(job)) {
+    execute(job);
+    return;
+  }
+  queued.fetch_add(1, std::memory_order_release);
+  {
+    std::lock_guard lock(sleepMutex);
+  }
+  sleep.notify_one();
+}
+
+void JobSystem::execute(Job *job) {
+  try {
+    job->task();
+  } catch (...) {
+    std::lock_guard lock(errorMutex);
+    if (!error)
+      error = std::current_exception();
+  }
+
+  JobCounter *counter = job->counter;
+  delete job;
+  if (!counter)
+    return;
+
+  // Lowered under the lock so a waiter that sees zero can only destroy the
+  // counter after this thread let go of it, see wait()
+  std::vector<Job *> ready;
+  {
+    std::lock_guard lock(counter->mutex);
+    if (counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      ready.swap(counter->continuations);
+  }
+  for (Job *next : ready)
+    schedule(next);
+}
+
+Job *JobSystem::find(uint32_t thread) {
+  Job *job = deques[thread]->pop();
+  for (uint32_t i = 1; !job && i < deques.size(); i++)
+    job = deques[(thread + i) % deques.size()]->steal();
+  if (job)
+    queued.fetch_sub(1, std::memory_order_relaxed);
+  return job;
+}
+
+void JobSystem::workerLoop(uint32_t thread) {
+  threadSystem = this;
+  threadIndex = thread;
+  PROFILE_THREAD("job worker");
+
+  while (!stopping.load(std::memory_order_relaxed)) {
+    if (Job *job = find(thread)) {
+      execute(job);
+      continue;
+    }
+    std::unique_lock lock(sleepMutex);
+    sleep.wait(lock, [&] {
+      return stopping.load(std::memory_order_relaxed) ||
+             queued.load(std::memory_order_acquire) > 0;
+    });
+  }
+}
+
+void JobSystem::wait(JobCounter &counter) {
+  uint32_t thread = currentThread();
+  while (!counter.isDone()) {
+    if (Job *job = find(thread))
+      execute(job);
+    else
+      std::this_thread::yield();
+  }
+  // The job that lowered it to zero may still hold the lock
+  {
+    std::lock_guard lock(counter.mutex);
+  }
+
+  std::exception_ptr failure;
+  {
+    std::lock_guard lock(errorMutex);
+    std::swap(failure, error);
+  }
+  if (failure)
+    std::rethrow_exception(failure);
+}
+
+void JobSystem::parallelFor(
+    uint32_t count, const std::function<void(uint32_t, uint32_t)> &body,
+    uint32_t minChunk) {
+  // A few chunks per thread so stealing can even out uneven ones
+  uint32_t chunks = getThreadCount() * 4;
+  uint32_t chunk = std::max({(count + chunks - 1) / chunks, minChunk, 1u});
+  if (count <= chunk) {
+    body(0, count);
+    return;
+  }
+
+  JobCounter counter;
+  for (uint32_t begin = chunk; begin < count; begin += chunk) {
+    uint32_t end = std::min(begin + chunk, count);
+    run([&body, begin, end] { body(begin, end); }, &counter);
+  }
+  // The queued chunks reference counter and body, so they have to finish
+  // even if this one throws
+  std::exception_ptr failure;
+  try {
+    body(0, chunk);
+  } catch (...) {
+    failure = std::current_exception();
+  }
+  wait(counter);
+  if (failure)
+    std::rethrow_exception(failure);
+}
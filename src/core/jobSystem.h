@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+class JobSystem;
+
+// Number of unfinished jobs tied to it. A job may be scheduled to start
+// only once a counter reaches zero, which is how dependencies are chained.
+class JobCounter {
+public:
+  JobCounter() = default;
+  JobCounter(const JobCounter &) = delete;
+  JobCounter &operator=(const JobCounter &) = delete;
+
+  bool isDone() const noexcept {
+    return value.load(std::memory_order_acquire) == 0;
+  }
+
+private:
+  friend class JobSystem;
+
+  std::atomic<uint32_t> value{0};
+  // Jobs waiting for value to hit zero
+  std::mutex mutex;
+  std::vector<Job *> continuations;
+};
+
+// Fixed pool of worker threads with one Chase-Lev deque per thread. The
+// owner pushes and pops at the bottom, idle threads steal from the top.
+// The thread that creates the system counts as thread 0 and helps run jobs
+// whenever it waits; only it and the workers may schedule jobs.
+class JobSystem {
+public:
+  // workerCount threads in addition to the creating thread
+  explicit JobSystem(uint32_t workerCount = defaultWorkerCount());
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  // Schedules task. counter, if any, is raised now and lowered when the
+  // task has run; after, if any, must reach zero before the task starts.
+  void run(std::function<void()> task, JobCounter *counter = nullptr,
+           JobCounter *after = nullptr);
+
+  // Runs queued jobs on this thread until counter reaches zero, then
+  // rethrows the first exception a job threw since the last wait
+  void wait(JobCounter &counter);
+
+  // Calls body(begin, end) over chunks of [0, count) on every thread and
+  // returns once all of them are done. Chunks are at least minChunk long
+  // and small enough to keep each thread busy with a few of them.
+  void parallelFor(uint32_t count,
+                   const std::function<void(uint32_t, uint32_t)> &body,
+                   uint32_t minChunk = 256);
+
+  // Workers plus the creating thread
+  uint32_t getThreadCount() const noexcept {
+    return static_cast<uint32_t>(deques.size());
+  }
+
+  static uint32_t defaultWorkerCount() noexcept;
+
+private:
+  class Deque;
+
+  void schedule(Job *job);
+  void execute(Job *job);
+  // Own deque first, then a steal attempt from every other thread
+  Job *find(uint32_t thread);
+  void workerLoop(uint32_t thread);
+  uint32_t currentThread() const;
+
+  std::vector<std::unique_ptr<Deque>> deques;
+  std::vector<std::thread> workers;
+
+  // Idle workers sleep until something is queued
+  std::atomic<uint32_t> queued{0};
+  std::mutex sleepMutex;
+  std::condition_variable sleep;
+  std::atomic<bool> stopping{false};
+
+  // First exception thrown by a job, rethrown from wait()
+  std::mutex errorMutex;
+  std::exception_ptr error;
+};
+
+// JobSystem::parallelFor when a job system is given, otherwise one call to
+// body on this thread
+inline void parallelFor(JobSystem *jobs, uint32_t count,
+                        const std::function<void(uint32_t, uint32_t)> &body,
+                        uint32_t minChunk = 256) {
+  if (jobs)
+    jobs->parallelFor(count, body, minChunk);
+  else
+    body(0, count);
+}
@@ -1,10 +1,28 @@
 #include "core/application.h"
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-  Application app;
+int main(int argc, char **argv) {
+  AppConfig config;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      config.headless = true;
+    } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      config.frameCount = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc) {
+      config.meshPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--budget-mb") == 0 && i + 1 < argc) {
+      config.streamingBudget =
+          std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+    }
+  }
+  // Nothing can close a headless run, so give it a bounded default
+  if (config.headless && config.frameCount == 0)
+    config.frameCount = 1000;
+
+  Application app(config);
 
   try {
     app.run();
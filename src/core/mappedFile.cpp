@@ -0,0 +1,121 @@
+#include "core/mappedFile.h"
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("failed to open " + path);
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    throw std::runtime_error("failed to stat " + path);
+  }
+  size = static_cast<size_t>(fileSize.QuadPart);
+  if (size == 0) {
+    CloseHandle(file);
+    throw std::runtime_error(path + " is empty");
+  }
+
+  mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  // The mapping keeps the file open
+  CloseHandle(file);
+  if (!mapping)
+    throw std::runtime_error("failed to map " + path);
+
+  data = static_cast<const std::byte *>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!data) {
+    CloseHandle(mapping);
+    throw std::runtime_error("failed to map " + path);
+  }
+}
+
+void MappedFile::close() noexcept {
+  if (data)
+    UnmapViewOfFile(data);
+  if (mapping)
+    CloseHandle(mapping);
+  data = nullptr;
+  mapping = nullptr;
+  size = 0;
+}
+#else
+MappedFile::MappedFile(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("failed to open " + path);
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw std::runtime_error("failed to stat " + path);
+  }
+  size = static_cast<size_t>(info.st_size);
+  if (size == 0) {
+    ::close(fd);
+    throw std::runtime_error(path + " is empty");
+  }
+
+  void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file open
+  ::close(fd);
+  if (mapped == MAP_FAILED)
+    throw std::runtime_error("failed to map " + path);
+
+  // Every section is uploaded right after mapping, start reading ahead
+  madvise(mapped, size, MADV_WILLNEED);
+  data = static_cast<const std::byte *>(mapped);
+}
+
+void MappedFile::close() noexcept {
+  if (data)
+    munmap(const_cast<std::byte *>(data), size);
+  data = nullptr;
+  size = 0;
+}
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+void MappedFile::prefetch() const noexcept {
+  // Smaller than any page size in use, one read per page is enough
+  constexpr size_t Stride = 4096;
+  unsigned sum = 0;
+  for (size_t offset = 0; offset < size; offset += Stride)
+    sum += static_cast<unsigned>(data[offset]);
+  if (size > 0)
+    sum += static_cast<unsigned>(data[size - 1]);
+  // Keeps the loads from being optimized away
+  volatile unsigned sink = sum;
+  (void)sink;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    close();
+    data = std::exchange(other.data, nullptr);
+    size = std::exchange(other.size, 0);
+#ifdef _WIN32
+    mapping = std::exchange(other.mapping, nullptr);
+#endif
+  }
+  return *this;
+}
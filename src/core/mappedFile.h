@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are loaded on first
+// touch, so reading a range costs no more than the bytes it covers.
+class MappedFile {
+public:
+  MappedFile() = default;
+  // Throws when the file cannot be opened or mapped
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  std::span<const std::byte> getBytes() const noexcept {
+    return {data, size};
+  }
+  bool isOpen() const noexcept { return data != nullptr; }
+  // Touches every page so later reads on other threads do not block on
+  // the disk
+  void prefetch() const noexcept;
+
+private:
+  void close() noexcept;
+
+  const std::byte *data = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  void *mapping = nullptr;
+#endif
+};
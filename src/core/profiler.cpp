@@ -0,0 +1,148 @@
+#include "core/profiler.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct ZoneEvent {
+  const char *name;
+  uint64_t beginNs;
+  uint64_t endNs;
+};
+
+// Single producer (the owning thread), read only when dumping
+struct ThreadRing {
+  static constexpr uint64_t Capacity = 1 << 16;
+
+  std::array<ZoneEvent, Capacity> events;
+  std::atomic<uint64_t> head{0};
+  uint32_t threadId = 0;
+  std::string threadName;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadRing>> rings;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+  ~Registry() {
+    if (const char *path = std::getenv("SOULSLIKE_TRACE"))
+      CpuProfiler::dumpChromeTrace(path);
+  }
+};
+
+Registry &registry() {
+  static Registry instance;
+  return instance;
+}
+
+ThreadRing &localRing() {
+  // The registry keeps the ring alive after the thread exits so its events
+  // still make it into the dump.
+  thread_local std::shared_ptr<ThreadRing> ring = [] {
+    auto r = std::make_shared<ThreadRing>();
+    Registry &reg = registry();
+    std::lock_guard lock(reg.mutex);
+    r->threadId = static_cast<uint32_t>(reg.rings.size());
+    reg.rings.push_back(r);
+    return r;
+  }();
+  return *ring;
+}
+
+void writeEscaped(std::ostream &os, const char *s) {
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      os << '\\';
+    os << *s;
+  }
+}
+
+} // namespace
+
+uint64_t CpuProfiler::nowNs() noexcept {
+  auto since = std::chrono::steady_clock::now() - registry().start;
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(since).count());
+}
+
+void CpuProfiler::record(const char *name, uint64_t beginNs,
+                         uint64_t endNs) noexcept {
+  ThreadRing &ring = localRing();
+  uint64_t head = ring.head.load(std::memory_order_relaxed);
+  ring.events[head % ThreadRing::Capacity] = {name, beginNs, endNs};
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::setThreadName(const char *name) {
+  ThreadRing &ring = localRing();
+  std::lock_guard lock(registry().mutex);
+  ring.threadName = name;
+}
+
+bool CpuProfiler::dumpChromeTrace(const std::string &path) {
+  std::ofstream file(path);
+  if (!file)
+    return false;
+
+  Registry &reg = registry();
+  std::lock_guard lock(reg.mutex);
+
+  file << std::fixed << std::setprecision(3);
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  bool first = true;
+  auto separator = [&]() {
+    if (!first)
+      file << ",\n";
+    first = false;
+  };
+
+  std::vector<ZoneEvent> events;
+  for (const auto &ring : reg.rings) {
+    if (!ring->threadName.empty()) {
+      separator();
+      file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+              "\"tid\": "
+           << ring->threadId << ", \"args\": {\"name\": \"";
+      writeEscaped(file, ring->threadName.c_str());
+      file << "\"}}";
+    }
+
+    // The owning thread may keep writing while we copy. Anything it could
+    // have overwritten between the two head reads is dropped.
+    uint64_t headBefore = ring->head.load(std::memory_order_acquire);
+    uint64_t begin = headBefore > ThreadRing::Capacity
+                         ? headBefore - ThreadRing::Capacity
+                         : 0;
+    events.clear();
+    for (uint64_t i = begin; i < headBefore; i++)
+      events.push_back(ring->events[i % ThreadRing::Capacity]);
+
+    uint64_t headAfter = ring->head.load(std::memory_order_acquire);
+    uint64_t firstValid = headAfter > ThreadRing::Capacity
+                              ? headAfter - ThreadRing::Capacity
+                              : 0;
+
+    for (uint64_t i = std::max(begin, firstValid); i < headBefore; i++) {
+      const ZoneEvent &e = events[i - begin];
+      separator();
+      file << "{\"name\": \"";
+      writeEscaped(file, e.name);
+      file << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << ring->threadId
+           << ", \"ts\": " << e.beginNs / 1000.0
+           << ", \"dur\": " << (e.endNs - e.beginNs) / 1000.0 << "}";
+    }
+  }
+
+  file << "\n]}\n";
+  return static_cast<bool>(file);
+}
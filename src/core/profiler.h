@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Scoped CPU timing zones. Every thread writes into its own fixed-size ring
+// so recording never takes a lock; the rings are only walked when a trace is
+// dumped. Zone names must outlive the trace (use string literals).
+//
+// Build with SOULSLIKE_PROFILING to enable, otherwise the macros expand to
+// nothing. Set SOULSLIKE_TRACE=<path> to dump a trace when the process exits.
+
+class CpuProfiler {
+public:
+  static uint64_t nowNs() noexcept;
+  static void record(const char *name, uint64_t beginNs,
+                     uint64_t endNs) noexcept;
+  static void setThreadName(const char *name);
+
+  // Write everything still held in the rings as Chrome trace JSON, which
+  // chrome://tracing and ui.perfetto.dev both open. Returns false on I/O
+  // failure.
+  static bool dumpChromeTrace(const std::string &path);
+};
+
+class CpuZone {
+public:
+  explicit CpuZone(const char *name) noexcept
+      : name(name), beginNs(CpuProfiler::nowNs()) {}
+  ~CpuZone() { CpuProfiler::record(name, beginNs, CpuProfiler::nowNs()); }
+
+  CpuZone(const CpuZone &) = delete;
+  CpuZone &operator=(const CpuZone &) = delete;
+
+private:
+  const char *name;
+  uint64_t beginNs;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SOULSLIKE_PROFILING
+#define PROFILE_SCOPE(name) CpuZone PROFILE_CONCAT(cpuZone, __LINE__)(name)
+#define PROFILE_THREAD(name) CpuProfiler::setThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
@@ -34,11 +34,14 @@ float Window::getAspectRatio() const noexcept {
 GLFWwindow *Window::getWindow() const noexcept { return window; }
 
 Window::Window(std::string_view title, uint32_t w, uint32_t h) {
+  // Prefer Wayland, but let GLFW fall back to X11 where it is unavailable.
+  // The platform is an init hint, so it has to be set before glfwInit.
+  if (glfwPlatformSupported(GLFW_PLATFORM_WAYLAND))
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_WAYLAND);
+
   if (!glfwInit())
     throw std::runtime_error("Failed to initialize GLFW");
 
-  glfwWindowHint(GLFW_PLATFORM, GLFW_PLATFORM_WAYLAND);
-  // glfwWindowHint(GLFW_PLATFORM, GLFW_PLATFORM_X11);
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
   // glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
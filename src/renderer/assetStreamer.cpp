@@ -0,0 +1,220 @@
+#include "renderer/assetStreamer.h"
+#include "core/profiler.h"
+#include "renderer/renderItem.h"
+#include "renderer/renderer.h"
+#include <algorithm>
+
+AssetStreamer::AssetStreamer(Renderer &renderer, uint64_t budget,
+                             uint32_t ioThreads)
+    : renderer(renderer), budget(budget) {
+  for (uint32_t i = 0; i < std::max(ioThreads, 1u); i++)
+    this->ioThreads.emplace_back([this] { ioLoop(); });
+}
+
+AssetStreamer::~AssetStreamer() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread &thread : ioThreads)
+    thread.join();
+}
+
+MeshAsset *AssetStreamer::requestMesh(const std::string &path) {
+  auto [it, inserted] = assets.try_emplace(path);
+  if (inserted) {
+    it->second = std::make_unique<MeshAsset>();
+    it->second->path = path;
+    queue(*it->second);
+  } else if (it->second->getState() == MeshAsset::State::Evicted) {
+    queue(*it->second);
+  }
+  return it->second.get();
+}
+
+void AssetStreamer::queue(MeshAsset &asset) {
+  asset.state = MeshAsset::State::Queued;
+  {
+    std::lock_guard lock(mutex);
+    requests.push_back(&asset);
+  }
+  wake.notify_one();
+}
+
+void AssetStreamer::ioLoop() {
+  PROFILE_THREAD("asset io");
+
+  for (;;) {
+    MeshAsset *asset;
+    {
+      std::unique_lock lock(mutex);
+      wake.wait(lock, [this] { return stopping || !requests.empty(); });
+      if (stopping)
+        return;
+      asset = requests.front();
+      requests.pop_front();
+    }
+
+    // path never changes once the asset exists
+    Completion completion;
+    completion.asset = asset;
+    try {
+      PROFILE_SCOPE("load mesh");
+      completion.file = std::make_unique<MeshFile>(asset->path);
+      completion.file->prefetch();
+    } catch (const std::exception &e) {
+      completion.error = e.what();
+    }
+
+    std::lock_guard lock(mutex);
+    completions.push_back(std::move(completion));
+  }
+}
+
+void AssetStreamer::update() {
+  PROFILE_SCOPE("AssetStreamer::update");
+
+  std::vector<Completion> done;
+  {
+    std::lock_guard lock(mutex);
+    done.swap(completions);
+  }
+  for (Completion &completion : done) {
+    MeshAsset &asset = *completion.asset;
+    if (!completion.file) {
+      asset.state = MeshAsset::State::Failed;
+      asset.error = std::move(completion.error);
+      continue;
+    }
+    asset.file = std::move(completion.file);
+    asset.state = MeshAsset::State::Loaded;
+    loaded.push_back(&asset);
+  }
+
+  // Evicted assets someone tried to draw since come back
+  for (auto &[path, asset] : assets) {
+    if (asset->state != MeshAsset::State::Evicted)
+      continue;
+    bool wanted = std::any_of(asset->meshes.begin(), asset->meshes.end(),
+                              [&](const auto &mesh) {
+                                return mesh->lastUsedFrame > asset->stateFrame;
+                              });
+    if (wanted)
+      queue(*asset);
+  }
+
+  uint64_t uploaded = 0;
+  while (!loaded.empty() && uploaded < uploadBytesPerUpdate) {
+    MeshAsset &asset = *loaded.front();
+    const MeshFileHeader &header = asset.file->getHeader();
+    uint64_t bytes = uint64_t{header.vertexCount} * header.vertexStride +
+                     header.indices.size + header.meshlets.size;
+    // The budget gives way when everything resident is still in use, the
+    // pool does not; try again once something retires
+    if (!makeRoom(header, bytes) && !fitsPool(header))
+      break;
+    if (!upload(asset)) {
+      // Enough free space but no range large enough; evict more and try
+      // again, or wait for something to retire
+      MeshAsset *victim = findVictim();
+      if (!victim)
+        break;
+      evict(*victim);
+      continue;
+    }
+    loaded.pop_front();
+    uploaded += bytes;
+  }
+
+  // Back under budget once what is over it retires; an empty header needs
+  // no pool space
+  makeRoom(MeshFileHeader{}, 0);
+}
+
+bool AssetStreamer::upload(MeshAsset &asset) {
+  PROFILE_SCOPE("upload mesh");
+
+  try {
+    if (asset.meshes.empty())
+      asset.meshes = renderer.createMeshes(*asset.file);
+    else
+      renderer.uploadMeshes(*asset.file, asset.meshes);
+  } catch (const GeometryPoolFull &) {
+    // Nothing of the asset stays in the pool, it is still loaded
+    return false;
+  } catch (const std::exception &e) {
+    asset.state = MeshAsset::State::Failed;
+    asset.error = e.what();
+    asset.file.reset();
+    return true;
+  }
+  // The upload queue has copied everything into staging
+  asset.file.reset();
+
+  uint32_t stride = renderer.getGeometryPool().getLayout().getStride();
+  asset.size = 0;
+  for (const auto &mesh : asset.meshes) {
+    const GeometryRange &range = mesh->geometry;
+    asset.size += uint64_t{range.vertexCount} * stride +
+                  uint64_t{range.indexCount} * getIndexSize(range.indexType) +
+                  uint64_t{range.meshletCount} * sizeof(Meshlet);
+  }
+  residentBytes += asset.size;
+  asset.state = MeshAsset::State::Resident;
+  asset.stateFrame = renderer.getFrameNumber();
+  return true;
+}
+
+bool AssetStreamer::fitsPool(const MeshFileHeader &header) const {
+  GeometryPool &geometry = renderer.getGeometryPool();
+  return geometry.getFreeVertexCount() >= header.vertexCount &&
+         geometry.getFreeIndexCount(VK_INDEX_TYPE_UINT16) >=
+             header.shortIndexCount &&
+         geometry.getFreeIndexCount(VK_INDEX_TYPE_UINT32) >=
+             header.indexCount - header.shortIndexCount &&
+         geometry.getFreeMeshletCount() >= header.meshletCount;
+}
+
+bool AssetStreamer::makeRoom(const MeshFileHeader &header, uint64_t bytes) {
+  while (residentBytes + bytes > budget || !fitsPool(header)) {
+    MeshAsset *victim = findVictim();
+    if (!victim)
+      return false;
+    evict(*victim);
+  }
+  return true;
+}
+
+MeshAsset *AssetStreamer::findVictim() {
+  // A linear scan, there are few assets compared to items
+  UploadQueue &uploads = renderer.getUploadQueue();
+  MeshAsset *victim = nullptr;
+  uint64_t victimFrame = UINT64_MAX;
+  for (auto &[path, asset] : assets) {
+    if (asset->state != MeshAsset::State::Resident)
+      continue;
+
+    uint64_t lastUsed = asset->stateFrame;
+    bool copied = true;
+    for (const auto &mesh : asset->meshes) {
+      lastUsed = std::max(lastUsed, mesh->lastUsedFrame);
+      copied = copied && uploads.isComplete(mesh->upload);
+    }
+    if (copied && renderer.isRetired(lastUsed) && lastUsed < victimFrame) {
+      victim = asset.get();
+      victimFrame = lastUsed;
+    }
+  }
+  return victim;
+}
+
+void AssetStreamer::evict(MeshAsset &asset) {
+  for (const auto &mesh : asset.meshes)
+    renderer.releaseMesh(*mesh);
+  residentBytes -= asset.size;
+  asset.size = 0;
+  asset.state = MeshAsset::State::Evicted;
+  asset.stateFrame = renderer.getFrameNumber();
+  evictions++;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "renderer/meshFile.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class Renderer;
+struct Mesh;
+
+// Cooked mesh file managed by an AssetStreamer. Its meshes are created by
+// the first load and keep their address across evictions, so render items
+// may point at them; while evicted they are simply not drawn.
+class MeshAsset {
+public:
+  enum class State { Queued, Loaded, Resident, Evicted, Failed };
+
+  State getState() const noexcept { return state; }
+  const std::string &getPath() const noexcept { return path; }
+  // Empty until the first load is resident, one per submesh after
+  std::span<const std::unique_ptr<Mesh>> getMeshes() const noexcept {
+    return meshes;
+  }
+  // Geometry bytes while resident
+  uint64_t getSize() const noexcept { return size; }
+  // Why the last load failed
+  const std::string &getError() const noexcept { return error; }
+
+private:
+  friend class AssetStreamer;
+
+  std::string path;
+  State state = State::Queued;
+  std::vector<std::unique_ptr<Mesh>> meshes;
+  uint64_t size = 0;
+  // Renderer frame of the last upload or eviction
+  uint64_t stateFrame = 0;
+  // Mapped by an I/O thread, waiting to be uploaded
+  std::unique_ptr<MeshFile> file;
+  std::string error;
+};
+
+// Background loading of cooked assets under a device memory budget. I/O
+// threads map and read files; update() uploads what they finished through
+// the renderer's upload queue, reloads evicted assets that were asked to
+// be drawn again and evicts the least recently drawn ones while resident
+// geometry is over budget. Everything but the I/O runs on the thread that
+// calls drawFrame.
+class AssetStreamer {
+public:
+  // budget in bytes of resident geometry, the geometry pool's capacity
+  // caps it too
+  AssetStreamer(Renderer &renderer, uint64_t budget, uint32_t ioThreads = 2);
+  ~AssetStreamer();
+
+  AssetStreamer(const AssetStreamer &) = delete;
+  AssetStreamer &operator=(const AssetStreamer &) = delete;
+
+  // The same path always yields the same asset; loading starts in the
+  // background unless it is resident already
+  MeshAsset *requestMesh(const std::string &path);
+  // Once per frame, after drawFrame
+  void update();
+
+  void setBudget(uint64_t bytes) noexcept { budget = bytes; }
+  uint64_t getBudget() const noexcept { return budget; }
+  uint64_t getResidentBytes() const noexcept { return residentBytes; }
+  // Upload volume per update, a loaded asset larger than this still goes
+  // out whole when it is first in line
+  void setUploadBytesPerUpdate(uint64_t bytes) noexcept {
+    uploadBytesPerUpdate = bytes;
+  }
+  uint32_t getEvictionCount() const noexcept { return evictions; }
+
+private:
+  // Result of a load, handed from an I/O thread to update()
+  struct Completion {
+    MeshAsset *asset = nullptr;
+    std::unique_ptr<MeshFile> file;
+    std::string error;
+  };
+
+  void queue(MeshAsset &asset);
+  void ioLoop();
+  // Makes asset resident, or failed for good on I/O and format errors.
+  // False when the pool is too fragmented for it; it stays loaded then.
+  bool upload(MeshAsset &asset);
+  // Evicts until the geometry of the file with header fits in the pool
+  // and bytes more stay within budget. False when only assets still in
+  // use are left.
+  bool makeRoom(const MeshFileHeader &header, uint64_t bytes);
+  // Free element counts only, a fragmented pool may still fail the upload
+  bool fitsPool(const MeshFileHeader &header) const;
+  // Least recently drawn resident asset the GPU is done with
+  MeshAsset *findVictim();
+  void evict(MeshAsset &asset);
+
+  Renderer &renderer;
+  uint64_t budget;
+  uint64_t residentBytes = 0;
+  uint64_t uploadBytesPerUpdate = 32ull * 1024 * 1024;
+  uint32_t evictions = 0;
+
+  std::unordered_map<std::string, std::unique_ptr<MeshAsset>> assets;
+  // Loaded assets in completion order, waiting for upload
+  std::deque<MeshAsset *> loaded;
+
+  // Shared with the I/O threads
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<MeshAsset *> requests;
+  std::vector<Completion> completions;
+  bool stopping = false;
+  std::vector<std::thread> ioThreads;
+};
@@ -0,0 +1,28 @@
+#include "renderer/bounds.h"
+#include <algorithm>
+#include <cmath>
+
+Bounds computeBounds(std::span<const Vertex> vertices) {
+  Bounds bounds;
+  if (vertices.empty())
+    return bounds;
+
+  glm::vec3 lo = vertices[0].pos;
+  glm::vec3 hi = vertices[0].pos;
+  for (const Vertex &v : vertices) {
+    lo = glm::min(lo, v.pos);
+    hi = glm::max(hi, v.pos);
+  }
+
+  bounds.center = (lo + hi) * 0.5f;
+  bounds.extents = (hi - lo) * 0.5f;
+
+  // Box-centered sphere, tighter than the box diagonal for most meshes
+  float radiusSq = 0.0f;
+  for (const Vertex &v : vertices) {
+    glm::vec3 d = v.pos - bounds.center;
+    radiusSq = std::max(radiusSq, glm::dot(d, d));
+  }
+  bounds.radius = std::sqrt(radiusSq);
+  return bounds;
+}
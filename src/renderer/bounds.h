@@ -0,0 +1,14 @@
+#pragma once
+#include "rhi/vulkan/pipeline.h"
+#include <glm/glm.hpp>
+#include <span>
+
+// Object-space bounds of a mesh. The sphere and the box share a center.
+struct Bounds {
+  glm::vec3 center{0.0f};
+  float radius = 0.0f;
+  // Half size of the axis-aligned box around center
+  glm::vec3 extents{0.0f};
+};
+
+Bounds computeBounds(std::span<const Vertex> vertices);
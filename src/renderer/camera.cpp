@@ -1,17 +1,8 @@
 #include "renderer/camera.h"
-#include "../helper.h"
-#include <cstring>
+#include "core/profiler.h"
 #include <glm/gtc/matrix_transform.hpp>
 
-Camera::Camera(Device &device, VkCommandPool commandPool,
-               uint32_t framesInFlight)
-    : device(device), commandPool(commandPool) {
-  buffer = std::make_unique<Buffer>(device, commandPool);
-  buffer->create(sizeof(CameraUBO) * framesInFlight,
-                 VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
+Camera::Camera() {
   ubo.view = glm::mat4(1.0f);
   ubo.proj = glm::mat4(1.0f);
 }
@@ -27,11 +18,11 @@ void Camera::lookAt(const glm::vec3 &target, const glm::vec3 &up) {
   ubo.view = glm::lookAt(position, target, up);
 }
 
-void Camera::update(uint32_t frameIndex) {
-  VkDeviceSize offset = frameIndex * sizeof(CameraUBO);
-  void *data = nullptr;
-  vkMapMemory(device.getLogical(), buffer->getMemory(), offset,
-              sizeof(CameraUBO), 0, &data);
-  std::memcpy(data, &ubo, sizeof(CameraUBO));
-  vkUnmapMemory(device.getLogical(), buffer->getMemory());
+Frustum Camera::getFrustum() const {
+  return extractFrustum(ubo.proj * ubo.view);
+}
+
+void Camera::update(UniformRing &ring) {
+  PROFILE_SCOPE("Camera::update");
+  uniform = ring.push(ubo);
 }
@@ -1,26 +1,30 @@
 #pragma once
+#include "renderer/frustum.h"
 #include "renderer/uniforms.h"
-#include "rhi/vulkan/buffer.h"
-#include "rhi/vulkan/device.h"
+#include "rhi/vulkan/uniformRing.h"
 #include <glm/glm.hpp>
-#include <memory>
 
 class Camera {
 public:
-  Camera(Device &device, VkCommandPool commandPool, uint32_t framesInFlight);
+  Camera();
 
   void setPerspective(float fov, float aspect, float near, float far);
   void setPosition(const glm::vec3 &pos);
   void lookAt(const glm::vec3 &target, const glm::vec3 &up);
-  void update(uint32_t frameIndex);
+  // Writes this frame's CameraUBO into the ring
+  void update(UniformRing &ring);
 
-  VkBuffer getBuffer() const { return buffer->get(); }
+  // World-space view frustum of the current view and projection
+  Frustum getFrustum() const;
+
+  // Matrices written by the last update
+  const CameraUBO &getMatrices() const { return ubo; }
+  // Where the last update put the CameraUBO (dynamic offset into the ring)
+  const RingAllocation &getUniform() const { return uniform; }
 
 private:
-  Device &device;
-  VkCommandPool commandPool;
   glm::vec3 position{0.0f, 0.0f, 0.0f};
   CameraUBO ubo{};
 
-  std::unique_ptr<Buffer> buffer;
+  RingAllocation uniform;
 };
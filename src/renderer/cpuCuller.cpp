@@ -0,0 +1,194 @@
+#include "renderer/cpuCuller.h"
+#include "core/jobSystem.h"
+#include "core/profiler.h"
+#include "renderer/renderItem.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define SOULSLIKE_CULL_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(SOULSLIKE_CULL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SOULSLIKE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SOULSLIKE_TARGET_AVX2
+#endif
+
+namespace {
+constexpr uint32_t Width = 8;
+
+struct Spheres {
+  const float *x;
+  const float *y;
+  const float *z;
+  const float *r;
+  uint32_t count;
+};
+
+// Appends base + bit for every set bit of mask that is below count
+inline void appendMask(uint32_t mask, uint32_t base, uint32_t count,
+                       std::vector<uint32_t> &out) {
+  while (mask) {
+    uint32_t bit = 0;
+    while (!(mask & (1u << bit)))
+      bit++;
+    mask &= mask - 1;
+    if (base + bit < count)
+      out.push_back(base + bit);
+  }
+}
+
+void cullScalar(const Spheres &s, const Frustum &f,
+                std::vector<uint32_t> &out) {
+  for (uint32_t i = 0; i < s.count; i++) {
+    bool inside = true;
+    for (const glm::vec4 &p : f.planes) {
+      float d = p.x * s.x[i] + p.y * s.y[i] + p.z * s.z[i] + p.w;
+      if (d < -s.r[i]) {
+        inside = false;
+        break;
+      }
+    }
+    if (inside)
+      out.push_back(i);
+  }
+}
+
+#ifdef SOULSLIKE_CULL_X86
+void cullSse(const Spheres &s, const Frustum &f, std::vector<uint32_t> &out) {
+  __m128 px[6], py[6], pz[6], pw[6];
+  for (int p = 0; p < 6; p++) {
+    px[p] = _mm_set1_ps(f.planes[p].x);
+    py[p] = _mm_set1_ps(f.planes[p].y);
+    pz[p] = _mm_set1_ps(f.planes[p].z);
+    pw[p] = _mm_set1_ps(f.planes[p].w);
+  }
+
+  const __m128 zero = _mm_setzero_ps();
+  for (uint32_t i = 0; i < s.count; i += 4) {
+    __m128 x = _mm_loadu_ps(s.x + i);
+    __m128 y = _mm_loadu_ps(s.y + i);
+    __m128 z = _mm_loadu_ps(s.z + i);
+    __m128 negR = _mm_sub_ps(zero, _mm_loadu_ps(s.r + i));
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < 6; p++) {
+      __m128 d = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+          _mm_add_ps(_mm_mul_ps(pz[p], z), pw[p]));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+    }
+    appendMask(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, s.count,
+               out);
+  }
+}
+
+SOULSLIKE_TARGET_AVX2 void cullAvx2(const Spheres &s, const Frustum &f,
+                                    std::vector<uint32_t> &out) {
+  __m256 px[6], py[6], pz[6], pw[6];
+  for (int p = 0; p < 6; p++) {
+    px[p] = _mm256_set1_ps(f.planes[p].x);
+    py[p] = _mm256_set1_ps(f.planes[p].y);
+    pz[p] = _mm256_set1_ps(f.planes[p].z);
+    pw[p] = _mm256_set1_ps(f.planes[p].w);
+  }
+
+  const __m256 zero = _mm256_setzero_ps();
+  for (uint32_t i = 0; i < s.count; i += 8) {
+    __m256 x = _mm256_loadu_ps(s.x + i);
+    __m256 y = _mm256_loadu_ps(s.y + i);
+    __m256 z = _mm256_loadu_ps(s.z + i);
+    __m256 negR = _mm256_sub_ps(zero, _mm256_loadu_ps(s.r + i));
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int p = 0; p < 6; p++) {
+      __m256 d = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(px[p], x), _mm256_mul_ps(py[p], y)),
+          _mm256_add_ps(_mm256_mul_ps(pz[p], z), pw[p]));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+    }
+    appendMask(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, s.count,
+               out);
+  }
+}
+#endif
+
+enum class Path { Scalar, Sse, Avx2 };
+
+Path detectPath() {
+#ifdef SOULSLIKE_CULL_X86
+#if defined(__GNUC__) || defined(__clang__)
+  if (__builtin_cpu_supports("avx2"))
+    return Path::Avx2;
+#elif defined(__AVX2__)
+  return Path::Avx2;
+#endif
+  return Path::Sse;
+#else
+  return Path::Scalar;
+#endif
+}
+
+const Path ActivePath = detectPath();
+} // namespace
+
+const char *CpuCuller::getPath() noexcept {
+  switch (ActivePath) {
+  case Path::Avx2:
+    return "avx2";
+  case Path::Sse:
+    return "sse";
+  default:
+    return "scalar";
+  }
+}
+
+void CpuCuller::setBounds(std::span<RenderItem *const> items,
+                          JobSystem *jobs) {
+  count = static_cast<uint32_t>(items.size());
+  size_t padded = (items.size() + Width - 1) / Width * Width;
+  centerX.resize(padded);
+  centerY.resize(padded);
+  centerZ.resize(padded);
+  radius.resize(padded);
+
+  parallelFor(jobs, count, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      const glm::mat4 &m = items[i]->transform;
+      const Bounds &b = items[i]->mesh->bounds;
+      glm::vec3 c = glm::vec3(m * glm::vec4(b.center, 1.0f));
+      float scale = std::max({glm::length(glm::vec3(m[0])),
+                              glm::length(glm::vec3(m[1])),
+                              glm::length(glm::vec3(m[2]))});
+      centerX[i] = c.x;
+      centerY[i] = c.y;
+      centerZ[i] = c.z;
+      radius[i] = b.radius * scale;
+    }
+  });
+}
+
+std::span<const uint32_t> CpuCuller::cull(const Frustum &frustum) {
+  PROFILE_SCOPE("CpuCuller::cull");
+  visible.clear();
+  visible.reserve(count);
+
+  Spheres s{centerX.data(), centerY.data(), centerZ.data(), radius.data(),
+            count};
+  switch (ActivePath) {
+#ifdef SOULSLIKE_CULL_X86
+  case Path::Avx2:
+    cullAvx2(s, frustum, visible);
+    break;
+  case Path::Sse:
+    cullSse(s, frustum, visible);
+    break;
+#endif
+  default:
+    cullScalar(s, frustum, visible);
+    break;
+  }
+  return visible;
+}
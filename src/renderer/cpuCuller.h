@@ -0,0 +1,30 @@
+#pragma once
+#include "renderer/frustum.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct RenderItem;
+class JobSystem;
+
+// Frustum culling on the CPU over world-space bounding spheres kept in
+// structure-of-arrays form. Tests 8 spheres per step with AVX2, 4 with SSE
+// and falls back to scalar code elsewhere; the path is picked at runtime.
+class CpuCuller {
+public:
+  // Rebuilds the sphere arrays from the items' mesh bounds and transforms,
+  // spread over jobs when given
+  void setBounds(std::span<RenderItem *const> items,
+                 JobSystem *jobs = nullptr);
+  // Indices (into the last setBounds span) of spheres touching the frustum
+  std::span<const uint32_t> cull(const Frustum &frustum);
+
+  // "avx2", "sse" or "scalar"
+  static const char *getPath() noexcept;
+
+private:
+  // Padded to a multiple of 8 so the wide paths never need a tail loop
+  std::vector<float> centerX, centerY, centerZ, radius;
+  uint32_t count = 0;
+  std::vector<uint32_t> visible;
+};
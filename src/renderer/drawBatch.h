@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+
+struct Mesh;
+struct Material;
+
+// One instanced draw: instanceCount consecutive object-table entries that
+// share a mesh, level of detail and material, starting at firstInstance.
+struct DrawBatch {
+  const Mesh *mesh = nullptr;
+  const Material *material = nullptr;
+  // Index into mesh->lods
+  uint32_t lod = 0;
+  uint32_t firstInstance = 0;
+  uint32_t instanceCount = 0;
+  // Drawn per meshlet by the cluster culling pass; the batch's own record
+  // draws nothing
+  bool meshlets = false;
+};
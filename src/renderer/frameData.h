@@ -0,0 +1,66 @@
+#pragma once
+#include "rhi/vulkan/descriptorCache.h"
+#include "rhi/vulkan/geometryPool.h"
+#include "rhi/vulkan/uniformRing.h"
+#include "rhi/vulkan/uploadQueue.h"
+#include <vulkan/vulkan_core.h>
+
+class GpuCuller;
+class MeshletCuller;
+
+// Per-frame GPU data the Renderer prepares before recording. Everything the
+// draws read is reached through one descriptor set bound once per frame.
+struct FrameData {
+  uint32_t frame = 0;
+  // CameraUBO in the uniform ring
+  RingAllocation camera;
+  // ObjectData[itemCount] in batch order, see DrawBatch::firstInstance
+  RingAllocation objects;
+  // Bound range of the object table, fixed so the set can be cached
+  VkDeviceSize objectRange = 0;
+  // Table the vertex shader reads: the object table itself, or the culled
+  // copy when GPU culling compacts visible objects
+  RingAllocation instances;
+  VkDeviceSize instanceRange = 0;
+  DescriptorCache *descriptors = nullptr;
+  // Shared vertex/index buffers every batch draws from
+  const GeometryPool *geometry = nullptr;
+  // Upload value this frame's draws wait for, 0 when everything they read
+  // was acquired by an earlier frame. The recorder acquires it up front.
+  UploadQueue *uploads = nullptr;
+  uint64_t uploadWait = 0;
+
+  // Indirect path: VkDrawIndexedIndirectCommand[maxDraws] and the uint32
+  // number of valid records. Left empty when recording direct draws.
+  RingAllocation drawCommands;
+  RingAllocation drawCount;
+  VkDeviceSize drawRange = 0;
+  uint32_t maxDraws = 0;
+  // Read the count from drawCount (vkCmdDrawIndexedIndirectCount), otherwise
+  // all maxDraws records are drawn
+  bool useDrawCount = false;
+  // Occlusion culling: records for objects the late phase finds newly
+  // visible, drawn after the depth pyramid is rebuilt. Same batches and
+  // range as drawCommands; left empty without occlusion culling.
+  RingAllocation lateDrawCommands;
+
+  // GPU culling, null when every object is drawn
+  GpuCuller *culler = nullptr;
+  RingAllocation cullParams;
+  RingAllocation cullObjects;
+  VkDeviceSize cullObjectRange = 0;
+  uint32_t objectCount = 0;
+
+  // Meshlet culling, null when no batch is drawn per meshlet
+  MeshletCuller *meshletCuller = nullptr;
+  RingAllocation meshletTasks;
+  uint32_t meshletTaskCount = 0;
+  // Records of the early (or only) and late dispatch: 16-bit index ones
+  // first, 32-bit ones from meshletRecords[0] on, each with uint32[2]
+  // counts. The late ones stay empty without occlusion culling.
+  RingAllocation meshletDraws;
+  RingAllocation meshletCounts;
+  RingAllocation lateMeshletDraws;
+  RingAllocation lateMeshletCounts;
+  uint32_t meshletRecords[2] = {};
+};
@@ -0,0 +1,19 @@
+#include "renderer/frustum.h"
+
+Frustum extractFrustum(const glm::mat4 &viewProj) {
+  // glm is column-major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+  glm::mat4 t = glm::transpose(viewProj);
+
+  Frustum f;
+  f.planes[Frustum::Left] = t[3] + t[0];
+  f.planes[Frustum::Right] = t[3] - t[0];
+  f.planes[Frustum::Bottom] = t[3] + t[1];
+  f.planes[Frustum::Top] = t[3] - t[1];
+  f.planes[Frustum::Near] = t[3] + t[2];
+  f.planes[Frustum::Far] = t[3] - t[2];
+
+  // Normalize so plane distances are in world units (needed for spheres)
+  for (glm::vec4 &p : f.planes)
+    p /= glm::length(glm::vec3(p));
+  return f;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Six planes (xyz = inward normal, w = distance) in the space the matrix
+// was built from. A point p is inside when dot(n, p) + w >= 0 for all.
+struct Frustum {
+  enum Plane { Left, Right, Bottom, Top, Near, Far, Count };
+  glm::vec4 planes[Count];
+};
+
+// Gribb-Hartmann extraction from a GL-style (-1..1 depth) view-projection
+Frustum extractFrustum(const glm::mat4 &viewProj);
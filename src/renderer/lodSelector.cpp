@@ -0,0 +1,52 @@
+#include "renderer/lodSelector.h"
+#include "core/jobSystem.h"
+#include "renderer/renderItem.h"
+#include <algorithm>
+#include <cmath>
+
+void LodSelector::select(std::span<RenderItem *const> items,
+                         const CameraUBO &camera, uint32_t viewportHeight,
+                         JobSystem *jobs) const {
+  // Pixels per world unit at distance 1; proj[1][1] is negative when the
+  // projection flips y for Vulkan
+  float pixelScale =
+      std::abs(camera.proj[1][1]) * 0.5f * static_cast<float>(viewportHeight);
+  float coarsenBelow = threshold * (1.0f - hysteresis);
+
+  uint32_t count = static_cast<uint32_t>(items.size());
+  parallelFor(jobs, count, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      RenderItem &item = *items[i];
+      const Mesh &mesh = *item.mesh;
+      auto levels = static_cast<uint32_t>(mesh.lods.size());
+      if (threshold <= 0.0f || levels <= 1) {
+        item.lod = 0;
+        continue;
+      }
+
+      const glm::mat4 &m = item.transform;
+      glm::vec3 center =
+          glm::vec3(camera.view * m * glm::vec4(mesh.bounds.center, 1.0f));
+      float scale = std::max({glm::length(glm::vec3(m[0])),
+                              glm::length(glm::vec3(m[1])),
+                              glm::length(glm::vec3(m[2]))});
+      float distance = glm::length(center);
+      // Inside the sphere the projection says nothing useful
+      if (distance <= mesh.bounds.radius * scale) {
+        item.lod = 0;
+        continue;
+      }
+      // Object-space error to pixels, as if it faced the camera at the
+      // sphere's center
+      float toPixels = scale * pixelScale / distance;
+
+      uint32_t lod = std::min(item.lod, levels - 1);
+      while (lod > 0 && mesh.lods[lod].error * toPixels > threshold)
+        lod--;
+      while (lod + 1 < levels &&
+             mesh.lods[lod + 1].error * toPixels <= coarsenBelow)
+        lod++;
+      item.lod = lod;
+    }
+  });
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "renderer/uniforms.h"
+#include <cstdint>
+#include <span>
+
+struct RenderItem;
+class JobSystem;
+
+// Level of detail stage between culling and batching. Projects each level's
+// simplification error to pixels at the distance of the item's bounding
+// sphere and picks the coarsest level that stays under a threshold. Levels
+// stick: an item only coarsens once the next level is clearly under the
+// threshold, so items near a boundary do not pop back and forth.
+class LodSelector {
+public:
+  // Largest error in pixels a level may show, 0 always draws the full
+  // meshes
+  void setThreshold(float pixels) noexcept { threshold = pixels; }
+  float getThreshold() const noexcept { return threshold; }
+  // Fraction of the threshold a coarser level has to stay under before it
+  // replaces the current one
+  void setHysteresis(float fraction) noexcept { hysteresis = fraction; }
+
+  // Updates every item's lod for camera's view and projection, spread over
+  // jobs when given
+  void select(std::span<RenderItem *const> items, const CameraUBO &camera,
+              uint32_t viewportHeight, JobSystem *jobs = nullptr) const;
+
+private:
+  float threshold = 1.0f;
+  float hysteresis = 0.2f;
+};
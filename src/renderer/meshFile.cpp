@@ -0,0 +1,117 @@
+#include "renderer/meshFile.h"
+#include <stdexcept>
+
+namespace {
+// View of count elements of section, which must lie inside bytes and hold
+// exactly that many
+template <typename T>
+std::span<const T> sectionView(std::span<const std::byte> bytes,
+                               const MeshFileSection &section, uint64_t count,
+                               const std::string &path) {
+  if (section.offset % MeshFormat::SectionAlignment != 0 ||
+      section.offset > bytes.size() ||
+      section.size > bytes.size() - section.offset ||
+      section.size != count * sizeof(T))
+    throw std::runtime_error(path + ": corrupt section table");
+  return {reinterpret_cast<const T *>(bytes.data() + section.offset),
+          static_cast<size_t>(count)};
+}
+} // namespace
+
+MeshFile::MeshFile(const std::string &path) : file(path) {
+  std::span<const std::byte> bytes = file.getBytes();
+  if (bytes.size() < sizeof(MeshFileHeader))
+    throw std::runtime_error(path + ": truncated mesh file");
+
+  header = reinterpret_cast<const MeshFileHeader *>(bytes.data());
+  if (header->magic != MeshFormat::Magic)
+    throw std::runtime_error(path + ": not a cooked mesh");
+  if (header->version != MeshFormat::Version)
+    throw std::runtime_error(path + ": mesh format version " +
+                             std::to_string(header->version) +
+                             ", expected " +
+                             std::to_string(MeshFormat::Version));
+  try {
+    layout = VertexLayout::fromKey(header->vertexLayout);
+  } catch (const std::exception &e) {
+    throw std::runtime_error(path + ": " + e.what());
+  }
+  if (header->vertexStride != layout.getStride())
+    throw std::runtime_error(path + ": vertex stride does not match layout");
+
+  vertexData = sectionView<std::byte>(
+      bytes, header->vertices,
+      uint64_t{header->vertexCount} * header->vertexStride, path);
+  // Mixed index sizes, the submeshes are checked against it below
+  indexData = sectionView<std::byte>(bytes, header->indices,
+                                     header->indices.size, path);
+  bounds = sectionView<MeshFileBounds>(bytes, header->bounds,
+                                       uint64_t{header->submeshCount} + 1,
+                                       path);
+  submeshes = sectionView<MeshFileSubmesh>(bytes, header->submeshes,
+                                           header->submeshCount, path);
+  lods = sectionView<MeshFileLod>(bytes, header->lods, header->lodCount, path);
+  meshlets = sectionView<Meshlet>(bytes, header->meshlets,
+                                  header->meshletCount, path);
+
+  uint64_t indexCount = 0;
+  uint64_t shortIndexCount = 0;
+  for (const MeshFileSubmesh &submesh : submeshes) {
+    if (submesh.firstVertex > header->vertexCount ||
+        submesh.vertexCount > header->vertexCount - submesh.firstVertex ||
+        submesh.indexOffset > indexData.size() ||
+        uint64_t{submesh.indexCount} * submesh.indexSize >
+            indexData.size() - submesh.indexOffset)
+      throw std::runtime_error(path + ": submesh out of range");
+    if ((submesh.indexSize != sizeof(uint16_t) &&
+         submesh.indexSize != sizeof(uint32_t)) ||
+        submesh.indexOffset % submesh.indexSize != 0 ||
+        (submesh.indexSize == sizeof(uint16_t) &&
+         submesh.vertexCount > MeshFormat::MaxShortIndexVertices))
+      throw std::runtime_error(path + ": unsupported submesh index size");
+    if (submesh.lodCount == 0 || submesh.lodCount > MeshFormat::MaxLods ||
+        submesh.firstLod > lods.size() ||
+        submesh.lodCount > lods.size() - submesh.firstLod)
+      throw std::runtime_error(path + ": submesh levels out of range");
+    for (const MeshFileLod &lod : getLods(submesh)) {
+      if (lod.firstIndex > submesh.indexCount ||
+          lod.indexCount > submesh.indexCount - lod.firstIndex)
+        throw std::runtime_error(path + ": level of detail out of range");
+    }
+    if (submesh.firstMeshlet > meshlets.size() ||
+        submesh.meshletCount > meshlets.size() - submesh.firstMeshlet)
+      throw std::runtime_error(path + ": submesh meshlets out of range");
+    const MeshFileLod &full = getLods(submesh)[0];
+    uint64_t fullEnd = uint64_t{full.firstIndex} + full.indexCount;
+    for (const Meshlet &meshlet : getMeshlets(submesh)) {
+      if (meshlet.firstIndex < full.firstIndex ||
+          uint64_t{meshlet.firstIndex} + meshlet.indexCount > fullEnd)
+        throw std::runtime_error(path + ": meshlet out of range");
+    }
+    indexCount += submesh.indexCount;
+    if (submesh.indexSize == sizeof(uint16_t))
+      shortIndexCount += submesh.indexCount;
+  }
+  // The streamer budgets with the header's counts
+  if (indexCount != header->indexCount ||
+      shortIndexCount != header->shortIndexCount)
+    throw std::runtime_error(path + ": index counts do not add up");
+}
+
+std::span<const uint16_t>
+MeshFile::getShortIndices(const MeshFileSubmesh &submesh) const noexcept {
+  if (submesh.indexSize != sizeof(uint16_t))
+    return {};
+  return {reinterpret_cast<const uint16_t *>(indexData.data() +
+                                             submesh.indexOffset),
+          submesh.indexCount};
+}
+
+std::span<const uint32_t>
+MeshFile::getIndices(const MeshFileSubmesh &submesh) const noexcept {
+  if (submesh.indexSize != sizeof(uint32_t))
+    return {};
+  return {reinterpret_cast<const uint32_t *>(indexData.data() +
+                                             submesh.indexOffset),
+          submesh.indexCount};
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "core/mappedFile.h"
+#include "renderer/meshOptimizer.h"
+#include "renderer/vertexLayout.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Cooked mesh container written by mesh_cooker. Little endian; every
+// section starts on a SectionAlignment boundary so the runtime can use it
+// straight from a file mapping:
+//   MeshFileHeader
+//   vertices   vertexCount * vertexStride bytes in vertexLayout, the key of
+//              a VertexLayout; quantized positions are relative to the
+//              submesh's PositionBox from its bounds
+//   indices    each submesh's indices at its indexOffset, local to its
+//              first vertex: uint16_t when it has at most 65536 vertices,
+//              uint32_t otherwise. Every level of detail of the submesh
+//              follows the full one.
+//   bounds     MeshFileBounds[submeshCount + 1], the whole mesh first
+//   submeshes  MeshFileSubmesh[submeshCount]
+//   lods       MeshFileLod[lodCount], each submesh's finest first
+//   meshlets   Meshlet[meshletCount], clusters of each submesh's full level
+namespace MeshFormat {
+constexpr uint32_t Magic = 0x48534d53; // "SMSH"
+constexpr uint32_t Version = 5;
+constexpr uint64_t SectionAlignment = 64;
+// Submeshes with at most this many vertices store 16-bit indices
+constexpr uint32_t MaxShortIndexVertices = 1u << 16;
+// Levels per submesh, the full one included; the draw sort key has 3 bits
+constexpr uint32_t MaxLods = 8;
+} // namespace MeshFormat
+
+struct MeshFileSection {
+  uint64_t offset = 0;
+  uint64_t size = 0;
+};
+
+struct MeshFileHeader {
+  uint32_t magic = MeshFormat::Magic;
+  uint32_t version = MeshFormat::Version;
+  uint32_t vertexStride = 0;
+  // Indices stored as uint16_t, out of indexCount
+  uint32_t shortIndexCount = 0;
+  uint32_t vertexCount = 0;
+  uint32_t indexCount = 0;
+  uint32_t submeshCount = 0;
+  uint32_t vertexLayout = 0;
+  uint32_t lodCount = 0;
+  uint32_t meshletCount = 0;
+  MeshFileSection vertices;
+  MeshFileSection indices;
+  MeshFileSection bounds;
+  MeshFileSection submeshes;
+  MeshFileSection lods;
+  MeshFileSection meshlets;
+};
+
+// Same meaning as Bounds
+struct MeshFileBounds {
+  float center[3];
+  float radius;
+  float extents[3];
+  float pad;
+};
+
+// One draw's worth of geometry, its own vertex and index range
+struct MeshFileSubmesh {
+  uint32_t firstVertex = 0;
+  uint32_t vertexCount = 0;
+  // Bytes into the indices section, a multiple of indexSize
+  uint32_t indexOffset = 0;
+  // Of every level together
+  uint32_t indexCount = 0;
+  // 2 or 4
+  uint32_t indexSize = 0;
+  // At least one, the full submesh
+  uint32_t firstLod = 0;
+  uint32_t lodCount = 0;
+  // May be none, the submesh is then only drawn whole
+  uint32_t firstMeshlet = 0;
+  uint32_t meshletCount = 0;
+  uint32_t pad = 0;
+};
+
+// One level of detail of a submesh, an index range over its vertices
+struct MeshFileLod {
+  // Relative to the submesh's indices
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  // Object-space distance from the full submesh's surface, 0 for it
+  float error = 0.0f;
+  uint32_t pad = 0;
+};
+
+static_assert(sizeof(MeshFileHeader) == 136);
+static_assert(sizeof(MeshFileBounds) == 32);
+static_assert(sizeof(MeshFileSubmesh) == 40);
+static_assert(sizeof(MeshFileLod) == 16);
+
+// Mapped .mesh file. Only the header and section ranges are checked on
+// open; the sections are handed out as views into the mapping, valid for
+// the lifetime of this object.
+class MeshFile {
+public:
+  // Throws when the file is missing, truncated, of another version, in an
+  // unknown vertex layout or with indices out of range
+  explicit MeshFile(const std::string &path);
+
+  const MeshFileHeader &getHeader() const noexcept { return *header; }
+  const VertexLayout &getVertexLayout() const noexcept { return layout; }
+  std::span<const std::byte> getVertexData() const noexcept {
+    return vertexData;
+  }
+  // Indices of submesh, local to its first vertex. Only the view of its
+  // indexSize is non-empty.
+  std::span<const uint16_t>
+  getShortIndices(const MeshFileSubmesh &submesh) const noexcept;
+  std::span<const uint32_t>
+  getIndices(const MeshFileSubmesh &submesh) const noexcept;
+  std::span<const MeshFileBounds> getBounds() const noexcept {
+    return bounds;
+  }
+  std::span<const MeshFileSubmesh> getSubmeshes() const noexcept {
+    return submeshes;
+  }
+  std::span<const MeshFileLod>
+  getLods(const MeshFileSubmesh &submesh) const noexcept {
+    return lods.subspan(submesh.firstLod, submesh.lodCount);
+  }
+  // Index ranges relative to the submesh's indices, all in its full level
+  std::span<const Meshlet>
+  getMeshlets(const MeshFileSubmesh &submesh) const noexcept {
+    return meshlets.subspan(submesh.firstMeshlet, submesh.meshletCount);
+  }
+  // Reads the whole mapping in, see MappedFile::prefetch
+  void prefetch() const noexcept { file.prefetch(); }
+
+private:
+  MappedFile file;
+  const MeshFileHeader *header = nullptr;
+  VertexLayout layout;
+  std::span<const std::byte> vertexData;
+  std::span<const std::byte> indexData;
+  std::span<const MeshFileBounds> bounds;
+  std::span<const MeshFileSubmesh> submeshes;
+  std::span<const MeshFileLod> lods;
+  std::span<const Meshlet> meshlets;
+};
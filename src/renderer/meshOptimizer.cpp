@@ -0,0 +1,471 @@
+#include "renderer/meshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+// Forsyth's scoring, tuned for an LRU cache of this size
+constexpr uint32_t ForsythCacheSize = 32;
+constexpr float LastTriangleScore = 0.75f;
+constexpr float CacheDecayPower = 1.5f;
+constexpr float ValenceBoostScale = 2.0f;
+// Valences above this score like it, the boost is tiny by then
+constexpr uint32_t MaxScoredValence = 32;
+
+struct ScoreTables {
+  std::array<float, ForsythCacheSize> cache;
+  std::array<float, MaxScoredValence + 1> valence;
+};
+
+ScoreTables makeScoreTables() {
+  ScoreTables tables{};
+  for (uint32_t i = 0; i < ForsythCacheSize; i++) {
+    // The last triangle's vertices score the same, so no triangle is
+    // preferred for reusing an edge over another vertex of it
+    if (i < 3) {
+      tables.cache[i] = LastTriangleScore;
+    } else {
+      float scale = 1.0f / (ForsythCacheSize - 3);
+      tables.cache[i] = std::pow(1.0f - (i - 3) * scale, CacheDecayPower);
+    }
+  }
+  tables.valence[0] = 0.0f;
+  for (uint32_t i = 1; i <= MaxScoredValence; i++)
+    tables.valence[i] = ValenceBoostScale / std::sqrt(static_cast<float>(i));
+  return tables;
+}
+
+// Score of a vertex with remaining unemitted triangles at cachePosition,
+// -1 when not cached. Vertices with few triangles left score higher so
+// they get finished off and leave the cache.
+float vertexScore(const ScoreTables &tables, int cachePosition,
+                  uint32_t remaining) {
+  if (remaining == 0)
+    return -1.0f;
+  float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+  return score + tables.valence[std::min(remaining, MaxScoredValence)];
+}
+
+// FIFO cache simulation: a vertex is cached while fewer than cacheSize
+// misses happened since its own
+class FifoCache {
+public:
+  FifoCache(uint32_t vertexCount, uint32_t cacheSize)
+      : timestamps(vertexCount, 0), cacheSize(cacheSize),
+        time(cacheSize + 1) {}
+
+  // Misses of one triangle
+  uint32_t add(const uint32_t *triangle) {
+    uint32_t misses = 0;
+    for (int k = 0; k < 3; k++) {
+      uint32_t &stamp = timestamps[triangle[k]];
+      if (time - stamp > cacheSize) {
+        stamp = time++;
+        misses++;
+      }
+    }
+    return misses;
+  }
+
+  // Empties the cache without touching every vertex
+  void reset() { time += cacheSize + 1; }
+
+  // Vertices added at least once
+  uint64_t countSeen() const {
+    return std::count_if(timestamps.begin(), timestamps.end(),
+                         [](uint32_t stamp) { return stamp != 0; });
+  }
+
+private:
+  std::vector<uint32_t> timestamps;
+  uint32_t cacheSize;
+  uint32_t time;
+};
+
+using Vec3 = std::array<float, 3>;
+
+Vec3 loadPosition(const float *positions, size_t stride, uint32_t vertex) {
+  const float *p = reinterpret_cast<const float *>(
+      reinterpret_cast<const std::byte *>(positions) + vertex * stride);
+  return {p[0], p[1], p[2]};
+}
+} // namespace
+
+VertexCacheStats &
+VertexCacheStats::operator+=(const VertexCacheStats &other) noexcept {
+  triangles += other.triangles;
+  vertices += other.vertices;
+  transforms += other.transforms;
+  return *this;
+}
+
+float VertexCacheStats::getAcmr() const noexcept {
+  return triangles ? static_cast<float>(transforms) / triangles : 0.0f;
+}
+
+float VertexCacheStats::getAtvr() const noexcept {
+  return vertices ? static_cast<float>(transforms) / vertices : 0.0f;
+}
+
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices,
+                                    uint32_t vertexCount,
+                                    uint32_t cacheSize) {
+  VertexCacheStats stats;
+  FifoCache cache(vertexCount, cacheSize);
+  for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    stats.transforms += cache.add(&indices[i]);
+  stats.triangles = indices.size() / 3;
+  stats.vertices = cache.countSeen();
+  return stats;
+}
+
+void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount) {
+  const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+  if (triangleCount == 0)
+    return;
+  static const ScoreTables tables = makeScoreTables();
+
+  // Triangles of each vertex; the first remaining[v] of its slice are the
+  // ones not emitted yet
+  std::vector<uint32_t> remaining(vertexCount, 0);
+  for (uint32_t i = 0; i < triangleCount * 3; i++)
+    remaining[indices[i]]++;
+  std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+  for (uint32_t v = 0; v < vertexCount; v++)
+    firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+  std::vector<uint32_t> adjacency(triangleCount * 3);
+  {
+    std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (uint32_t i = 0; i < triangleCount * 3; i++)
+      adjacency[fill[indices[i]]++] = i / 3;
+  }
+
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> score(vertexCount);
+  for (uint32_t v = 0; v < vertexCount; v++)
+    score[v] = vertexScore(tables, -1, remaining[v]);
+
+  std::vector<float> triangleScore(triangleCount);
+  std::vector<bool> emitted(triangleCount, false);
+  for (uint32_t t = 0; t < triangleCount; t++) {
+    triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] +
+                       score[indices[t * 3 + 2]];
+  }
+
+  // Room for the full cache plus the three vertices pushing out of it
+  std::array<uint32_t, ForsythCacheSize + 3> cache{};
+  std::array<uint32_t, ForsythCacheSize + 3> nextCache{};
+  uint32_t cacheCount = 0;
+
+  std::vector<uint32_t> result;
+  result.reserve(triangleCount * 3);
+  uint32_t best = static_cast<uint32_t>(
+      std::max_element(triangleScore.begin(), triangleScore.end()) -
+      triangleScore.begin());
+  // Dead ends restart at the first triangle not emitted yet
+  uint32_t cursor = 0;
+
+  for (uint32_t emittedCount = 0; emittedCount < triangleCount;
+       emittedCount++) {
+    if (best == UINT32_MAX) {
+      while (emitted[cursor])
+        cursor++;
+      best = cursor;
+    }
+
+    const uint32_t *triangle = &indices[best * 3];
+    emitted[best] = true;
+    result.insert(result.end(), triangle, triangle + 3);
+
+    // Drop the triangle from its vertices' remaining lists
+    for (int k = 0; k < 3; k++) {
+      uint32_t v = triangle[k];
+      uint32_t *list = &adjacency[firstTriangle[v]];
+      uint32_t *last = list + remaining[v] - 1;
+      std::iter_swap(std::find(list, last, best), last);
+      remaining[v]--;
+    }
+
+    // The triangle's vertices move to the front, the rest keep their order
+    uint32_t nextCount = 0;
+    for (int k = 0; k < 3; k++)
+      nextCache[nextCount++] = triangle[k];
+    for (uint32_t i = 0; i < cacheCount; i++) {
+      uint32_t v = cache[i];
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+        nextCache[nextCount++] = v;
+    }
+
+    // Rescore everything whose position changed, including what fell out
+    for (uint32_t i = 0; i < nextCount; i++) {
+      uint32_t v = nextCache[i];
+      int position = i < ForsythCacheSize ? static_cast<int>(i) : -1;
+      cachePosition[v] = position;
+      float newScore = vertexScore(tables, position, remaining[v]);
+      float delta = newScore - score[v];
+      score[v] = newScore;
+      for (uint32_t j = 0; j < remaining[v]; j++)
+        triangleScore[adjacency[firstTriangle[v] + j]] += delta;
+    }
+    cacheCount = std::min(nextCount, ForsythCacheSize);
+    std::copy_n(nextCache.begin(), cacheCount, cache.begin());
+
+    // Only triangles touching the cache are worth continuing with
+    best = UINT32_MAX;
+    float bestScore = -1.0f;
+    for (uint32_t i = 0; i < cacheCount; i++) {
+      uint32_t v = cache[i];
+      for (uint32_t j = 0; j < remaining[v]; j++) {
+        uint32_t t = adjacency[firstTriangle[v] + j];
+        if (triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          best = t;
+        }
+      }
+    }
+  }
+
+  std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void optimizeOverdraw(std::span<uint32_t> indices, const float *positions,
+                      size_t positionStride, uint32_t vertexCount,
+                      float threshold) {
+  const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+  if (triangleCount < 2)
+    return;
+
+  // Hard cuts where the cache order already restarts: a triangle whose
+  // three vertices all miss
+  std::vector<uint32_t> hardCuts;
+  {
+    FifoCache cache(vertexCount, VertexCacheSize);
+    for (uint32_t t = 0; t < triangleCount; t++) {
+      if (cache.add(&indices[t * 3]) == 3 || t == 0)
+        hardCuts.push_back(t);
+    }
+  }
+  hardCuts.push_back(triangleCount);
+
+  // Soft cuts inside each hard cluster, once the running ACMR of the piece
+  // so far is within threshold of the whole cluster's
+  std::vector<uint32_t> cuts;
+  FifoCache cache(vertexCount, VertexCacheSize);
+  for (size_t c = 0; c + 1 < hardCuts.size(); c++) {
+    uint32_t start = hardCuts[c];
+    uint32_t end = hardCuts[c + 1];
+    cuts.push_back(start);
+
+    cache.reset();
+    uint32_t clusterMisses = 0;
+    for (uint32_t t = start; t < end; t++)
+      clusterMisses += cache.add(&indices[t * 3]);
+    float target = threshold * clusterMisses / (end - start);
+
+    cache.reset();
+    uint32_t misses = 0;
+    uint32_t pieceStart = start;
+    for (uint32_t t = start; t + 1 < end; t++) {
+      misses += cache.add(&indices[t * 3]);
+      if (static_cast<float>(misses) / (t + 1 - pieceStart) <= target) {
+        cuts.push_back(t + 1);
+        cache.reset();
+        misses = 0;
+        pieceStart = t + 1;
+      }
+    }
+  }
+  cuts.push_back(triangleCount);
+  const size_t clusterCount = cuts.size() - 1;
+  if (clusterCount < 2)
+    return;
+
+  // Area-weighted centroid and normal of each cluster and of the mesh
+  std::vector<Vec3> centroids(clusterCount, Vec3{});
+  std::vector<Vec3> normals(clusterCount, Vec3{});
+  std::vector<float> areas(clusterCount, 0.0f);
+  Vec3 meshCentroid{};
+  float meshArea = 0.0f;
+  for (size_t c = 0; c < clusterCount; c++) {
+    for (uint32_t t = cuts[c]; t < cuts[c + 1]; t++) {
+      Vec3 p0 = loadPosition(positions, positionStride, indices[t * 3]);
+      Vec3 p1 = loadPosition(positions, positionStride, indices[t * 3 + 1]);
+      Vec3 p2 = loadPosition(positions, positionStride, indices[t * 3 + 2]);
+      Vec3 e1{p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      Vec3 e2{p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      Vec3 n{e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+             e1[0] * e2[1] - e1[1] * e2[0]};
+      float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int k = 0; k < 3; k++) {
+        float center = (p0[k] + p1[k] + p2[k]) / 3.0f;
+        centroids[c][k] += center * area;
+        normals[c][k] += n[k];
+      }
+      areas[c] += area;
+    }
+    for (int k = 0; k < 3; k++)
+      meshCentroid[k] += centroids[c][k];
+    meshArea += areas[c];
+  }
+  if (meshArea > 0.0f) {
+    for (float &k : meshCentroid)
+      k /= meshArea;
+  }
+
+  // How far the cluster faces out from the center, larger draws earlier
+  std::vector<float> keys(clusterCount, 0.0f);
+  for (size_t c = 0; c < clusterCount; c++) {
+    if (areas[c] <= 0.0f)
+      continue;
+    const Vec3 &n = normals[c];
+    float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length <= 0.0f)
+      continue;
+    float dot = 0.0f;
+    for (int k = 0; k < 3; k++)
+      dot += (centroids[c][k] / areas[c] - meshCentroid[k]) * n[k];
+    keys[c] = dot / length;
+  }
+
+  std::vector<uint32_t> order(clusterCount);
+  for (uint32_t c = 0; c < clusterCount; c++)
+    order[c] = c;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+  std::vector<uint32_t> result;
+  result.reserve(triangleCount * 3);
+  for (uint32_t c : order) {
+    result.insert(result.end(), indices.begin() + cuts[c] * 3,
+                  indices.begin() + cuts[c + 1] * 3);
+  }
+  std::copy(result.begin(), result.end(), indices.begin());
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices,
+                                          uint32_t vertexCount) {
+  std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+  uint32_t next = 0;
+  for (uint32_t &index : indices) {
+    if (remap[index] == UINT32_MAX)
+      remap[index] = next++;
+    index = remap[index];
+  }
+  for (uint32_t &slot : remap) {
+    if (slot == UINT32_MAX)
+      slot = next++;
+  }
+  return remap;
+}
+
+namespace {
+// Normals spread wider than this around the axis give no usable cone
+constexpr float MinConeDot = 0.1f;
+
+void computeMeshletBounds(Meshlet &meshlet, std::span<const uint32_t> indices,
+                          const float *positions, size_t positionStride) {
+  std::span<const uint32_t> triangles =
+      indices.subspan(meshlet.firstIndex, meshlet.indexCount);
+
+  // Sphere around the box center, tight enough at this size
+  Vec3 lo{FLT_MAX, FLT_MAX, FLT_MAX};
+  Vec3 hi{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (uint32_t index : triangles) {
+    Vec3 p = loadPosition(positions, positionStride, index);
+    for (int k = 0; k < 3; k++) {
+      lo[k] = std::min(lo[k], p[k]);
+      hi[k] = std::max(hi[k], p[k]);
+    }
+  }
+  for (int k = 0; k < 3; k++)
+    meshlet.center[k] = (lo[k] + hi[k]) * 0.5f;
+  float radius2 = 0.0f;
+  for (uint32_t index : triangles) {
+    Vec3 p = loadPosition(positions, positionStride, index);
+    float d2 = 0.0f;
+    for (int k = 0; k < 3; k++)
+      d2 += (p[k] - meshlet.center[k]) * (p[k] - meshlet.center[k]);
+    radius2 = std::max(radius2, d2);
+  }
+  meshlet.radius = std::sqrt(radius2);
+
+  // Unit normals of the non-degenerate triangles, the axis is their mean
+  std::vector<Vec3> normals;
+  Vec3 axis{};
+  for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+    Vec3 p0 = loadPosition(positions, positionStride, triangles[t]);
+    Vec3 p1 = loadPosition(positions, positionStride, triangles[t + 1]);
+    Vec3 p2 = loadPosition(positions, positionStride, triangles[t + 2]);
+    Vec3 e1{p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    Vec3 e2{p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    Vec3 n{e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+           e1[0] * e2[1] - e1[1] * e2[0]};
+    float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length < 1e-20f)
+      continue;
+    for (int k = 0; k < 3; k++) {
+      n[k] /= length;
+      axis[k] += n[k];
+    }
+    normals.push_back(n);
+  }
+  float axisLength =
+      std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+  if (normals.empty() || axisLength < 1e-6f)
+    return;
+
+  float minDot = 1.0f;
+  for (int k = 0; k < 3; k++)
+    axis[k] /= axisLength;
+  for (const Vec3 &n : normals)
+    minDot = std::min(minDot, n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]);
+  if (minDot <= MinConeDot)
+    return;
+
+  for (int k = 0; k < 3; k++)
+    meshlet.coneAxis[k] = axis[k];
+  // With the normals within angle a of the axis, all of them face away
+  // from view directions within 90 - a of it, and cos(90 - a) = sin(a)
+  meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+} // namespace
+
+std::vector<Meshlet> buildMeshlets(std::span<const uint32_t> indices,
+                                   const float *positions,
+                                   size_t positionStride,
+                                   uint32_t vertexCount) {
+  std::vector<Meshlet> meshlets;
+  // Meshlet number + 1 a vertex was last counted for
+  std::vector<uint32_t> owner(vertexCount, 0);
+  uint32_t vertices = 0;
+
+  const auto indexCount = static_cast<uint32_t>(indices.size() / 3 * 3);
+  for (uint32_t i = 0; i < indexCount; i += 3) {
+    uint32_t id = static_cast<uint32_t>(meshlets.size());
+    uint32_t added = 0;
+    if (!meshlets.empty()) {
+      for (int k = 0; k < 3; k++)
+        added += owner[indices[i + k]] != id;
+    }
+    if (meshlets.empty() || vertices + added > MaxMeshletVertices ||
+        meshlets.back().indexCount == MaxMeshletTriangles * 3) {
+      meshlets.push_back({});
+      meshlets.back().firstIndex = i;
+      vertices = 0;
+      id++;
+    }
+    for (int k = 0; k < 3; k++) {
+      uint32_t &vertex = owner[indices[i + k]];
+      if (vertex != id) {
+        vertex = id;
+        vertices++;
+      }
+    }
+    meshlets.back().indexCount += 3;
+  }
+
+  for (Meshlet &meshlet : meshlets)
+    computeMeshletBounds(meshlet, indices, positions, positionStride);
+  return meshlets;
+}
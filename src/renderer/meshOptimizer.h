@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Triangle and vertex reordering for indexed triangle lists, shared by the
+// cooker and the renderer's runtime mesh creation. Indices are local to the
+// mesh: every one is below vertexCount. The passes are meant to run in
+// order: vertex cache, overdraw, vertex fetch.
+
+// Post-transform vertex cache behaviour of an index buffer, simulated with
+// a FIFO cache. Counts add up over several meshes.
+struct VertexCacheStats {
+  uint64_t triangles = 0;
+  // Distinct vertices the indices reference
+  uint64_t vertices = 0;
+  // Cache misses, each one a vertex shader invocation
+  uint64_t transforms = 0;
+
+  VertexCacheStats &operator+=(const VertexCacheStats &other) noexcept;
+
+  // Average cache miss ratio: transforms per triangle, 3 at worst and
+  // approaching 0.5 on a regular grid
+  float getAcmr() const noexcept;
+  // Average transform to vertex ratio: transforms per vertex, 1 at best
+  float getAtvr() const noexcept;
+};
+
+// Default FIFO size for analyzeVertexCache, conservative for current GPUs
+constexpr uint32_t VertexCacheSize = 16;
+
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices,
+                                    uint32_t vertexCount,
+                                    uint32_t cacheSize = VertexCacheSize);
+
+// Reorders triangles so consecutive ones share vertices, Forsyth's
+// linear-speed vertex cache optimization
+void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount);
+
+// Reorders a vertex cache optimized triangle list to reduce overdraw. The
+// list is cut into clusters where the cache order allows, and clusters that
+// face away from the mesh center are drawn first, as they tend to occlude
+// the rest (Sander et al., "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw"). Cuts may raise the ACMR by up to threshold times.
+// positions points at vertexCount xyz float triples, positionStride bytes
+// apart.
+void optimizeOverdraw(std::span<uint32_t> indices, const float *positions,
+                      size_t positionStride, uint32_t vertexCount,
+                      float threshold = 1.05f);
+
+// Renumbers vertices in the order the indices first use them, so vertex
+// fetch walks memory forward, and rewrites the indices to match. Returns
+// remap with remap[old] = new; unreferenced vertices go last.
+std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices,
+                                          uint32_t vertexCount);
+
+// Moves vertices[v] to vertices[remap[v]]
+template <typename T>
+void remapVertices(std::span<T> vertices, std::span<const uint32_t> remap) {
+  std::vector<T> copy(vertices.begin(), vertices.end());
+  for (size_t v = 0; v < copy.size(); v++)
+    vertices[remap[v]] = std::move(copy[v]);
+}
+
+// Meshlet limits, the usual mesh shader sizes. Clusters are drawn as index
+// ranges, so the limits only shape them: small enough to cull finely, big
+// enough that a draw record per cluster stays cheap.
+constexpr uint32_t MaxMeshletVertices = 64;
+constexpr uint32_t MaxMeshletTriangles = 124;
+
+// A cluster of consecutive triangles with its culling bounds. Same layout
+// in the cooked file and in the GPU's meshlet buffer (std430).
+struct Meshlet {
+  // Object-space bounding sphere
+  float center[3] = {};
+  float radius = 0.0f;
+  // Unit axis of the cone around the triangle normals and a cutoff: every
+  // triangle faces away from a viewer at offset -d from the center when
+  // dot(d, axis) >= coneCutoff * length(d) + radius. 1 never culls.
+  float coneAxis[3] = {};
+  float coneCutoff = 1.0f;
+  // Relative to the mesh's indices
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  uint32_t pad[2] = {};
+};
+
+static_assert(sizeof(Meshlet) == 48);
+
+// Splits an index buffer into meshlets in its current triangle order, so
+// the indices stay as they are; run it after the passes above, whose
+// locality keeps the clusters compact.
+std::vector<Meshlet> buildMeshlets(std::span<const uint32_t> indices,
+                                   const float *positions,
+                                   size_t positionStride,
+                                   uint32_t vertexCount);
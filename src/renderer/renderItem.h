@@ -1,56 +1,55 @@
 #pragma once
-#include "renderer/uniforms.h"
-#include "rhi/vulkan/buffer.h"
-#include "rhi/vulkan/descriptor.h"
+#include "renderer/bounds.h"
+#include "rhi/vulkan/geometryPool.h"
 #include <glm/glm.hpp>
 #include <memory>
+#include <vector>
+
+// Index range of one level of detail, relative to the mesh's geometry
+struct MeshLod {
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  // Object-space distance from the full mesh's surface
+  float error = 0.0f;
+};
 
 struct Mesh {
-  Buffer vertexBuffer;
-  Buffer indexBuffer;
-  uint32_t indexCount;
-
-  Mesh(Device &device, VkCommandPool pool)
-      : vertexBuffer(device, pool), indexBuffer(device, pool), indexCount(0) {}
+  // Location in the renderer's shared GeometryPool
+  GeometryRange geometry;
+  // Finest first, the full mesh at level 0; never empty once uploaded
+  std::vector<MeshLod> lods;
+  // Object space, computed at upload
+  Bounds bounds;
+  // Dequantizes positions stored relative to the bounds; identity when
+  // the layout keeps float positions
+  PositionBox positionBox;
+  // Draws wait on this before reading the geometry for the first time
+  UploadTicket upload;
+  // Mesh field of the draw sort key, assigned by the renderer
+  uint16_t sortId = 0;
+  // False while a streamed mesh is not loaded or evicted; drawFrame skips
+  // items using it
+  bool resident = true;
+  // Renderer frame number of the last drawFrame that had it in view, 0
+  // when never. Stamped through the items' const pointers.
+  mutable uint64_t lastUsedFrame = 0;
 };
 
-struct Material {};
+struct Material {
+  // Material field of the draw sort key, assigned by the renderer
+  uint16_t sortId = 0;
+  // Drawn after opaque items, back-to-front
+  bool transparent = false;
+};
 
 struct RenderItem {
   const Mesh *mesh = nullptr;
   Material *material = nullptr;
   glm::mat4 transform = glm::mat4(1.0f);
+  // Level of detail drawn, kept across frames by the LOD selection stage
+  uint32_t lod = 0;
 
-  Buffer modelBuffer;
-  std::unique_ptr<DescriptorSet> descriptorSet;
-
-  RenderItem(Device &device, VkCommandPool pool) : modelBuffer(device, pool) {}
-
-  void init(Device &device, VkDescriptorSetLayout layout,
-            uint32_t framesInFlight, VkBuffer cameraBuffer,
-            VkDeviceSize cameraSize) {
-    modelBuffer.create(sizeof(ModelUBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    descriptorSet =
-        std::make_unique<DescriptorSet>(device, layout, framesInFlight);
-
-    for (uint32_t i = 0; i < framesInFlight; ++i) {
-      descriptorSet->update(i, cameraBuffer, cameraSize, modelBuffer.get(),
-                            sizeof(ModelUBO));
-    }
-  }
-
-  void update(uint32_t frameIndex, VkBuffer cameraBuffer,
-              VkDeviceSize cameraSize) {
-    ModelUBO ubo{};
-    ubo.model = transform;
-    modelBuffer.upload(&ubo, sizeof(ModelUBO));
-
-    descriptorSet->update(frameIndex, cameraBuffer, cameraSize,
-                          modelBuffer.get(), sizeof(ModelUBO));
-  }
+  RenderItem() = default;
 
   RenderItem(const RenderItem &) = delete;
   RenderItem &operator=(const RenderItem &) = delete;
@@ -0,0 +1,128 @@
+#include "renderer/renderQueue.h"
+#include "core/jobSystem.h"
+#include "renderer/renderItem.h"
+#include <algorithm>
+#include <bit>
+
+namespace {
+constexpr uint32_t DepthBits = 22;
+constexpr uint32_t LodBits = 3;
+constexpr uint32_t DigitBits = 8;
+constexpr uint32_t Buckets = 1u << DigitBits;
+constexpr uint32_t Digits = 64 / DigitBits;
+} // namespace
+
+uint32_t SortKey::quantizeDepth(float viewDepth) {
+  // Non-negative IEEE floats order like their bit patterns; keep the top
+  // 22 of the 31 magnitude bits
+  float depth = std::max(viewDepth, 0.0f);
+  return std::bit_cast<uint32_t>(depth) >> (31 - DepthBits);
+}
+
+uint64_t SortKey::make(RenderPass pass, uint32_t pipeline, uint32_t material,
+                       uint32_t mesh, uint32_t lod, float viewDepth) {
+  uint64_t state = (uint64_t{pipeline & 0xff} << 32) |
+                   (uint64_t{material & 0xffff} << 16) | (mesh & 0xffff);
+  uint64_t depth = quantizeDepth(viewDepth);
+  uint64_t key = uint64_t{static_cast<uint32_t>(pass)} << 62;
+
+  if (pass == RenderPass::Transparent) {
+    // Farthest first
+    depth = ~depth & ((1u << DepthBits) - 1);
+    return key | (depth << 40) | state;
+  }
+  // The level takes the lowest depth bits, opaque order only needs to be
+  // roughly front-to-back
+  uint64_t level = lod & ((1u << LodBits) - 1);
+  return key | (state << DepthBits) | (level << (DepthBits - LodBits)) |
+         (depth >> LodBits);
+}
+
+uint16_t SortIds::acquire() {
+  if (!freeIds.empty()) {
+    uint16_t id = freeIds.back();
+    freeIds.pop_back();
+    return id;
+  }
+  if (next < Count)
+    return static_cast<uint16_t>(next++);
+  shared++;
+  return static_cast<uint16_t>(Count - 1);
+}
+
+void SortIds::release(uint16_t id) {
+  if (id == Count - 1 && shared > 0)
+    shared--;
+  else
+    freeIds.push_back(id);
+}
+
+std::span<const uint32_t>
+RenderQueue::sort(std::span<RenderItem *const> items, const glm::mat4 &view,
+                  JobSystem *jobs) {
+  keys.resize(items.size());
+  order.resize(items.size());
+
+  // Distance along the view direction of the bounds center
+  glm::vec4 depthRow(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+
+  uint32_t count = static_cast<uint32_t>(items.size());
+  parallelFor(jobs, count, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      const RenderItem &item = *items[i];
+      glm::vec4 center =
+          item.transform * glm::vec4(item.mesh->bounds.center, 1.0f);
+
+      RenderPass pass = item.material && item.material->transparent
+                            ? RenderPass::Transparent
+                            : RenderPass::Opaque;
+      uint32_t material = item.material ? item.material->sortId : 0;
+      // A single graphics pipeline for now; the field orders by index
+      // type instead, so each index buffer is bound once for opaque items
+      uint32_t pipeline =
+          item.mesh->geometry.indexType == VK_INDEX_TYPE_UINT16 ? 0 : 1;
+      keys[i] = SortKey::make(pass, pipeline, material, item.mesh->sortId,
+                              item.lod, glm::dot(depthRow, center));
+      order[i] = i;
+    }
+  });
+
+  radixSort();
+  return order;
+}
+
+void RenderQueue::radixSort() {
+  size_t count = keys.size();
+  keysScratch.resize(count);
+  orderScratch.resize(count);
+
+  uint32_t histograms[Digits][Buckets] = {};
+  for (uint64_t key : keys) {
+    for (uint32_t d = 0; d < Digits; d++)
+      histograms[d][(key >> (d * DigitBits)) & (Buckets - 1)]++;
+  }
+
+  for (uint32_t d = 0; d < Digits; d++) {
+    uint32_t *histogram = histograms[d];
+    // Every key has the same digit here, the pass would not move anything
+    if (count == 0 ||
+        histogram[(keys[0] >> (d * DigitBits)) & (Buckets - 1)] == count)
+      continue;
+
+    uint32_t offset = 0;
+    for (uint32_t b = 0; b < Buckets; b++) {
+      uint32_t n = histogram[b];
+      histogram[b] = offset;
+      offset += n;
+    }
+
+    // Stable scatter, so lower digits keep their order
+    for (size_t i = 0; i < count; i++) {
+      uint32_t slot = histogram[(keys[i] >> (d * DigitBits)) & (Buckets - 1)]++;
+      keysScratch[slot] = keys[i];
+      orderScratch[slot] = order[i];
+    }
+    keys.swap(keysScratch);
+    order.swap(orderScratch);
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+struct RenderItem;
+class JobSystem;
+
+enum class RenderPass : uint32_t { Opaque, Transparent };
+
+// 64-bit draw order key, most significant field first:
+//   opaque:      pass:2 | pipeline:8 | material:16 | mesh:16 | lod:3 |
+//                depth:19
+//   transparent: pass:2 | depth:22 | pipeline:8 | material:16 | mesh:16
+// Opaque items group by state and go front-to-back inside a group;
+// transparent items go strictly back-to-front and only batch by accident.
+namespace SortKey {
+uint64_t make(RenderPass pass, uint32_t pipeline, uint32_t material,
+              uint32_t mesh, uint32_t lod, float viewDepth);
+// 22-bit depth that orders like the distance, no near/far needed
+uint32_t quantizeDepth(float viewDepth);
+} // namespace SortKey
+
+// Hands out the 16-bit material and mesh fields of the keys. Released ids
+// are reused first; once all are taken every further one shares the last
+// id, which only costs batching since batches compare the meshes and
+// materials themselves.
+class SortIds {
+public:
+  uint16_t acquire();
+  void release(uint16_t id);
+
+private:
+  static constexpr uint32_t Count = 1u << 16;
+
+  std::vector<uint16_t> freeIds;
+  uint32_t next = 0;
+  // Holders of the last id beyond the first
+  uint32_t shared = 0;
+};
+
+// Sort stage between culling and batching. Builds a key per item and radix
+// sorts them; the result is the order items are batched and drawn in.
+class RenderQueue {
+public:
+  // Indices into items in draw order, valid until the next sort. Keys are
+  // built on jobs when given, the sort itself runs on this thread.
+  std::span<const uint32_t> sort(std::span<RenderItem *const> items,
+                                 const glm::mat4 &view,
+                                 JobSystem *jobs = nullptr);
+
+private:
+  // LSD radix sort of keys/order by 8-bit digits, skipping digits every
+  // key shares
+  void radixSort();
+
+  std::vector<uint64_t> keys, keysScratch;
+  std::vector<uint32_t> order, orderScratch;
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+// Counters for the last recorded frame
+struct RenderStats {
+  uint32_t itemsSubmitted = 0;
+  // Over every submitted instance at its level of detail, before any GPU
+  // culling
+  uint64_t trianglesSubmitted = 0;
+  // Items rejected by CPU frustum culling before batching
+  uint32_t itemsCulled = 0;
+  // Meshlets of the instances drawn per meshlet, before cluster culling
+  uint32_t meshletsSubmitted = 0;
+  // Items skipped because their streamed mesh is not resident
+  uint32_t itemsNotResident = 0;
+  // Draw records, one per batch, whether direct or indirect
+  uint32_t drawCalls = 0;
+  // vkCmdDraw*Indirect* calls issued for those records
+  uint32_t indirectCalls = 0;
+  uint32_t descriptorWrites = 0;
+};
@@ -1,76 +1,488 @@
 #include "renderer/renderer.h"
+#include "core/jobSystem.h"
+#include "core/profiler.h"
 #include "helper.h"
+#include "renderer/meshFile.h"
+#include "renderer/meshOptimizer.h"
+#include "renderer/renderItem.h"
 #include "rhi/vulkan/commandContext.h"
+#include "rhi/vulkan/commandWorkers.h"
 #include "rhi/vulkan/device.h"
+#include "rhi/vulkan/gpuProfiler.h"
+#include "rhi/vulkan/offscreenTarget.h"
 #include "rhi/vulkan/renderRecorder.h"
 #include "rhi/vulkan/swapchain.h"
+#include <algorithm>
+#include <stdexcept>
 
-Renderer::Renderer(Device &device, Swapchain &swapchain,
-                   CommandContext &commands, RenderRecorder &recorder,
-                   Frame &frame)
-    : device(device), swapchain(swapchain), commands(commands),
-      recorder(recorder), frame(frame) {}
+namespace {
+// World units the residency test reaches past the view. With GPU culling
+// every item is still submitted and the GPU tests the same spheres, so a
+// mesh it draws must never be one the CPU saw outside and let be evicted.
+constexpr float ResidencyMargin = 0.01f;
+} // namespace
+
+Renderer::Renderer(Device &device, Swapchain *swapchain,
+                   OffscreenTarget *offscreen, CommandContext &commands,
+                   RenderRecorder &recorder, Frame &frame,
+                   uint32_t maxObjects)
+    : device(device), swapchain(swapchain), offscreen(offscreen),
+      commands(commands), recorder(recorder), frame(frame),
+      uniformRing(device, frame.getMaxFramesInFlight()),
+      objectRing(device, frame.getMaxFramesInFlight(),
+                 VkDeviceSize{maxObjects} * sizeof(ObjectData)),
+      // At most one batch per object, twice with occlusion culling, plus
+      // room for the aligned count
+      drawRing(device, frame.getMaxFramesInFlight(),
+               VkDeviceSize{maxObjects} * 2 *
+                       sizeof(VkDrawIndexedIndirectCommand) +
+                   1024,
+               VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT),
+      drawRange(VkDeviceSize{maxObjects} *
+                sizeof(VkDrawIndexedIndirectCommand)),
+      descriptors(device, frame.getMaxFramesInFlight()),
+      uploads(device),
+      // Meshes are stored in the layout the pipeline reads
+      geometry(device, commands.getPool(), uploads,
+               recorder.getPipeline().getVertexLayout()),
+      culler(device, frame.getMaxFramesInFlight(), maxObjects),
+      meshletCuller(device, frame.getMaxFramesInFlight(),
+                    culler.getPyramid()) {
+  setIndirect(true);
+}
+
+Renderer::~Renderer() {
+  // Copies still in flight write into the geometry pool, which goes first
+  uploads.waitIdle();
+}
+
+void Renderer::setRecordThreads(uint32_t count) {
+  recorder.setCommandWorkers(nullptr);
+  // Drops the old pools once the device is idle
+  workers.reset();
+  if (count == 0)
+    return;
+  workers = std::make_unique<CommandWorkers>(device, count,
+                                             frame.getMaxFramesInFlight());
+  recorder.setCommandWorkers(workers.get());
+}
+
+void Renderer::setIndirect(bool enabled) noexcept {
+  const DeviceFeatures &features = device.getFeatures();
+  indirect = enabled && features.multiDrawIndirect &&
+             features.drawIndirectFirstInstance;
+}
+
+void Renderer::setProfiler(GpuProfiler *gpuProfiler) noexcept {
+  profiler = gpuProfiler;
+  recorder.setProfiler(gpuProfiler);
+}
+
+std::unique_ptr<Mesh> Renderer::createMesh(std::span<const Vertex> vertices,
+                                           std::span<const uint32_t> indices) {
+  const VertexLayout &layout = geometry.getLayout();
+  // Zeroed normals and tangents would light wrong without any error
+  if (layout.has(VertexAttribute::Normal) ||
+      layout.has(VertexAttribute::Tangent) || layout.has(VertexAttribute::Uv))
+    throw std::runtime_error("vertex layout needs attributes Vertex does "
+                             "not carry, cook the mesh instead");
+
+  auto mesh = std::make_unique<Mesh>();
+  mesh->bounds = computeBounds(vertices);
+  if (layout.isPositionQuantized()) {
+    mesh->positionBox =
+        makePositionBox(&mesh->bounds.center.x, &mesh->bounds.extents.x);
+  }
+
+  // The cooker's passes, cheap at the sizes built at runtime
+  const auto vertexCount = static_cast<uint32_t>(vertices.size());
+  std::vector<uint32_t> ordered(indices.begin(), indices.end());
+  optimizeVertexCache(ordered, vertexCount);
+  optimizeOverdraw(ordered, vertices.empty() ? nullptr : &vertices[0].pos.x,
+                   sizeof(Vertex), vertexCount);
+  std::vector<uint32_t> remap = optimizeVertexFetch(ordered, vertexCount);
+
+  // Staged right away, so the encoded copy only lives for this call
+  VertexEncoder encoder(layout);
+  encoder.setPositionBox(mesh->positionBox);
+  std::vector<std::byte> encoded(vertices.size() * layout.getStride());
+  std::vector<glm::vec3> positions(vertices.size());
+  for (size_t i = 0; i < vertices.size(); i++) {
+    std::byte *vertex = encoded.data() + remap[i] * layout.getStride();
+    encoder.write(vertex, VertexAttribute::Position, &vertices[i].pos.x);
+    encoder.write(vertex, VertexAttribute::Color, &vertices[i].color.x);
+    positions[remap[i]] = vertices[i].pos;
+  }
+  std::vector<Meshlet> meshlets =
+      buildMeshlets(ordered, positions.empty() ? nullptr : &positions[0].x,
+                    sizeof(glm::vec3), vertexCount);
+
+  if (vertexCount <= MeshFormat::MaxShortIndexVertices) {
+    std::vector<uint16_t> shortIndices(ordered.begin(), ordered.end());
+    mesh->geometry = geometry.upload(encoded, shortIndices, mesh->upload);
+  } else {
+    mesh->geometry = geometry.upload(encoded, ordered, mesh->upload);
+  }
+  geometry.uploadMeshlets(mesh->geometry, meshlets, mesh->upload);
+  mesh->lods = {{0, mesh->geometry.indexCount, 0.0f}};
+  mesh->sortId = meshIds.acquire();
+  return mesh;
+}
+
+std::vector<std::unique_ptr<Mesh>>
+Renderer::createMeshes(const MeshFile &file) {
+  std::vector<std::unique_ptr<Mesh>> meshes;
+  meshes.reserve(file.getSubmeshes().size());
+  for (size_t i = 0; i < file.getSubmeshes().size(); i++)
+    meshes.push_back(std::make_unique<Mesh>());
+  uploadMeshes(file, meshes);
+  return meshes;
+}
+
+void Renderer::uploadMeshes(const MeshFile &file,
+                            std::span<const std::unique_ptr<Mesh>> meshes) {
+  const VertexLayout &layout = geometry.getLayout();
+  if (!(file.getVertexLayout() == layout))
+    throw std::runtime_error("cooked vertex layout does not match the "
+                             "renderer's, recook the mesh");
+  if (meshes.size() != file.getSubmeshes().size())
+    throw std::runtime_error("cooked mesh submesh count changed");
+
+  // Read in place, the upload queue copies straight into staging
+  std::span<const std::byte> vertexData = file.getVertexData();
+  const size_t stride = layout.getStride();
+
+  for (size_t i = 0; i < meshes.size(); i++) {
+    const MeshFileSubmesh &submesh = file.getSubmeshes()[i];
+    const MeshFileBounds &bounds = file.getBounds()[i + 1];
+
+    Mesh &mesh = *meshes[i];
+    try {
+      std::span<const std::byte> vertices = vertexData.subspan(
+          submesh.firstVertex * stride, submesh.vertexCount * stride);
+      if (submesh.indexSize == sizeof(uint16_t)) {
+        mesh.geometry = geometry.upload(
+            vertices, file.getShortIndices(submesh), mesh.upload);
+      } else {
+        mesh.geometry =
+            geometry.upload(vertices, file.getIndices(submesh), mesh.upload);
+      }
+      geometry.uploadMeshlets(mesh.geometry, file.getMeshlets(submesh),
+                              mesh.upload);
+    } catch (...) {
+      // All or nothing, the pool may be out of space
+      mesh.resident = false;
+      for (size_t j = 0; j < i; j++)
+        releaseMesh(*meshes[j]);
+      throw;
+    }
+    mesh.lods.clear();
+    for (const MeshFileLod &lod : file.getLods(submesh))
+      mesh.lods.push_back({lod.firstIndex, lod.indexCount, lod.error});
+    mesh.bounds.center = {bounds.center[0], bounds.center[1],
+                          bounds.center[2]};
+    mesh.bounds.radius = bounds.radius;
+    mesh.bounds.extents = {bounds.extents[0], bounds.extents[1],
+                           bounds.extents[2]};
+    // Same derivation as the cooker's, from the stored bounds
+    mesh.positionBox = layout.isPositionQuantized()
+                           ? makePositionBox(bounds.center, bounds.extents)
+                           : PositionBox{};
+    // Rolled back with the geometry if a later submesh throws
+    mesh.sortId = meshIds.acquire();
+    mesh.resident = true;
+  }
+}
+
+void Renderer::releaseMesh(Mesh &mesh) {
+  if (!mesh.resident)
+    return;
+  geometry.free(mesh.geometry);
+  mesh.geometry = {};
+  mesh.upload = {};
+  meshIds.release(mesh.sortId);
+  mesh.resident = false;
+}
+
+std::unique_ptr<Material> Renderer::createMaterial(bool transparent) {
+  auto material = std::make_unique<Material>();
+  material->sortId = materialIds.acquire();
+  material->transparent = transparent;
+  return material;
+}
+
+void Renderer::buildBatches(std::span<RenderItem *> items,
+                            const glm::mat4 &view, FrameData &frameData) {
+  // Sort keys group by pipeline, material, mesh and level, then depth
+  drawOrder = renderQueue.sort(items, view, jobs);
+
+  // Always hand out at least one entry so the binding stays valid
+  size_t count = std::max<size_t>(items.size(), 1);
+  frameData.objects = objectRing.allocate(count * sizeof(ObjectData));
+  auto *objects = static_cast<ObjectData *>(frameData.objects.ptr);
+  frameData.instances = frameData.objects;
+  frameData.instanceRange = frameData.objectRange;
+
+  // Each group's transforms end up contiguous, one instanced draw per group
+  uint32_t itemCount = static_cast<uint32_t>(drawOrder.size());
+  parallelFor(jobs, itemCount, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t slot = begin; slot < end; slot++) {
+      const RenderItem &item = *items[drawOrder[slot]];
+      const PositionBox &box = item.mesh->positionBox;
+      objects[slot].model = item.transform;
+      objects[slot].positionOffset = {box.offset[0], box.offset[1],
+                                      box.offset[2], 0.0f};
+      objects[slot].positionScale = {box.scale[0], box.scale[1],
+                                     box.scale[2], 0.0f};
+    }
+  });
+
+  batches.clear();
+  for (uint32_t slot = 0; slot < itemCount; slot++) {
+    const RenderItem &item = *items[drawOrder[slot]];
+    if (batches.empty() || batches.back().mesh != item.mesh ||
+        batches.back().material != item.material ||
+        batches.back().lod != item.lod) {
+      batches.push_back({item.mesh, item.material, item.lod, slot, 0});
+    }
+    batches.back().instanceCount++;
+  }
+}
+
+void Renderer::writeDrawCommands(FrameData &frameData) {
+  uint32_t count = static_cast<uint32_t>(batches.size());
+
+  // Records first so they start the partition and fit the bound range
+  frameData.drawCommands = drawRing.allocate(
+      std::max<size_t>(count, 1) * sizeof(VkDrawIndexedIndirectCommand));
+  frameData.drawCount = drawRing.push(count);
+  frameData.drawRange = drawRange;
+  frameData.maxDraws = count;
+  frameData.useDrawCount = device.getFeatures().drawIndirectCount;
+
+  auto *records =
+      static_cast<VkDrawIndexedIndirectCommand *>(frameData.drawCommands.ptr);
+  for (uint32_t i = 0; i < count; i++) {
+    const GeometryRange &range = batches[i].mesh->geometry;
+    const MeshLod &lod = batches[i].mesh->lods[batches[i].lod];
+    records[i].indexCount = lod.indexCount;
+    records[i].instanceCount = batches[i].instanceCount;
+    records[i].firstIndex = range.firstIndex + lod.firstIndex;
+    records[i].vertexOffset = range.vertexOffset;
+    records[i].firstInstance = batches[i].firstInstance;
+  }
+
+  // The culler fills these in from the early records
+  if (isOcclusionCulling()) {
+    frameData.lateDrawCommands = drawRing.allocate(
+        std::max<size_t>(count, 1) * sizeof(VkDrawIndexedIndirectCommand));
+  }
+}
 
 RenderResult Renderer::drawFrame(std::span<RenderItem *> items,
                                  Camera &camera) {
+  PROFILE_SCOPE("Renderer::drawFrame");
+
   auto &fence = frame.getInFlightFence(currentFrame);
-  vkWaitForFences(device.getLogical(), 1, &fence, VK_TRUE, UINT64_MAX);
+  {
+    PROFILE_SCOPE("fence wait");
+    vkWaitForFences(device.getLogical(), 1, &fence, VK_TRUE, UINT64_MAX);
+  }
 
-  uint32_t imageIndex;
-  VkResult res = vkAcquireNextImageKHR(
-      device.getLogical(), swapchain.getSwapchain(), UINT64_MAX,
-      frame.getImageAvailableSemaphore(currentFrame), VK_NULL_HANDLE,
-      &imageIndex);
+  // This slot's previous submission is done, its timestamps are readable
+  if (profiler)
+    profiler->collect(currentFrame);
+  // Everything created since the last frame goes out as one batch
+  uploads.collect();
+  uploads.flush();
 
-  if (res == VK_ERROR_OUT_OF_DATE_KHR)
-    return RenderResult::SwapchainOutOfDate;
+  // Offscreen images are owned one-to-one by frames in flight, so the
+  // fence above already guarantees the slot is free.
+  uint32_t imageIndex = currentFrame;
+  if (swapchain) {
+    PROFILE_SCOPE("acquire");
+    VkResult res = vkAcquireNextImageKHR(
+        device.getLogical(), swapchain->getSwapchain(), UINT64_MAX,
+        frame.getImageAvailableSemaphore(currentFrame), VK_NULL_HANDLE,
+        &imageIndex);
 
-  if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR)
-    return RenderResult::FatalError;
+    if (res == VK_ERROR_OUT_OF_DATE_KHR)
+      return RenderResult::SwapchainOutOfDate;
 
-  // Wait if this image is already in flight
-  VkFence &imageFence = frame.getImageInFlight(imageIndex);
-  if (imageFence != VK_NULL_HANDLE) {
-    vkWaitForFences(device.getLogical(), 1, &imageFence, VK_TRUE, UINT64_MAX);
-  }
+    if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR)
+      return RenderResult::FatalError;
 
-  // Mark image as now using this frame's fence
-  frame.setImageInFlight(imageIndex, fence);
+    // Wait if this image is already in flight
+    VkFence &imageFence = frame.getImageInFlight(imageIndex);
+    if (imageFence != VK_NULL_HANDLE) {
+      vkWaitForFences(device.getLogical(), 1, &imageFence, VK_TRUE,
+                      UINT64_MAX);
+    }
+
+    // Mark image as now using this frame's fence
+    frame.setImageInFlight(imageIndex, fence);
+  }
 
   vkResetFences(device.getLogical(), 1, &fence);
 
   VkCommandBuffer cmd = commands.get(currentFrame);
   vkResetCommandBuffer(cmd, 0);
 
-  camera.update(currentFrame);
+  uniformRing.beginFrame(currentFrame);
+  objectRing.beginFrame(currentFrame);
+  drawRing.beginFrame(currentFrame);
+  culler.beginFrame(currentFrame);
+  meshletCuller.beginFrame(currentFrame);
+  if (workers)
+    workers->beginFrame(currentFrame);
+  descriptors.beginFrame(currentFrame);
+  camera.update(uniformRing);
+
+  FrameData frameData;
+  frameData.frame = currentFrame;
+  frameData.camera = camera.getUniform();
+  frameData.objectRange = objectRing.getFrameCapacity();
+  frameData.descriptors = &descriptors;
+  frameData.geometry = &geometry;
+  // The frustum test runs on every item, resident or not: only meshes in
+  // view are stamped as used, and the streamer evicts the least recently
+  // rendered ones. It only shrinks the draw list with CPU culling on.
+  {
+    PROFILE_SCOPE("cpu cull");
+    Frustum frustum = camera.getFrustum();
+    for (glm::vec4 &plane : frustum.planes)
+      plane.w += ResidencyMargin;
+    cpuCuller.setBounds(items, jobs);
+    visibleItems.clear();
+    for (uint32_t i : cpuCuller.cull(frustum)) {
+      items[i]->mesh->lastUsedFrame = frameNumber + 1;
+      visibleItems.push_back(items[i]);
+    }
+  }
+  std::span<RenderItem *> drawItems = items;
+  if (isCpuCulling())
+    drawItems = visibleItems;
+  auto culled = static_cast<uint32_t>(items.size() - drawItems.size());
+
+  // Items whose mesh is not resident are dropped here
+  bool allResident = true;
+  for (RenderItem *item : drawItems)
+    allResident &= item->mesh->resident;
+  if (!allResident) {
+    residentItems.clear();
+    for (RenderItem *item : drawItems) {
+      if (item->mesh->resident)
+        residentItems.push_back(item);
+    }
+    drawItems = residentItems;
+  }
+  uint32_t notResident =
+      static_cast<uint32_t>(items.size() - drawItems.size()) - culled;
 
-  recorder.record(cmd, swapchain, imageIndex, currentFrame, items, camera);
+  RenderTarget target = swapchain ? swapchain->getRenderTarget(imageIndex)
+                                  : offscreen->getRenderTarget(imageIndex);
+  {
+    PROFILE_SCOPE("lod select");
+    lodSelector.select(drawItems, camera.getMatrices(), target.extent.height,
+                       jobs);
+  }
+  {
+    PROFILE_SCOPE("instancing");
+    buildBatches(drawItems, camera.getMatrices().view, frameData);
+  }
+  // Only uploads this frame actually draws from hold up its submission
+  frameData.uploads = &uploads;
+  for (const DrawBatch &batch : batches) {
+    frameData.uploadWait = std::max(
+        frameData.uploadWait, uploads.getWaitValue(batch.mesh->upload));
+  }
+  if (indirect) {
+    PROFILE_SCOPE("draw commands");
+    writeDrawCommands(frameData);
+  }
 
-  VkPipelineStageFlags waitStage =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  if (isGpuCulling()) {
+    PROFILE_SCOPE("cull inputs");
+    // A new pyramid means new views; nothing is in flight after resize
+    if (culler.resize(target.extent))
+      descriptors.clear();
+    if (isMeshletCulling())
+      meshletCuller.assign(batches, drawItems, drawOrder);
+    culler.prepare(frameData, batches, drawOrder, camera.getFrustum(),
+                   camera.getMatrices(), uniformRing);
+    if (isMeshletCulling())
+      meshletCuller.prepare(frameData, batches, drawOrder);
+  }
+  {
+    PROFILE_SCOPE("record");
+    recorder.record(cmd, target, frameData, batches);
+  }
+  stats = recorder.getStats();
+  stats.itemsNotResident = notResident;
+  stats.itemsCulled = culled;
+
+  // Binary image semaphore and/or the upload timeline; the binary wait's
+  // value is ignored
+  VkSemaphore waitSemaphores[2];
+  VkPipelineStageFlags waitStages[2];
+  uint64_t waitValues[2] = {};
+  uint32_t waitCount = 0;
+  if (swapchain) {
+    waitSemaphores[waitCount] = frame.getImageAvailableSemaphore(currentFrame);
+    waitStages[waitCount] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    waitCount++;
+  }
+  if (frameData.uploadWait) {
+    waitSemaphores[waitCount] = uploads.getSemaphore();
+    waitStages[waitCount] = UploadQueue::WaitStage;
+    waitValues[waitCount] = frameData.uploadWait;
+    waitCount++;
+  }
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.waitSemaphoreValueCount = waitCount;
+  timelineInfo.pWaitSemaphoreValues = waitValues;
 
   VkSubmitInfo submit{};
   submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submit.waitSemaphoreCount = 1;
-  submit.pWaitSemaphores = &frame.getImageAvailableSemaphore(currentFrame);
-  submit.pWaitDstStageMask = &waitStage;
+  submit.pNext = &timelineInfo;
   submit.commandBufferCount = 1;
   submit.pCommandBuffers = &cmd;
-  submit.signalSemaphoreCount = 1;
-  submit.pSignalSemaphores = &frame.getRenderFinishedSemaphore(imageIndex);
+  submit.waitSemaphoreCount = waitCount;
+  submit.pWaitSemaphores = waitSemaphores;
+  submit.pWaitDstStageMask = waitStages;
+  if (swapchain) {
+    submit.signalSemaphoreCount = 1;
+    submit.pSignalSemaphores = &frame.getRenderFinishedSemaphore(imageIndex);
+  }
 
-  VK_CHECK(vkQueueSubmit(device.getGraphicsQueue(), 1, &submit, fence));
+  {
+    PROFILE_SCOPE("submit");
+    VK_CHECK(vkQueueSubmit(device.getGraphicsQueue(), 1, &submit, fence));
+  }
+  frameNumber++;
+  lastSubmitTime = std::chrono::steady_clock::now();
+
+  if (!swapchain) {
+    currentFrame = (currentFrame + 1) % frame.getMaxFramesInFlight();
+    return RenderResult::Ok;
+  }
 
   VkPresentInfoKHR present{};
   present.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
   present.waitSemaphoreCount = 1;
   present.pWaitSemaphores = &frame.getRenderFinishedSemaphore(imageIndex);
   present.swapchainCount = 1;
-  VkSwapchainKHR sc = swapchain.getSwapchain();
+  VkSwapchainKHR sc = swapchain->getSwapchain();
   present.pSwapchains = &sc;
   present.pImageIndices = &imageIndex;
 
-  res = vkQueuePresentKHR(device.getPresentQueue(), &present);
+  VkResult res;
+  {
+    PROFILE_SCOPE("present");
+    res = vkQueuePresentKHR(device.getPresentQueue(), &present);
+  }
 
   currentFrame = (currentFrame + 1) % frame.getMaxFramesInFlight();
 
@@ -1,31 +1,194 @@
 #pragma once
 #include "renderer/camera.h"
+#include "renderer/cpuCuller.h"
+#include "renderer/drawBatch.h"
+#include "renderer/frameData.h"
+#include "renderer/lodSelector.h"
+#include "renderer/renderQueue.h"
+#include "renderer/renderStats.h"
+#include "rhi/vulkan/descriptorCache.h"
 #include "rhi/vulkan/frame.h"
+#include "rhi/vulkan/geometryPool.h"
+#include "rhi/vulkan/gpuCuller.h"
+#include "rhi/vulkan/meshletCuller.h"
+#include "rhi/vulkan/uniformRing.h"
+#include "rhi/vulkan/uploadQueue.h"
+#include <chrono>
+#include <memory>
 #include <span>
+#include <vector>
 
 class Device;
 class Swapchain;
+class OffscreenTarget;
 class CommandContext;
 class RenderRecorder;
 class RenderItem;
+struct Mesh;
+struct Material;
+class MeshFile;
+class GpuProfiler;
+class CommandWorkers;
+class JobSystem;
 
 enum class RenderResult { Ok, SwapchainOutOfDate, FatalError };
 
 class Renderer {
 public:
-  Renderer(Device &device, Swapchain &swapchain, CommandContext &commands,
-           RenderRecorder &recorder, Frame &frame);
+  // Exactly one of swapchain / offscreen is set. Without a swapchain the
+  // renderer draws into the offscreen ring and never presents.
+  // maxObjects bounds the items drawn per frame (object table size).
+  Renderer(Device &device, Swapchain *swapchain, OffscreenTarget *offscreen,
+           CommandContext &commands, RenderRecorder &recorder, Frame &frame,
+           uint32_t maxObjects = 65536);
+  ~Renderer();
 
   RenderResult drawFrame(std::span<RenderItem *> items, Camera &camera);
 
   const uint32_t &getCurrentFrame() const noexcept { return currentFrame; }
+  const RenderStats &getStats() const noexcept { return stats; }
+  // Optional GPU timestamps, results are collected once a slot's fence waits
+  void setProfiler(GpuProfiler *gpuProfiler) noexcept;
+  // Per-frame uniform/storage data, rewound each time a frame slot is reused
+  UniformRing &getUniformRing() noexcept { return uniformRing; }
+  DescriptorCache &getDescriptorCache() noexcept { return descriptors; }
+  // Shared vertex/index storage, meshes are uploaded here
+  GeometryPool &getGeometryPool() noexcept { return geometry; }
+  // Batched asynchronous copies on the transfer queue, the geometry pool's
+  // source. Flushed at the start of every frame.
+  UploadQueue &getUploadQueue() noexcept { return uploads; }
+  // Reorders the triangles and vertices like the cooker does, uploads
+  // into the geometry pool with 16-bit indices when they fit and computes
+  // the mesh bounds and meshlets. Only the full level of detail, the
+  // cooker generates the coarser ones. Throws for layouts with attributes
+  // beyond Vertex's position and color. Returns before the copy is even
+  // submitted; frames drawing the mesh wait for it on the GPU.
+  std::unique_ptr<Mesh> createMesh(std::span<const Vertex> vertices,
+                                   std::span<const uint32_t> indices);
+  // One mesh per submesh of a cooked file, uploaded straight from its
+  // mapping; the file may be closed once this returns
+  std::vector<std::unique_ptr<Mesh>> createMeshes(const MeshFile &file);
+  // Uploads file's submeshes into existing meshes, one each, and makes
+  // them resident again. Used to bring streamed meshes back after eviction.
+  void uploadMeshes(const MeshFile &file,
+                    std::span<const std::unique_ptr<Mesh>> meshes);
+  // Returns mesh's geometry and sort id and stops drawing it; also due
+  // before destroying a resident mesh. Only valid once
+  // isRetired(mesh.lastUsedFrame) and its upload completed.
+  void releaseMesh(Mesh &mesh);
+  // Materials only carry their sort key fields so far
+  std::unique_ptr<Material> createMaterial(bool transparent = false);
+  // Culling bounds, sort keys and the object table are filled in parallel
+  // on jobs when set; drawFrame must then be called on its creating thread
+  void setJobSystem(JobSystem *jobSystem) noexcept { jobs = jobSystem; }
+  // Worker threads recording direct draws into secondary command buffers,
+  // 0 records everything on the calling thread. Waits for the device.
+  void setRecordThreads(uint32_t count);
+  // Multi-draw indirect when the device supports it, direct draws otherwise
+  void setIndirect(bool enabled) noexcept;
+  bool isIndirect() const noexcept { return indirect; }
+  // SIMD frustum culling before batching, skipped while GPU culling runs.
+  // The test itself always runs: only items in view keep their meshes
+  // resident.
+  void setCpuCulling(bool enabled) noexcept { cpuCulling = enabled; }
+  bool isCpuCulling() const noexcept { return cpuCulling && !isGpuCulling(); }
+  // Compute frustum culling into the indirect draws, needs the indirect path
+  void setGpuCulling(bool enabled) noexcept { gpuCulling = enabled; }
+  bool isGpuCulling() const noexcept { return gpuCulling && indirect; }
+  // Two-phase Hi-Z occlusion culling on top of GPU culling
+  void setOcclusionCulling(bool enabled) noexcept {
+    occlusionCulling = enabled;
+  }
+  bool isOcclusionCulling() const noexcept {
+    return occlusionCulling && isGpuCulling();
+  }
+  // Per-meshlet frustum, cone and occlusion culling of meshes with enough
+  // meshlets, on top of GPU culling
+  void setMeshletCulling(bool enabled) noexcept { meshletCulling = enabled; }
+  bool isMeshletCulling() const noexcept {
+    return meshletCulling && isGpuCulling();
+  }
+  // Screen-space error in pixels a mesh's level of detail may show, 0
+  // always draws the full meshes. Items keep their level between frames.
+  void setLodThreshold(float pixels) noexcept {
+    lodSelector.setThreshold(pixels);
+  }
+  float getLodThreshold() const noexcept {
+    return lodSelector.getThreshold();
+  }
+  // Instances the GPU kept the last time the current frame slot was used
+  uint32_t getGpuVisibleCount() const noexcept {
+    return culler.getLastVisibleCount();
+  }
+  // Meshlets the GPU kept the last time the current frame slot was used
+  uint32_t getGpuVisibleMeshletCount() const noexcept {
+    return meshletCuller.getLastVisibleCount();
+  }
+  // Frames handed to the queue so far; drawFrame stamps meshes with the
+  // number of the frame it builds, one more than this
+  uint64_t getFrameNumber() const noexcept { return frameNumber; }
+  // Whether the GPU is done with everything frameNumber drew
+  bool isRetired(uint64_t frameNumber) const noexcept {
+    return frameNumber + frame.getMaxFramesInFlight() <= this->frameNumber;
+  }
+  // CPU time at which the last frame's command buffer was handed to the queue
+  std::chrono::steady_clock::time_point getLastSubmitTime() const noexcept {
+    return lastSubmitTime;
+  }
 
 private:
+  // Instancing stage: orders items by sort key, writes their transforms
+  // contiguously into the object table and emits one batch per run of
+  // equal mesh/level/material
+  void buildBatches(std::span<RenderItem *> items, const glm::mat4 &view,
+                    FrameData &frameData);
+  // Turns the batches into VkDrawIndexedIndirectCommand records
+  void writeDrawCommands(FrameData &frameData);
+
   Device &device;
-  Swapchain &swapchain;
+  Swapchain *swapchain = nullptr;
+  OffscreenTarget *offscreen = nullptr;
   CommandContext &commands;
   RenderRecorder &recorder;
   Frame &frame;
+  UniformRing uniformRing;
+  // Per-frame ObjectData table, one entry per submitted item
+  UniformRing objectRing;
+  // Per-frame indirect draw records and their count
+  UniformRing drawRing;
+  // Bound size of one array of draw records
+  VkDeviceSize drawRange = 0;
+  DescriptorCache descriptors;
+  UploadQueue uploads;
+  GeometryPool geometry;
+  GpuCuller culler;
+  // Reads the culler's depth pyramid, constructed after it
+  MeshletCuller meshletCuller;
+  bool indirect = false;
+  bool gpuCulling = false;
+  bool occlusionCulling = false;
+  bool meshletCulling = false;
+  CpuCuller cpuCuller;
+  bool cpuCulling = true;
+  LodSelector lodSelector;
+  RenderStats stats;
+  GpuProfiler *profiler = nullptr;
+  std::unique_ptr<CommandWorkers> workers;
+  JobSystem *jobs = nullptr;
+
+  RenderQueue renderQueue;
+  // Meshes hold theirs while resident
+  SortIds meshIds;
+  SortIds materialIds;
+
+  // Scratch reused across frames
+  std::vector<RenderItem *> residentItems;
+  std::vector<RenderItem *> visibleItems;
+  // Item indices in draw order, points into renderQueue
+  std::span<const uint32_t> drawOrder;
+  std::vector<DrawBatch> batches;
 
   uint32_t currentFrame = 0;
+  uint64_t frameNumber = 0;
+  std::chrono::steady_clock::time_point lastSubmitTime{};
 };
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <glm/glm.hpp>
 
 struct alignas(16) CameraUBO {
@@ -6,6 +7,58 @@ struct alignas(16) CameraUBO {
   alignas(16) glm::mat4 proj;
 };
 
-struct ModelUBO {
+// One entry of the per-frame object table (std430 storage buffer). The
+// vertex shader indexes it with gl_InstanceIndex.
+struct ObjectData {
   glm::mat4 model;
+  // Mesh position box, object position = offset + stored * scale (xyz)
+  glm::vec4 positionOffset;
+  glm::vec4 positionScale;
+};
+
+// Cull compute shader parameters (std140). view/proj and the pyramid size
+// are only read by the occlusion test, the camera position by the meshlet
+// cone test.
+struct CullUBO {
+  glm::mat4 view;
+  glm::mat4 proj;
+  glm::vec4 planes[6];
+  uint32_t objectCount;
+  uint32_t pyramidWidth;
+  uint32_t pyramidHeight;
+  uint32_t pyramidMips;
+  // World space, w unused
+  glm::vec4 cameraPosition;
+};
+
+// Per-object cull input, same order as the object table (std430)
+struct CullObject {
+  // Object-space bounding sphere, xyz = center, w = radius
+  glm::vec4 sphere;
+  // Draw record the object belongs to, NoDraw when its meshlets are culled
+  // instead and only its instance entry is written
+  uint32_t drawIndex;
+  // Stable slot in the visibility buffer, the item's submission index
+  uint32_t objectId;
+  uint32_t pad[2];
+
+  static constexpr uint32_t NoDraw = 0xffffffffu;
+};
+
+// Up to 64 meshlets of one object, one workgroup of the meshlet cull
+// shader (std430)
+struct MeshletTask {
+  // Object table slot, also the instance the meshlets are drawn with
+  uint32_t object;
+  // Into the geometry pool's meshlet buffer
+  uint32_t firstMeshlet;
+  uint32_t meshletCount;
+  // Slot of the first meshlet in the meshlet visibility buffer
+  uint32_t visibility;
+  // The mesh's GeometryRange offsets, added to each meshlet's range
+  uint32_t firstIndex;
+  int32_t vertexOffset;
+  // Output records: 0 for 16-bit indices, 1 for 32-bit
+  uint32_t region;
+  uint32_t pad;
 };
@@ -0,0 +1,278 @@
+#include "renderer/vertexLayout.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+struct FormatInfo {
+  uint32_t size;
+  uint32_t components;
+};
+
+constexpr std::array<FormatInfo, VertexFormatCount> FormatInfos = {{
+    {0, 0},  // None
+    {8, 2},  // Float2
+    {12, 3}, // Float3
+    {16, 4}, // Float4
+    {4, 2},  // Half2
+    {8, 4},  // Half4
+    {8, 4},  // Unorm16x4
+    {4, 2},  // Snorm16x2
+    {8, 4},  // Snorm16x4
+    {4, 4},  // Unorm8x4
+    {4, 4},  // Snorm8x4
+}};
+
+template <typename T> void store(std::byte *dst, T value) noexcept {
+  std::memcpy(dst, &value, sizeof(T));
+}
+
+uint16_t toUnorm16(float v) noexcept {
+  return static_cast<uint16_t>(
+      std::lround(std::clamp(v, 0.0f, 1.0f) * 65535.0f));
+}
+int16_t toSnorm16(float v) noexcept {
+  return static_cast<int16_t>(
+      std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+uint8_t toUnorm8(float v) noexcept {
+  return static_cast<uint8_t>(
+      std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f));
+}
+int8_t toSnorm8(float v) noexcept {
+  return static_cast<int8_t>(
+      std::lround(std::clamp(v, -1.0f, 1.0f) * 127.0f));
+}
+
+// Stores one component c of an attribute in format
+void encodeComponent(std::byte *dst, VertexFormat format, uint32_t c,
+                     float v) noexcept {
+  switch (format) {
+  case VertexFormat::Float2:
+  case VertexFormat::Float3:
+  case VertexFormat::Float4:
+    store(dst + c * 4, v);
+    break;
+  case VertexFormat::Half2:
+  case VertexFormat::Half4:
+    store(dst + c * 2, floatToHalf(v));
+    break;
+  case VertexFormat::Unorm16x4:
+    store(dst + c * 2, toUnorm16(v));
+    break;
+  case VertexFormat::Snorm16x2:
+  case VertexFormat::Snorm16x4:
+    store(dst + c * 2, toSnorm16(v));
+    break;
+  case VertexFormat::Unorm8x4:
+    store(dst + c, toUnorm8(v));
+    break;
+  case VertexFormat::Snorm8x4:
+    store(dst + c, toSnorm8(v));
+    break;
+  case VertexFormat::None:
+    break;
+  }
+}
+
+bool isUnorm(VertexFormat format) noexcept {
+  return format == VertexFormat::Unorm16x4 ||
+         format == VertexFormat::Unorm8x4;
+}
+
+// Stores count values in format, missing components are 0 except the
+// fourth, which defaults to one
+void encode(std::byte *dst, VertexFormat format, const float *values,
+            uint32_t count) noexcept {
+  float v[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  std::copy_n(values, std::min(count, 4u), v);
+  for (uint32_t c = 0; c < getFormatComponents(format); c++)
+    encodeComponent(dst, format, c, v[c]);
+}
+} // namespace
+
+uint32_t getFormatSize(VertexFormat format) noexcept {
+  return FormatInfos[static_cast<size_t>(format)].size;
+}
+
+uint32_t getFormatComponents(VertexFormat format) noexcept {
+  return FormatInfos[static_cast<size_t>(format)].components;
+}
+
+PositionBox makePositionBox(const float center[3], const float extents[3]) {
+  PositionBox box;
+  for (int c = 0; c < 3; c++) {
+    box.offset[c] = center[c] - extents[c];
+    box.scale[c] = extents[c] * 2.0f;
+  }
+  return box;
+}
+
+VertexLayout &VertexLayout::set(VertexAttribute attribute,
+                                VertexFormat format) noexcept {
+  formats[static_cast<size_t>(attribute)] = format;
+  // Every format is a multiple of four bytes, so packing keeps alignment
+  stride = 0;
+  for (uint32_t a = 0; a < VertexAttributeCount; a++) {
+    offsets[a] = stride;
+    stride += getFormatSize(formats[a]);
+  }
+  return *this;
+}
+
+uint32_t VertexLayout::getKey() const noexcept {
+  uint32_t key = 0;
+  for (uint32_t a = 0; a < VertexAttributeCount; a++)
+    key |= static_cast<uint32_t>(formats[a]) << (a * 4);
+  return key;
+}
+
+VertexLayout VertexLayout::fromKey(uint32_t key) {
+  if (key >> (VertexAttributeCount * 4))
+    throw std::runtime_error("unknown vertex attributes in layout");
+
+  VertexLayout layout;
+  for (uint32_t a = 0; a < VertexAttributeCount; a++) {
+    uint32_t format = (key >> (a * 4)) & 0xf;
+    if (format >= VertexFormatCount)
+      throw std::runtime_error("unknown vertex format in layout");
+    layout.set(static_cast<VertexAttribute>(a),
+               static_cast<VertexFormat>(format));
+  }
+  if (!layout.has(VertexAttribute::Position))
+    throw std::runtime_error("vertex layout without positions");
+  return layout;
+}
+
+VertexLayout VertexLayout::compact() {
+  return VertexLayout()
+      .set(VertexAttribute::Position, VertexFormat::Unorm16x4)
+      .set(VertexAttribute::Color, VertexFormat::Unorm8x4);
+}
+
+VertexLayout VertexLayout::lit() {
+  return compact()
+      .set(VertexAttribute::Normal, VertexFormat::Snorm16x2)
+      .set(VertexAttribute::Tangent, VertexFormat::Snorm16x2)
+      .set(VertexAttribute::Uv, VertexFormat::Half2);
+}
+
+VertexLayout VertexLayout::full() {
+  return VertexLayout()
+      .set(VertexAttribute::Position, VertexFormat::Float3)
+      .set(VertexAttribute::Color, VertexFormat::Float3);
+}
+
+void VertexEncoder::write(std::byte *vertex, VertexAttribute attribute,
+                          const float *values) const noexcept {
+  VertexFormat format = layout.getFormat(attribute);
+  if (format == VertexFormat::None)
+    return;
+  std::byte *dst = vertex + layout.getOffset(attribute);
+
+  switch (attribute) {
+  case VertexAttribute::Position:
+    if (layout.isPositionQuantized()) {
+      float q[3];
+      for (int c = 0; c < 3; c++) {
+        const float scale = positionBox.scale[c];
+        q[c] = scale > 0.0f ? (values[c] - positionBox.offset[c]) / scale
+                            : 0.0f;
+      }
+      encode(dst, format, q, 3);
+    } else {
+      encode(dst, format, values, 3);
+    }
+    return;
+  case VertexAttribute::Normal:
+  case VertexAttribute::Tangent:
+    if (getFormatComponents(format) != 2) {
+      encode(dst, format, values,
+             attribute == VertexAttribute::Tangent ? 4 : 3);
+      return;
+    }
+    {
+      float oct[2];
+      octEncode(values, oct);
+      encode(dst, format, oct, 2);
+    }
+    // The bitangent sign rides in position.w, written after the position
+    if (attribute == VertexAttribute::Tangent) {
+      VertexFormat positionFormat =
+          layout.getFormat(VertexAttribute::Position);
+      if (getFormatComponents(positionFormat) == 4) {
+        float sign = values[3] < 0.0f ? -1.0f : 1.0f;
+        if (isUnorm(positionFormat))
+          sign = sign * 0.5f + 0.5f;
+        encodeComponent(vertex + layout.getOffset(VertexAttribute::Position),
+                        positionFormat, 3, sign);
+      }
+    }
+    return;
+  case VertexAttribute::Color:
+    encode(dst, format, values, 3);
+    return;
+  case VertexAttribute::Uv:
+    encode(dst, format, values, 2);
+    return;
+  }
+}
+
+uint16_t floatToHalf(float value) noexcept {
+  uint32_t bits = std::bit_cast<uint32_t>(value);
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t exponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  // NaN stays NaN, infinity stays infinity
+  if (exponent == 0xff)
+    return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+  int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+  if (halfExponent >= 0x1f)
+    return static_cast<uint16_t>(sign | 0x7c00);
+  if (halfExponent <= 0) {
+    // Subnormal half or zero
+    if (halfExponent < -10)
+      return static_cast<uint16_t>(sign);
+    mantissa |= 0x800000;
+    uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+    uint32_t half = mantissa >> shift;
+    // Round to nearest even
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1)))
+      half++;
+    return static_cast<uint16_t>(sign | half);
+  }
+
+  uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) |
+                  (mantissa >> 13);
+  uint32_t rest = mantissa & 0x1fff;
+  // Carries into the exponent correctly, up to infinity
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    half++;
+  return static_cast<uint16_t>(sign | half);
+}
+
+void octEncode(const float n[3], float out[2]) noexcept {
+  float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+  if (l1 == 0.0f) {
+    out[0] = 0.0f;
+    out[1] = 0.0f;
+    return;
+  }
+  float x = n[0] / l1;
+  float y = n[1] / l1;
+  // Fold the lower hemisphere over the diagonals
+  if (n[2] < 0.0f) {
+    float fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = fx;
+    y = fy;
+  }
+  out[0] = x;
+  out[1] = y;
+}
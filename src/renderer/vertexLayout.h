@@ -0,0 +1,118 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Vertex attributes, in the order they are laid out. The value is also
+// the vertex shader input location.
+enum class VertexAttribute : uint8_t { Position, Color, Normal, Tangent, Uv };
+constexpr uint32_t VertexAttributeCount = 5;
+
+// Storage format of one attribute. Normalized formats read as floats in
+// the shader, so the same shader works with any layout.
+enum class VertexFormat : uint8_t {
+  None,
+  Float2,
+  Float3,
+  Float4,
+  Half2,
+  Half4,
+  Unorm16x4,
+  Snorm16x2,
+  Snorm16x4,
+  Unorm8x4,
+  Snorm8x4,
+};
+constexpr uint32_t VertexFormatCount = 11;
+
+uint32_t getFormatSize(VertexFormat format) noexcept;
+uint32_t getFormatComponents(VertexFormat format) noexcept;
+
+// Position box of a quantized mesh: a stored position q in [0, 1]^3 is
+// offset + q * scale in object space
+struct PositionBox {
+  float offset[3] = {0.0f, 0.0f, 0.0f};
+  float scale[3] = {1.0f, 1.0f, 1.0f};
+};
+
+// The box around center +- extents; cooker and runtime must both derive
+// it this way from the stored bounds so the dequantization is exact
+PositionBox makePositionBox(const float center[3], const float extents[3]);
+
+// Attributes of one interleaved vertex stream. Attributes are packed in
+// VertexAttribute order, so the format of each one fully determines the
+// layout and it round-trips through a 32-bit key stored in cooked files.
+//
+// Conventions for the compressed formats:
+//  - Position in Unorm16x4 is relative to the mesh's PositionBox
+//  - Normal and Tangent in two components are octahedral-encoded; the
+//    tangent's bitangent sign then goes into position.w (0 means -1)
+class VertexLayout {
+public:
+  VertexLayout() = default;
+
+  VertexLayout &set(VertexAttribute attribute, VertexFormat format) noexcept;
+
+  VertexFormat getFormat(VertexAttribute attribute) const noexcept {
+    return formats[static_cast<size_t>(attribute)];
+  }
+  bool has(VertexAttribute attribute) const noexcept {
+    return getFormat(attribute) != VertexFormat::None;
+  }
+  uint32_t getOffset(VertexAttribute attribute) const noexcept {
+    return offsets[static_cast<size_t>(attribute)];
+  }
+  uint32_t getStride() const noexcept { return stride; }
+  bool isPositionQuantized() const noexcept {
+    return getFormat(VertexAttribute::Position) == VertexFormat::Unorm16x4;
+  }
+
+  // Four bits per attribute
+  uint32_t getKey() const noexcept;
+  // Throws std::runtime_error on unknown formats or a missing position
+  static VertexLayout fromKey(uint32_t key);
+
+  bool operator==(const VertexLayout &other) const noexcept {
+    return formats == other.formats;
+  }
+
+  // 12 bytes: quantized position and 8-bit color, what the forward
+  // shader reads
+  static VertexLayout compact();
+  // 24 bytes: compact plus octahedral normal and tangent and half UVs
+  static VertexLayout lit();
+  // 24 bytes: float position and color, the uncompressed reference
+  static VertexLayout full();
+
+private:
+  std::array<VertexFormat, VertexAttributeCount> formats{};
+  std::array<uint32_t, VertexAttributeCount> offsets{};
+  uint32_t stride = 0;
+};
+
+// Writes float attributes into a layout, one vertex at a time. Attributes
+// the layout lacks are skipped. Expected float counts: 3 for position,
+// color and normal, 4 for tangent (w = bitangent sign), 2 for UV. An
+// octahedral tangent stores its sign in position.w, so it has to be
+// written after the position.
+class VertexEncoder {
+public:
+  explicit VertexEncoder(const VertexLayout &layout) : layout(layout) {}
+
+  // Box quantized positions are relative to
+  void setPositionBox(const PositionBox &box) noexcept {
+    positionBox = box;
+  }
+
+  void write(std::byte *vertex, VertexAttribute attribute,
+             const float *values) const noexcept;
+
+private:
+  VertexLayout layout;
+  PositionBox positionBox;
+};
+
+// Encoding primitives, exposed for tools
+uint16_t floatToHalf(float value) noexcept;
+// Unit vector to [-1, 1]^2
+void octEncode(const float n[3], float out[2]) noexcept;
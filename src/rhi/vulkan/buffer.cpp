@@ -9,15 +9,11 @@ Buffer::~Buffer() {
   if (buffer != VK_NULL_HANDLE) {
     vkDestroyBuffer(device.getLogical(), buffer, nullptr);
   }
-  if (memory != VK_NULL_HANDLE) {
-    vkFreeMemory(device.getLogical(), memory, nullptr);
-  }
+  device.getAllocator().free(allocation);
 }
 void Buffer::upload(const void *data, VkDeviceSize dataSize) {
-  void *mapped;
-  vkMapMemory(device.getLogical(), memory, 0, dataSize, 0, &mapped);
-  std::memcpy(mapped, data, static_cast<size_t>(dataSize));
-  vkUnmapMemory(device.getLogical(), memory);
+  // Host-visible blocks are mapped once by the allocator
+  std::memcpy(allocation.mapped, data, static_cast<size_t>(dataSize));
 }
 void Buffer::create(VkDeviceSize bufferSize, VkBufferUsageFlags usage,
                     VkMemoryPropertyFlags properties) {
@@ -30,18 +26,8 @@ void Buffer::create(VkDeviceSize bufferSize, VkBufferUsageFlags usage,
   bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
   VK_CHECK(vkCreateBuffer(device.getLogical(), &bufferInfo, nullptr, &buffer));
 
-  VkMemoryRequirements memReq;
-  vkGetBufferMemoryRequirements(device.getLogical(), buffer, &memReq);
-
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memReq.size;
-  allocInfo.memoryTypeIndex =
-      device.findMemoryType(memReq.memoryTypeBits, properties);
-
-  VK_CHECK(vkAllocateMemory(device.getLogical(), &allocInfo, nullptr, &memory));
-
-  vkBindBufferMemory(device.getLogical(), buffer, memory, 0);
+  allocation =
+      device.getAllocator().allocateForBuffer(buffer, properties, this);
 }
 
 void Buffer::createUniformBuffer(VkDeviceSize size) {
@@ -51,22 +37,21 @@ void Buffer::createUniformBuffer(VkDeviceSize size) {
              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 }
 
-void Buffer::uploadViaStaging(const void *srcData, VkDeviceSize dataSize) {
+void Buffer::uploadViaStaging(const void *srcData, VkDeviceSize dataSize,
+                              VkDeviceSize dstOffset) {
   // staging buffer
   Buffer staging(device, commandPool);
   staging.create(dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-  void *mapped;
-  vkMapMemory(device.getLogical(), staging.memory, 0, dataSize, 0, &mapped);
-  std::memcpy(mapped, srcData, static_cast<size_t>(dataSize));
-  vkUnmapMemory(device.getLogical(), staging.memory);
+  staging.upload(srcData, dataSize);
 
-  copyBuffer(staging.buffer, buffer, dataSize);
+  copyBuffer(staging.buffer, buffer, dataSize, dstOffset);
 }
 
-void Buffer::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize copySize) {
+void Buffer::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize copySize,
+                        VkDeviceSize dstOffset) {
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.commandPool = commandPool;
@@ -84,7 +69,7 @@ void Buffer::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize copySize) {
 
   VkBufferCopy copy{};
   copy.srcOffset = 0;
-  copy.dstOffset = 0;
+  copy.dstOffset = dstOffset;
   copy.size = copySize;
 
   vkCmdCopyBuffer(cmd, src, dst, 1, &copy);
@@ -96,8 +81,15 @@ void Buffer::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize copySize) {
   submit.commandBufferCount = 1;
   submit.pCommandBuffers = &cmd;
 
-  vkQueueSubmit(device.getGraphicsQueue(), 1, &submit, VK_NULL_HANDLE);
-  vkQueueWaitIdle(device.getGraphicsQueue());
+  // Waits for this copy only, not for everything else on the queue
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  VK_CHECK(vkCreateFence(device.getLogical(), &fenceInfo, nullptr, &fence));
+
+  VK_CHECK(vkQueueSubmit(device.getGraphicsQueue(), 1, &submit, fence));
+  vkWaitForFences(device.getLogical(), 1, &fence, VK_TRUE, UINT64_MAX);
+  vkDestroyFence(device.getLogical(), fence, nullptr);
 
   vkFreeCommandBuffers(device.getLogical(), commandPool, 1, &cmd);
 }
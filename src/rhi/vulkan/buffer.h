@@ -7,20 +7,29 @@ public:
   Buffer(Device &device, VkCommandPool commandPool);
   ~Buffer();
 
+  Buffer(const Buffer &) = delete;
+  Buffer &operator=(const Buffer &) = delete;
+
   void create(VkDeviceSize bufferSize, VkBufferUsageFlags usage,
               VkMemoryPropertyFlags properties);
   void upload(const void *data, VkDeviceSize dataSize);
-  void uploadViaStaging(const void *srcData, VkDeviceSize dataSize);
-  void copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize copySize);
+  void uploadViaStaging(const void *srcData, VkDeviceSize dataSize,
+                        VkDeviceSize dstOffset = 0);
+  void copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize copySize,
+                  VkDeviceSize dstOffset = 0);
   void createUniformBuffer(VkDeviceSize size);
 
   VkBuffer get() const { return buffer; }
-  VkDeviceMemory getMemory() const { return memory; }
+  VkDeviceMemory getMemory() const { return allocation.memory; }
+  // Offset of this buffer inside getMemory()
+  VkDeviceSize getMemoryOffset() const { return allocation.offset; }
+  // Persistently mapped pointer, null unless created host visible
+  void *getMapped() const { return allocation.mapped; }
 
 private:
   Device &device;
   VkCommandPool commandPool;
   VkBuffer buffer = VK_NULL_HANDLE;
-  VkDeviceMemory memory = VK_NULL_HANDLE;
+  Allocation allocation;
   VkDeviceSize size = 0;
 };
@@ -0,0 +1,136 @@
+#include "rhi/vulkan/commandWorkers.h"
+#include "helper.h"
+#include <algorithm>
+
+CommandWorkers::CommandWorkers(Device &device, uint32_t workerCount,
+                               uint32_t framesInFlight)
+    : device(device), workerCount(workerCount) {
+  pools.resize(size_t{workerCount} * framesInFlight);
+  buffers.resize(pools.size());
+
+  for (size_t i = 0; i < pools.size(); i++) {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = device.getQueues().graphicsFamily.value();
+    VK_CHECK(vkCreateCommandPool(device.getLogical(), &poolInfo, nullptr,
+                                 &pools[i]));
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = pools[i];
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = 1;
+    VK_CHECK(vkAllocateCommandBuffers(device.getLogical(), &allocInfo,
+                                      &buffers[i]));
+  }
+
+  threads.reserve(workerCount);
+  for (uint32_t worker = 0; worker < workerCount; worker++)
+    threads.emplace_back(&CommandWorkers::run, this, worker);
+}
+
+CommandWorkers::~CommandWorkers() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread &thread : threads)
+    thread.join();
+
+  // Buffers from these pools may still be executing
+  vkDeviceWaitIdle(device.getLogical());
+  for (VkCommandPool pool : pools)
+    vkDestroyCommandPool(device.getLogical(), pool, nullptr);
+}
+
+void CommandWorkers::beginFrame(uint32_t frame) {
+  currentFrame = frame;
+  for (uint32_t worker = 0; worker < workerCount; worker++) {
+    VK_CHECK(vkResetCommandPool(device.getLogical(),
+                                pools[frame * workerCount + worker], 0));
+  }
+}
+
+std::span<const VkCommandBuffer>
+CommandWorkers::record(const RenderTarget &target, uint32_t sliceCount,
+                       const Task &recordTask) {
+  sliceCount = std::min(sliceCount, workerCount);
+  {
+    std::lock_guard lock(mutex);
+    task = &recordTask;
+    slices = sliceCount;
+    colorFormat = target.colorFormat;
+    depthFormat = target.depthFormat;
+    pending = workerCount;
+    generation++;
+  }
+  wake.notify_all();
+
+  std::exception_ptr failure;
+  {
+    std::unique_lock lock(mutex);
+    done.wait(lock, [&] { return pending == 0; });
+    task = nullptr;
+    std::swap(failure, error);
+  }
+  if (failure)
+    std::rethrow_exception(failure);
+
+  return std::span<const VkCommandBuffer>(
+      buffers.data() + size_t{currentFrame} * workerCount, sliceCount);
+}
+
+void CommandWorkers::run(uint32_t worker) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock lock(mutex);
+      wake.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping)
+        return;
+      seen = generation;
+    }
+
+    if (worker < slices) {
+      try {
+        recordSlice(worker);
+      } catch (...) {
+        std::lock_guard lock(mutex);
+        if (!error)
+          error = std::current_exception();
+      }
+    }
+
+    std::lock_guard lock(mutex);
+    if (--pending == 0)
+      done.notify_one();
+  }
+}
+
+void CommandWorkers::recordSlice(uint32_t worker) {
+  VkCommandBuffer cmd = buffers[currentFrame * workerCount + worker];
+
+  VkCommandBufferInheritanceRenderingInfo rendering{};
+  rendering.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+  rendering.colorAttachmentCount = 1;
+  rendering.pColorAttachmentFormats = &colorFormat;
+  rendering.depthAttachmentFormat = depthFormat;
+  rendering.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkCommandBufferInheritanceInfo inheritance{};
+  inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritance.pNext = &rendering;
+
+  VkCommandBufferBeginInfo begin{};
+  begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  begin.pInheritanceInfo = &inheritance;
+
+  VK_CHECK(vkBeginCommandBuffer(cmd, &begin));
+  (*task)(worker, cmd);
+  VK_CHECK(vkEndCommandBuffer(cmd));
+}
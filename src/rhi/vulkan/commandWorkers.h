@@ -0,0 +1,64 @@
+#pragma once
+#include "rhi/vulkan/device.h"
+#include "rhi/vulkan/renderTarget.h"
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Worker threads that record secondary command buffers for a dynamic
+// rendering pass. Every worker owns one command pool per frame in flight,
+// so recording needs no locking and a frame's pools are reset together.
+class CommandWorkers {
+public:
+  // Records into cmd, which was begun for the pass; worker is its slice
+  using Task = std::function<void(uint32_t worker, VkCommandBuffer cmd)>;
+
+  CommandWorkers(Device &device, uint32_t workerCount,
+                 uint32_t framesInFlight);
+  ~CommandWorkers();
+
+  CommandWorkers(const CommandWorkers &) = delete;
+  CommandWorkers &operator=(const CommandWorkers &) = delete;
+
+  // Resets this slot's pools. Call once the frame's fence has signaled.
+  void beginFrame(uint32_t frame);
+
+  // Runs task on the first sliceCount workers, each with a secondary buffer
+  // that inherits a pass over target's attachments, and waits for them.
+  // Returns the buffers in slice order; rethrows a worker's exception.
+  std::span<const VkCommandBuffer> record(const RenderTarget &target,
+                                          uint32_t sliceCount,
+                                          const Task &task);
+
+  uint32_t getWorkerCount() const noexcept { return workerCount; }
+
+private:
+  void run(uint32_t worker);
+  void recordSlice(uint32_t worker);
+
+  Device &device;
+  uint32_t workerCount = 0;
+  // [frame * workerCount + worker]
+  std::vector<VkCommandPool> pools;
+  std::vector<VkCommandBuffer> buffers;
+  std::vector<std::thread> threads;
+  uint32_t currentFrame = 0;
+
+  // The current job, written under mutex before generation is bumped
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  uint64_t generation = 0;
+  uint32_t pending = 0;
+  bool stopping = false;
+  const Task *task = nullptr;
+  uint32_t slices = 0;
+  VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  std::exception_ptr error;
+};
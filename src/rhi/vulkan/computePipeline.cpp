@@ -0,0 +1,57 @@
+#include "rhi/vulkan/computePipeline.h"
+#include "helper.h"
+#include "rhi/vulkan/pipeline.h"
+
+ComputePipeline::ComputePipeline(
+    VkDevice device, const std::string &shaderPath,
+    std::span<const VkDescriptorSetLayoutBinding> bindings,
+    uint32_t pushConstantSize)
+    : device(device) {
+  VkDescriptorSetLayoutCreateInfo setInfo{};
+  setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  setInfo.pBindings = bindings.data();
+  VK_CHECK(vkCreateDescriptorSetLayout(device, &setInfo, nullptr, &setLayout));
+
+  VkPushConstantRange push{};
+  push.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  push.size = pushConstantSize;
+
+  VkPipelineLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  layoutInfo.setLayoutCount = 1;
+  layoutInfo.pSetLayouts = &setLayout;
+  layoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+  layoutInfo.pPushConstantRanges = &push;
+  VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout));
+
+  auto code = readFile(shaderPath);
+  VkShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = code.size();
+  moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+  VkShaderModule module;
+  VK_CHECK(vkCreateShaderModule(device, &moduleInfo, nullptr, &module));
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = module;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = layout;
+
+  VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1,
+                                             &pipelineInfo, nullptr, &pipeline);
+  vkDestroyShaderModule(device, module, nullptr);
+  VK_CHECK(result);
+}
+
+ComputePipeline::~ComputePipeline() {
+  if (pipeline != VK_NULL_HANDLE)
+    vkDestroyPipeline(device, pipeline, nullptr);
+  if (layout != VK_NULL_HANDLE)
+    vkDestroyPipelineLayout(device, layout, nullptr);
+  if (setLayout != VK_NULL_HANDLE)
+    vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <span>
+#include <string>
+#include <vulkan/vulkan_core.h>
+
+// Compute shader with a single descriptor set layout and an optional push
+// constant block.
+class ComputePipeline {
+public:
+  ComputePipeline(VkDevice device, const std::string &shaderPath,
+                  std::span<const VkDescriptorSetLayoutBinding> bindings,
+                  uint32_t pushConstantSize = 0);
+  ~ComputePipeline();
+
+  ComputePipeline(const ComputePipeline &) = delete;
+  ComputePipeline &operator=(const ComputePipeline &) = delete;
+
+  VkPipeline getPipeline() const noexcept { return pipeline; }
+  VkPipelineLayout getPipelineLayout() const noexcept { return layout; }
+  VkDescriptorSetLayout getDescriptorSetLayout() const noexcept {
+    return setLayout;
+  }
+
+private:
+  VkDevice device;
+  VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+  VkPipelineLayout layout = VK_NULL_HANDLE;
+  VkPipeline pipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,203 @@
+#include "rhi/vulkan/depthPyramid.h"
+#include "helper.h"
+#include <algorithm>
+#include <bit>
+
+namespace {
+constexpr uint32_t GroupSize = 8;
+constexpr VkFormat PyramidFormat = VK_FORMAT_R32_SFLOAT;
+
+struct ReducePush {
+  uint32_t srcWidth, srcHeight;
+  uint32_t dstWidth, dstHeight;
+};
+
+VkDescriptorSetLayoutBinding binding(uint32_t index, VkDescriptorType type) {
+  VkDescriptorSetLayoutBinding b{};
+  b.binding = index;
+  b.descriptorType = type;
+  b.descriptorCount = 1;
+  b.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  return b;
+}
+
+const VkDescriptorSetLayoutBinding ReduceBindings[] = {
+    binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER),
+    binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE),
+};
+
+void computeBarrier(VkCommandBuffer cmd, VkAccessFlags2 srcAccess) {
+  VkMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+  barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT |
+                          VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+  VkDependencyInfo dep{};
+  dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  dep.memoryBarrierCount = 1;
+  dep.pMemoryBarriers = &barrier;
+  vkCmdPipelineBarrier2(cmd, &dep);
+}
+} // namespace
+
+DepthPyramid::DepthPyramid(Device &device)
+    : device(device), pipeline(device.getLogical(), "shaders/hiz.spv",
+                               ReduceBindings, sizeof(ReducePush)) {
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+  VK_CHECK(
+      vkCreateSampler(device.getLogical(), &samplerInfo, nullptr, &sampler));
+
+  // Something valid to bind before the first depth attachment is known
+  create({1, 1});
+}
+
+DepthPyramid::~DepthPyramid() {
+  destroy();
+  vkDestroySampler(device.getLogical(), sampler, nullptr);
+}
+
+bool DepthPyramid::resize(VkExtent2D size) {
+  if (size.width == depthExtent.width && size.height == depthExtent.height)
+    return false;
+
+  // Earlier frames may still sample the old chain
+  vkDeviceWaitIdle(device.getLogical());
+  destroy();
+  create(size);
+  return true;
+}
+
+void DepthPyramid::create(VkExtent2D size) {
+  depthExtent = size;
+  extent.width = std::bit_floor(std::max(size.width, 1u));
+  extent.height = std::bit_floor(std::max(size.height, 1u));
+  mipCount = std::bit_width(std::max(extent.width, extent.height));
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent = {extent.width, extent.height, 1};
+  imageInfo.mipLevels = mipCount;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = PyramidFormat;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  VK_CHECK(vkCreateImage(device.getLogical(), &imageInfo, nullptr, &image));
+
+  memory = device.getAllocator().allocateForImage(
+      image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = PyramidFormat;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.levelCount = mipCount;
+  viewInfo.subresourceRange.layerCount = 1;
+  VK_CHECK(vkCreateImageView(device.getLogical(), &viewInfo, nullptr, &view));
+
+  mipViews.resize(mipCount);
+  viewInfo.subresourceRange.levelCount = 1;
+  for (uint32_t mip = 0; mip < mipCount; mip++) {
+    viewInfo.subresourceRange.baseMipLevel = mip;
+    VK_CHECK(vkCreateImageView(device.getLogical(), &viewInfo, nullptr,
+                               &mipViews[mip]));
+  }
+  initialized = false;
+}
+
+void DepthPyramid::destroy() {
+  for (VkImageView mipView : mipViews)
+    vkDestroyImageView(device.getLogical(), mipView, nullptr);
+  mipViews.clear();
+  vkDestroyImageView(device.getLogical(), view, nullptr);
+  vkDestroyImage(device.getLogical(), image, nullptr);
+  device.getAllocator().free(memory);
+  view = VK_NULL_HANDLE;
+  image = VK_NULL_HANDLE;
+}
+
+void DepthPyramid::prepare(VkCommandBuffer cmd) {
+  if (initialized)
+    return;
+
+  VkImageMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+  barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+  barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.levelCount = mipCount;
+  barrier.subresourceRange.layerCount = 1;
+
+  VkDependencyInfo dep{};
+  dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  dep.imageMemoryBarrierCount = 1;
+  dep.pImageMemoryBarriers = &barrier;
+  vkCmdPipelineBarrier2(cmd, &dep);
+  initialized = true;
+}
+
+void DepthPyramid::build(VkCommandBuffer cmd, VkImageView depthView,
+                         VkExtent2D depthSize, DescriptorCache &descriptors) {
+  prepare(cmd);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    pipeline.getPipeline());
+
+  // Earlier cull dispatches sampled the chain this overwrites
+  computeBarrier(cmd, VK_ACCESS_2_NONE);
+
+  VkExtent2D srcSize = depthSize;
+  for (uint32_t mip = 0; mip < mipCount; mip++) {
+    VkExtent2D dstSize{std::max(extent.width >> mip, 1u),
+                       std::max(extent.height >> mip, 1u)};
+
+    // The depth view changes with the swapchain, so its set is per frame;
+    // the pyramid's own views live as long as the image
+    const DescriptorBinding bindings[] = {
+        {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_NULL_HANDLE, 0,
+         VK_WHOLE_SIZE, sampler, mip == 0 ? depthView : mipViews[mip - 1],
+         mip == 0 ? VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL
+                  : VK_IMAGE_LAYOUT_GENERAL},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_NULL_HANDLE, 0, VK_WHOLE_SIZE,
+         VK_NULL_HANDLE, mipViews[mip], VK_IMAGE_LAYOUT_GENERAL}};
+    VkDescriptorSet set =
+        mip == 0
+            ? descriptors.getTransient(pipeline.getDescriptorSetLayout(),
+                                       bindings)
+            : descriptors.get(pipeline.getDescriptorSetLayout(), bindings);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipeline.getPipelineLayout(), 0, 1, &set, 0,
+                            nullptr);
+
+    ReducePush push{srcSize.width, srcSize.height, dstSize.width,
+                    dstSize.height};
+    vkCmdPushConstants(cmd, pipeline.getPipelineLayout(),
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+    vkCmdDispatch(cmd, (dstSize.width + GroupSize - 1) / GroupSize,
+                  (dstSize.height + GroupSize - 1) / GroupSize, 1);
+
+    // Next mip reads this one, the cull shader reads all of them
+    computeBarrier(cmd, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+    srcSize = dstSize;
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "rhi/vulkan/computePipeline.h"
+#include "rhi/vulkan/descriptorCache.h"
+#include "rhi/vulkan/device.h"
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Hi-Z pyramid: an R32 mip chain where each texel holds the farthest depth
+// of the screen area it covers. Sized to the largest power of two that fits
+// the depth attachment and kept in VK_IMAGE_LAYOUT_GENERAL.
+class DepthPyramid {
+public:
+  DepthPyramid(Device &device);
+  ~DepthPyramid();
+
+  DepthPyramid(const DepthPyramid &) = delete;
+  DepthPyramid &operator=(const DepthPyramid &) = delete;
+
+  // Matches the pyramid to a depth attachment of this size. Waits for the
+  // device and recreates the image when it changes; returns true then, and
+  // the caller must drop cached sets that referenced the old views.
+  bool resize(VkExtent2D depthExtent);
+
+  // Moves a freshly created image into GENERAL, no-op afterwards
+  void prepare(VkCommandBuffer cmd);
+
+  // Reduces depthView (in DEPTH_READ_ONLY_OPTIMAL) into every mip, then
+  // makes the result visible to compute reads
+  void build(VkCommandBuffer cmd, VkImageView depthView, VkExtent2D extent,
+             DescriptorCache &descriptors);
+
+  VkImageView getView() const noexcept { return view; }
+  VkSampler getSampler() const noexcept { return sampler; }
+  VkExtent2D getExtent() const noexcept { return extent; }
+  uint32_t getMipCount() const noexcept { return mipCount; }
+
+private:
+  void create(VkExtent2D size);
+  void destroy();
+
+  Device &device;
+  ComputePipeline pipeline;
+  VkSampler sampler = VK_NULL_HANDLE;
+  VkImage image = VK_NULL_HANDLE;
+  Allocation memory;
+  // Whole chain for the cull shader, one view per mip for the reduction
+  VkImageView view = VK_NULL_HANDLE;
+  std::vector<VkImageView> mipViews;
+  VkExtent2D depthExtent{};
+  VkExtent2D extent{};
+  uint32_t mipCount = 0;
+  bool initialized = false;
+};
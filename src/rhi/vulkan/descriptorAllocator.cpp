@@ -0,0 +1,89 @@
+#include "rhi/vulkan/descriptorAllocator.h"
+#include "helper.h"
+#include <algorithm>
+
+DescriptorAllocator::DescriptorAllocator(
+    Device &device, std::span<const DescriptorPoolRatio> ratios,
+    uint32_t initialSets)
+    : device(device), ratios(ratios.begin(), ratios.end()),
+      setsPerPool(std::max(1u, initialSets)) {
+  readyPools.push_back(createPool(setsPerPool));
+}
+
+DescriptorAllocator::~DescriptorAllocator() {
+  for (VkDescriptorPool pool : fullPools)
+    vkDestroyDescriptorPool(device.getLogical(), pool, nullptr);
+  for (VkDescriptorPool pool : readyPools)
+    vkDestroyDescriptorPool(device.getLogical(), pool, nullptr);
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+  VkDescriptorPool pool = grabPool();
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = pool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &layout;
+
+  VkDescriptorSet set = VK_NULL_HANDLE;
+  VkResult result =
+      vkAllocateDescriptorSets(device.getLogical(), &allocInfo, &set);
+
+  // Pool exhausted, retire it and retry once from a fresh one
+  if (result == VK_ERROR_OUT_OF_POOL_MEMORY ||
+      result == VK_ERROR_FRAGMENTED_POOL) {
+    fullPools.push_back(pool);
+    pool = grabPool();
+    allocInfo.descriptorPool = pool;
+    result = vkAllocateDescriptorSets(device.getLogical(), &allocInfo, &set);
+  }
+  // Back in a list before VK_CHECK can throw, or it would never be destroyed
+  readyPools.push_back(pool);
+  VK_CHECK(result);
+  return set;
+}
+
+void DescriptorAllocator::reset() {
+  for (VkDescriptorPool pool : readyPools)
+    vkResetDescriptorPool(device.getLogical(), pool, 0);
+  for (VkDescriptorPool pool : fullPools) {
+    vkResetDescriptorPool(device.getLogical(), pool, 0);
+    readyPools.push_back(pool);
+  }
+  fullPools.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::grabPool() {
+  if (!readyPools.empty()) {
+    VkDescriptorPool pool = readyPools.back();
+    readyPools.pop_back();
+    return pool;
+  }
+
+  // Grow geometrically so a busy frame settles on a handful of pools
+  VkDescriptorPool pool = createPool(setsPerPool);
+  setsPerPool = std::min(setsPerPool + setsPerPool / 2, MaxSetsPerPool);
+  return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount) {
+  std::vector<VkDescriptorPoolSize> poolSizes;
+  poolSizes.reserve(ratios.size());
+  for (const DescriptorPoolRatio &r : ratios) {
+    uint32_t count =
+        std::max(1u, static_cast<uint32_t>(r.ratio * float(setCount)));
+    poolSizes.push_back({r.type, count});
+  }
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  poolInfo.maxSets = setCount;
+
+  VkDescriptorPool pool = VK_NULL_HANDLE;
+  VK_CHECK(
+      vkCreateDescriptorPool(device.getLogical(), &poolInfo, nullptr, &pool));
+  return pool;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "rhi/vulkan/device.h"
+#include <span>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Descriptors of a given type reserved per set in each pool
+struct DescriptorPoolRatio {
+  VkDescriptorType type;
+  float ratio;
+};
+
+// Growable descriptor allocator. Sets come from a list of pools; when the
+// current pool runs out a new, larger one is created. reset() recycles
+// every pool at once, which invalidates all sets handed out since the
+// last reset.
+class DescriptorAllocator {
+public:
+  DescriptorAllocator(Device &device,
+                      std::span<const DescriptorPoolRatio> ratios,
+                      uint32_t initialSets = 64);
+  ~DescriptorAllocator();
+
+  DescriptorAllocator(const DescriptorAllocator &) = delete;
+  DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+  VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+  void reset();
+
+  uint32_t getPoolCount() const noexcept {
+    return static_cast<uint32_t>(fullPools.size() + readyPools.size());
+  }
+
+private:
+  static constexpr uint32_t MaxSetsPerPool = 4096;
+
+  VkDescriptorPool grabPool();
+  VkDescriptorPool createPool(uint32_t setCount);
+
+  Device &device;
+  std::vector<DescriptorPoolRatio> ratios;
+  std::vector<VkDescriptorPool> fullPools;
+  std::vector<VkDescriptorPool> readyPools;
+  uint32_t setsPerPool;
+};
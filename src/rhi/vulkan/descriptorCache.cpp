@@ -0,0 +1,112 @@
+#include "rhi/vulkan/descriptorCache.h"
+#include "helper.h"
+#include <functional>
+
+namespace {
+const DescriptorPoolRatio PoolRatios[] = {
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2.f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.f},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f},
+};
+
+bool isImage(VkDescriptorType type) {
+  return type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+         type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+         type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+         type == VK_DESCRIPTOR_TYPE_SAMPLER;
+}
+
+template <typename T> void hashCombine(size_t &seed, const T &value) {
+  seed ^= std::hash<T>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) +
+          (seed >> 2);
+}
+} // namespace
+
+size_t DescriptorCache::KeyHash::operator()(const Key &key) const noexcept {
+  size_t seed = 0;
+  hashCombine(seed, static_cast<const void *>(key.layout));
+  for (const DescriptorBinding &b : key.bindings) {
+    hashCombine(seed, b.binding);
+    hashCombine(seed, static_cast<uint32_t>(b.type));
+    hashCombine(seed, static_cast<const void *>(b.buffer));
+    hashCombine(seed, b.offset);
+    hashCombine(seed, b.range);
+    hashCombine(seed, static_cast<const void *>(b.imageView));
+    hashCombine(seed, static_cast<const void *>(b.sampler));
+  }
+  return seed;
+}
+
+DescriptorCache::DescriptorCache(Device &device, uint32_t framesInFlight)
+    : device(device), persistent(device, PoolRatios) {
+  perFrame.reserve(framesInFlight);
+  for (uint32_t i = 0; i < framesInFlight; i++)
+    perFrame.push_back(
+        std::make_unique<DescriptorAllocator>(device, PoolRatios, 16));
+}
+
+void DescriptorCache::beginFrame(uint32_t frame) {
+  currentFrame = frame;
+  frameWrites = 0;
+  perFrame[frame]->reset();
+}
+
+VkDescriptorSet
+DescriptorCache::get(VkDescriptorSetLayout layout,
+                     std::span<const DescriptorBinding> bindings) {
+  Key key{layout, {bindings.begin(), bindings.end()}};
+  auto it = sets.find(key);
+  if (it != sets.end())
+    return it->second;
+
+  VkDescriptorSet set = persistent.allocate(layout);
+  write(set, bindings);
+  sets.emplace(std::move(key), set);
+  return set;
+}
+
+VkDescriptorSet
+DescriptorCache::getTransient(VkDescriptorSetLayout layout,
+                              std::span<const DescriptorBinding> bindings) {
+  VkDescriptorSet set = perFrame[currentFrame]->allocate(layout);
+  write(set, bindings);
+  return set;
+}
+
+void DescriptorCache::clear() {
+  sets.clear();
+  persistent.reset();
+}
+
+void DescriptorCache::write(VkDescriptorSet set,
+                            std::span<const DescriptorBinding> bindings) {
+  std::vector<VkDescriptorBufferInfo> bufferInfos(bindings.size());
+  std::vector<VkDescriptorImageInfo> imageInfos(bindings.size());
+  std::vector<VkWriteDescriptorSet> writes(bindings.size());
+
+  for (size_t i = 0; i < bindings.size(); i++) {
+    const DescriptorBinding &b = bindings[i];
+    VkWriteDescriptorSet &w = writes[i];
+    w.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    w.dstSet = set;
+    w.dstBinding = b.binding;
+    w.descriptorType = b.type;
+    w.descriptorCount = 1;
+
+    if (isImage(b.type)) {
+      imageInfos[i] = {b.sampler, b.imageView, b.imageLayout};
+      w.pImageInfo = &imageInfos[i];
+    } else {
+      bufferInfos[i] = {b.buffer, b.offset, b.range};
+      w.pBufferInfo = &bufferInfos[i];
+    }
+  }
+
+  vkUpdateDescriptorSets(device.getLogical(),
+                         static_cast<uint32_t>(writes.size()), writes.data(),
+                         0, nullptr);
+  frameWrites += static_cast<uint32_t>(writes.size());
+}
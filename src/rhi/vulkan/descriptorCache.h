@@ -0,0 +1,68 @@
+#pragma once
+#include "rhi/vulkan/descriptorAllocator.h"
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// One resource bound to a set. Buffer bindings use buffer/offset/range,
+// image bindings use sampler/imageView/imageLayout.
+struct DescriptorBinding {
+  uint32_t binding = 0;
+  VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize range = VK_WHOLE_SIZE;
+  VkSampler sampler = VK_NULL_HANDLE;
+  VkImageView imageView = VK_NULL_HANDLE;
+  VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  bool operator==(const DescriptorBinding &) const = default;
+};
+
+// Descriptor sets keyed by layout and binding contents. A set is written the
+// first time its contents are requested and reused afterwards; binding a
+// different resource produces a different key, so a set the GPU may still
+// be reading is never rewritten. Transient sets come from per-frame pools
+// that are reset when their frame slot comes around again.
+class DescriptorCache {
+public:
+  DescriptorCache(Device &device, uint32_t framesInFlight);
+
+  // Must only be called once the frame's fence has signaled
+  void beginFrame(uint32_t frame);
+
+  VkDescriptorSet get(VkDescriptorSetLayout layout,
+                      std::span<const DescriptorBinding> bindings);
+  // Set valid until this frame slot is reused, written every call
+  VkDescriptorSet getTransient(VkDescriptorSetLayout layout,
+                               std::span<const DescriptorBinding> bindings);
+
+  // Drops every cached set; the device must be idle
+  void clear();
+
+  // vkUpdateDescriptorSets writes since the last beginFrame
+  uint32_t getFrameWrites() const noexcept { return frameWrites; }
+  size_t getCachedSetCount() const noexcept { return sets.size(); }
+
+private:
+  struct Key {
+    VkDescriptorSetLayout layout;
+    std::vector<DescriptorBinding> bindings;
+
+    bool operator==(const Key &) const = default;
+  };
+  struct KeyHash {
+    size_t operator()(const Key &key) const noexcept;
+  };
+
+  void write(VkDescriptorSet set, std::span<const DescriptorBinding> bindings);
+
+  Device &device;
+  DescriptorAllocator persistent;
+  std::vector<std::unique_ptr<DescriptorAllocator>> perFrame;
+  std::unordered_map<Key, VkDescriptorSet, KeyHash> sets;
+  uint32_t currentFrame = 0;
+  uint32_t frameWrites = 0;
+};
@@ -8,6 +8,7 @@
 QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device,
                                              VkSurfaceKHR surface) {
   QueueFamilyIndices indices;
+  indices.needsPresent = surface != VK_NULL_HANDLE;
 
   uint32_t queueFamilyCount = 0;
   vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
@@ -16,23 +17,39 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device,
   vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount,
                                            queueFamilies.data());
 
+  // Transfer-only families map to the copy engines; a compute family that
+  // can copy is the next best thing
+  std::optional<uint32_t> computeFamily;
+
   int i = 0;
   for (const auto &queueFamily : queueFamilies) {
-    if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-      indices.graphicsFamily = i;
+    if (!indices.isComplete()) {
+      if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        indices.graphicsFamily = i;
+      }
+      if (indices.needsPresent) {
+        VkBool32 presentSupport = false;
+        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface,
+                                             &presentSupport);
+
+        if (presentSupport) {
+          indices.presentFamily = i;
+        }
+      }
     }
-    VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
-    if (presentSupport) {
-      indices.presentFamily = i;
-    }
-    if (indices.isComplete()) {
-      break;
+    VkQueueFlags flags = queueFamily.queueFlags;
+    if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+      if (!(flags & VK_QUEUE_COMPUTE_BIT) && !indices.transferFamily)
+        indices.transferFamily = i;
+      if ((flags & VK_QUEUE_COMPUTE_BIT) && !computeFamily)
+        computeFamily = i;
     }
 
     i++;
   }
+  if (!indices.transferFamily)
+    indices.transferFamily = computeFamily;
   return indices;
 }
 
@@ -59,8 +76,9 @@ bool Device::isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) {
 
   bool extensionsSupported = checkDeviceExtensionsSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  // Without a surface there is no swapchain to validate
+  bool swapChainAdequate = surface == VK_NULL_HANDLE;
+  if (extensionsSupported && surface != VK_NULL_HANDLE) {
     SwapchainSupportDetails swapChainSupport =
         Swapchain::querySwapchainSupport(device, surface);
     swapChainAdequate = !swapChainSupport.formats.empty() &&
@@ -86,7 +104,12 @@ uint32_t Device::findMemoryType(uint32_t typeFilter,
 }
 
 Device::Device(const Instance &instance, VkSurfaceKHR surface,
-               bool enableValidationLayers) {
+               bool enableValidationLayers)
+    : headless(surface == VK_NULL_HANDLE) {
+  if (!headless) {
+    deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+  }
+
   uint32_t deviceCount = 0;
   vkEnumeratePhysicalDevices(instance.getInstance(), &deviceCount, nullptr);
   if (deviceCount == 0) {
@@ -108,8 +131,13 @@ Device::Device(const Instance &instance, VkSurfaceKHR surface,
   queueFamilies = indices;
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-  std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(),
-                                            indices.presentFamily.value()};
+  std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value()};
+  if (indices.presentFamily.has_value()) {
+    uniqueQueueFamilies.insert(indices.presentFamily.value());
+  }
+  if (indices.transferFamily.has_value()) {
+    uniqueQueueFamilies.insert(indices.transferFamily.value());
+  }
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -121,10 +149,32 @@ Device::Device(const Instance &instance, VkSurfaceKHR surface,
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceVulkan12Features supported12{};
+  supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 supported{};
+  supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  supported.pNext = &supported12;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+
+  features.multiDrawIndirect = supported.features.multiDrawIndirect;
+  features.drawIndirectFirstInstance =
+      supported.features.drawIndirectFirstInstance;
+  features.drawIndirectCount = supported12.drawIndirectCount;
+
   VkPhysicalDeviceFeatures deviceFeatures{};
+  deviceFeatures.multiDrawIndirect = features.multiDrawIndirect;
+  deviceFeatures.drawIndirectFirstInstance =
+      features.drawIndirectFirstInstance;
+
+  VkPhysicalDeviceVulkan12Features features12{};
+  features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  features12.drawIndirectCount = features.drawIndirectCount;
+  // Core in 1.2, upload tickets are timeline values
+  features12.timelineSemaphore = VK_TRUE;
 
   VkPhysicalDeviceVulkan13Features features13{};
   features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+  features13.pNext = &features12;
   features13.dynamicRendering = VK_TRUE;
   features13.synchronization2 = VK_TRUE;
 
@@ -152,10 +202,22 @@ Device::Device(const Instance &instance, VkSurfaceKHR surface,
   VK_CHECK(vkCreateDevice(physicalDevice, &createInfo, nullptr, &device));
 
   vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-  vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+  if (!headless) {
+    vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+  }
+  transferQueue = graphicsQueue;
+  if (indices.transferFamily.has_value()) {
+    vkGetDeviceQueue(device, indices.transferFamily.value(), 0,
+                     &transferQueue);
+  }
+
+  allocator = std::make_unique<MemoryAllocator>(physicalDevice, device);
 }
 
-Device::~Device() { vkDestroyDevice(device, nullptr); }
+Device::~Device() {
+  allocator.reset();
+  vkDestroyDevice(device, nullptr);
+}
 
 VkDevice Device::getLogical() const noexcept { return device; }
 VkPhysicalDevice Device::getPhysical() const noexcept {
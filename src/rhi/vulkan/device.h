@@ -1,5 +1,7 @@
 #pragma once
 #include "rhi/vulkan/instance.h"
+#include "rhi/vulkan/memoryAllocator.h"
+#include <memory>
 #include <optional>
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -7,12 +9,25 @@
 struct QueueFamilyIndices {
   std::optional<uint32_t> graphicsFamily;
   std::optional<uint32_t> presentFamily;
+  // Family without graphics support that can copy, unset when there is none
+  // and uploads go through the graphics queue
+  std::optional<uint32_t> transferFamily;
+  // false when searching without a surface (headless)
+  bool needsPresent = true;
 
   bool isComplete() {
-    return graphicsFamily.has_value() && presentFamily.has_value();
+    return graphicsFamily.has_value() &&
+           (!needsPresent || presentFamily.has_value());
   }
 };
 
+// Optional features, enabled whenever the physical device supports them
+struct DeviceFeatures {
+  bool multiDrawIndirect = false;
+  bool drawIndirectFirstInstance = false;
+  bool drawIndirectCount = false;
+};
+
 class Device {
 public:
   Device(const Instance &instance, VkSurfaceKHR surface,
@@ -33,13 +48,25 @@ public:
   QueueFamilyIndices &getQueues() noexcept;
   VkQueue getGraphicsQueue() const noexcept;
   VkQueue getPresentQueue() const noexcept;
+  // The graphics queue when there is no separate transfer family
+  VkQueue getTransferQueue() const noexcept { return transferQueue; }
+  uint32_t getTransferFamily() const noexcept {
+    return queueFamilies.transferFamily.value_or(
+        queueFamilies.graphicsFamily.value());
+  }
+  bool isHeadless() const noexcept { return headless; }
+  MemoryAllocator &getAllocator() noexcept { return *allocator; }
+  const DeviceFeatures &getFeatures() const noexcept { return features; }
 
 private:
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
   QueueFamilyIndices queueFamilies;
   VkDevice device = VK_NULL_HANDLE;
-  VkQueue graphicsQueue;
-  VkQueue presentQueue;
-  const std::vector<const char *> deviceExtensions = {
-      VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  VkQueue graphicsQueue = VK_NULL_HANDLE;
+  VkQueue presentQueue = VK_NULL_HANDLE;
+  VkQueue transferQueue = VK_NULL_HANDLE;
+  bool headless = false;
+  DeviceFeatures features;
+  std::vector<const char *> deviceExtensions;
+  std::unique_ptr<MemoryAllocator> allocator;
 };
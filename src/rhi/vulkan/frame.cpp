@@ -5,8 +5,12 @@
 Frame::Frame(Device &device, VkSwapchainKHR swapchain, int maxFramesInFlight)
     : device(device), MAX_FRAMES_IN_FLIGHT(maxFramesInFlight) {
 
-  uint32_t imageCount = 0;
-  vkGetSwapchainImagesKHR(device.getLogical(), swapchain, &imageCount, nullptr);
+  // Headless rendering uses one offscreen image per frame in flight
+  uint32_t imageCount = MAX_FRAMES_IN_FLIGHT;
+  if (swapchain != VK_NULL_HANDLE) {
+    vkGetSwapchainImagesKHR(device.getLogical(), swapchain, &imageCount,
+                            nullptr);
+  }
   imagesInFlight.resize(imageCount, VK_NULL_HANDLE);
   imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   renderFinishedSemaphores.resize(imageCount);
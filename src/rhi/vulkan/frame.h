@@ -6,7 +6,8 @@
 
 class Frame {
 public:
-  Frame(Device &device, VkSwapchainKHR swapchain, int maxFramesInFlight = 2);
+  // Pass VK_NULL_HANDLE as the swapchain when rendering offscreen
+  Frame(Device &device, VkSwapchainKHR swapchain, int maxFramesInFlight = 3);
   ~Frame();
 
   int getMaxFramesInFlight() const noexcept { return MAX_FRAMES_IN_FLIGHT; }
@@ -0,0 +1,119 @@
+#include "rhi/vulkan/geometryPool.h"
+#include <stdexcept>
+
+GeometryPool::GeometryPool(Device &device, VkCommandPool commandPool,
+                           UploadQueue &uploads, const VertexLayout &layout,
+                           uint32_t maxVertices, uint32_t maxIndices,
+                           uint32_t maxShortIndices, uint32_t maxMeshlets)
+    : uploads(uploads), layout(layout), vertexBuffer(device, commandPool),
+      indexBuffer(device, commandPool), shortIndexBuffer(device, commandPool),
+      meshletBuffer(device, commandPool), vertexRanges(maxVertices),
+      indexRanges(maxIndices), shortIndexRanges(maxShortIndices),
+      meshletRanges(maxMeshlets) {
+  vertexBuffer.create(VkDeviceSize{maxVertices} * layout.getStride(),
+                      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  indexBuffer.create(VkDeviceSize{maxIndices} * sizeof(uint32_t),
+                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                         VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  shortIndexBuffer.create(VkDeviceSize{maxShortIndices} * sizeof(uint16_t),
+                          VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                              VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  meshletBuffer.create(VkDeviceSize{maxMeshlets} * sizeof(Meshlet),
+                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                           VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+GeometryRange GeometryPool::upload(std::span<const std::byte> vertexData,
+                                   std::span<const uint32_t> indices,
+                                   UploadTicket &ticket) {
+  return upload(vertexData, indices.data(),
+                static_cast<uint32_t>(indices.size()), VK_INDEX_TYPE_UINT32,
+                ticket);
+}
+
+GeometryRange GeometryPool::upload(std::span<const std::byte> vertexData,
+                                   std::span<const uint16_t> indices,
+                                   UploadTicket &ticket) {
+  return upload(vertexData, indices.data(),
+                static_cast<uint32_t>(indices.size()), VK_INDEX_TYPE_UINT16,
+                ticket);
+}
+
+GeometryRange GeometryPool::upload(std::span<const std::byte> vertexData,
+                                   const void *indices, uint32_t indexCount,
+                                   VkIndexType indexType,
+                                   UploadTicket &ticket) {
+  const uint32_t stride = layout.getStride();
+  if (vertexData.size() % stride != 0)
+    throw std::runtime_error("GeometryPool upload of partial vertices");
+  auto vertexCount = static_cast<uint32_t>(vertexData.size() / stride);
+
+  auto vertexOffset = vertexRanges.allocate(vertexCount);
+  if (!vertexOffset)
+    throw GeometryPoolFull("GeometryPool out of vertex space");
+
+  RangeAllocator &ranges = getIndexRanges(indexType);
+  auto firstIndex = ranges.allocate(indexCount);
+  if (!firstIndex) {
+    vertexRanges.free(*vertexOffset, vertexCount);
+    throw GeometryPoolFull("GeometryPool out of index space");
+  }
+
+  GeometryRange range;
+  range.vertexOffset = static_cast<int32_t>(*vertexOffset);
+  range.vertexCount = vertexCount;
+  range.firstIndex = *firstIndex;
+  range.indexCount = indexCount;
+  range.indexType = indexType;
+
+  const uint32_t indexSize = getIndexSize(indexType);
+  uploads.upload(vertexBuffer, vertexData.data(), vertexData.size(),
+                 VkDeviceSize{*vertexOffset} * stride);
+  // The later ticket covers both copies
+  ticket = uploads.upload(
+      indexType == VK_INDEX_TYPE_UINT16 ? shortIndexBuffer : indexBuffer,
+      indices, VkDeviceSize{indexCount} * indexSize,
+      VkDeviceSize{*firstIndex} * indexSize);
+  return range;
+}
+
+bool GeometryPool::uploadMeshlets(GeometryRange &range,
+                                  std::span<const Meshlet> meshlets,
+                                  UploadTicket &ticket) {
+  if (meshlets.empty())
+    return true;
+  auto count = static_cast<uint32_t>(meshlets.size());
+  auto first = meshletRanges.allocate(count);
+  if (!first)
+    return false;
+
+  range.firstMeshlet = *first;
+  range.meshletCount = count;
+  ticket = uploads.upload(meshletBuffer, meshlets.data(),
+                          meshlets.size_bytes(),
+                          VkDeviceSize{*first} * sizeof(Meshlet));
+  return true;
+}
+
+void GeometryPool::free(const GeometryRange &range) {
+  vertexRanges.free(static_cast<uint32_t>(range.vertexOffset),
+                    range.vertexCount);
+  getIndexRanges(range.indexType).free(range.firstIndex, range.indexCount);
+  if (range.meshletCount > 0)
+    meshletRanges.free(range.firstMeshlet, range.meshletCount);
+}
+
+void GeometryPool::bind(VkCommandBuffer cmd) const {
+  VkDeviceSize offset = 0;
+  VkBuffer vb = vertexBuffer.get();
+  vkCmdBindVertexBuffers(cmd, 0, 1, &vb, &offset);
+}
+
+void GeometryPool::bindIndices(VkCommandBuffer cmd, VkIndexType type) const {
+  vkCmdBindIndexBuffer(cmd, getIndexBuffer(type), 0, type);
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include "renderer/meshOptimizer.h"
+#include "rhi/vulkan/buffer.h"
+#include "rhi/vulkan/device.h"
+#include "rhi/vulkan/pipeline.h"
+#include "rhi/vulkan/rangeAllocator.h"
+#include "rhi/vulkan/uploadQueue.h"
+#include <span>
+#include <stdexcept>
+#include <vulkan/vulkan_core.h>
+
+// Where a mesh lives inside the shared vertex/index buffers, in elements.
+// Maps directly onto vkCmdDrawIndexed / VkDrawIndexedIndirectCommand, with
+// indexType selecting the index buffer firstIndex points into. Meshlets,
+// when uploaded, sit in the meshlet buffer.
+struct GeometryRange {
+  int32_t vertexOffset = 0;
+  uint32_t vertexCount = 0;
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+  uint32_t firstMeshlet = 0;
+  uint32_t meshletCount = 0;
+};
+
+// Thrown by GeometryPool::upload when no free range is large enough. The
+// pool may have enough free elements in total but too fragmented, so
+// freeing other meshes and trying again can succeed.
+class GeometryPoolFull : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+constexpr uint32_t getIndexSize(VkIndexType type) noexcept {
+  return type == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+}
+
+// One device-local vertex buffer shared by every mesh, and one index
+// buffer per index type, so all draws can be issued without rebinding
+// geometry beyond switching index types. Every vertex is stored in the
+// pool's one layout. A storage buffer holds the meshes' meshlets for the
+// cluster culling shader.
+class GeometryPool {
+public:
+  GeometryPool(Device &device, VkCommandPool commandPool,
+               UploadQueue &uploads, const VertexLayout &layout,
+               uint32_t maxVertices = 1u << 20,
+               uint32_t maxIndices = 1u << 22,
+               uint32_t maxShortIndices = 1u << 22,
+               uint32_t maxMeshlets = 1u << 16);
+
+  // vertexData holds whole vertices already encoded in getLayout(). Copies
+  // run asynchronously on the upload queue; ticket is set to the point
+  // after which draws may read the range. The index width picks the
+  // buffer; 16-bit indices halve the index fetch of meshes that fit.
+  GeometryRange upload(std::span<const std::byte> vertexData,
+                       std::span<const uint32_t> indices,
+                       UploadTicket &ticket);
+  GeometryRange upload(std::span<const std::byte> vertexData,
+                       std::span<const uint16_t> indices,
+                       UploadTicket &ticket);
+  // Adds meshlets over range's indices, after its upload; ticket moves to
+  // the later copy. Meshlets are optional: returns false and leaves range
+  // without them when the meshlet buffer is full.
+  bool uploadMeshlets(GeometryRange &range, std::span<const Meshlet> meshlets,
+                      UploadTicket &ticket);
+  void free(const GeometryRange &range);
+
+  // Binds the vertex buffer at offset 0, ranges are addressed via draw
+  // parameters. Index buffers are bound per type with bindIndices.
+  void bind(VkCommandBuffer cmd) const;
+  void bindIndices(VkCommandBuffer cmd, VkIndexType type) const;
+
+  const VertexLayout &getLayout() const noexcept { return layout; }
+
+  // Elements not handed out, possibly fragmented
+  uint32_t getFreeVertexCount() const noexcept {
+    return vertexRanges.getCapacity() - vertexRanges.getUsed();
+  }
+  uint32_t getFreeIndexCount(VkIndexType type) const noexcept {
+    const RangeAllocator &ranges = getIndexRanges(type);
+    return ranges.getCapacity() - ranges.getUsed();
+  }
+  uint32_t getFreeMeshletCount() const noexcept {
+    return meshletRanges.getCapacity() - meshletRanges.getUsed();
+  }
+
+  VkBuffer getVertexBuffer() const noexcept { return vertexBuffer.get(); }
+  VkBuffer getIndexBuffer(VkIndexType type) const noexcept {
+    return type == VK_INDEX_TYPE_UINT16 ? shortIndexBuffer.get()
+                                        : indexBuffer.get();
+  }
+  // Meshlet[maxMeshlets], read by the cluster culling shader
+  VkBuffer getMeshletBuffer() const noexcept { return meshletBuffer.get(); }
+
+private:
+  GeometryRange upload(std::span<const std::byte> vertexData,
+                       const void *indices, uint32_t indexCount,
+                       VkIndexType indexType, UploadTicket &ticket);
+
+  RangeAllocator &getIndexRanges(VkIndexType type) noexcept {
+    return type == VK_INDEX_TYPE_UINT16 ? shortIndexRanges : indexRanges;
+  }
+  const RangeAllocator &getIndexRanges(VkIndexType type) const noexcept {
+    return type == VK_INDEX_TYPE_UINT16 ? shortIndexRanges : indexRanges;
+  }
+
+  UploadQueue &uploads;
+  VertexLayout layout;
+  Buffer vertexBuffer;
+  Buffer indexBuffer;
+  Buffer shortIndexBuffer;
+  Buffer meshletBuffer;
+  RangeAllocator vertexRanges;
+  RangeAllocator indexRanges;
+  RangeAllocator shortIndexRanges;
+  RangeAllocator meshletRanges;
+};
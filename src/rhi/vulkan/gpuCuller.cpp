@@ -0,0 +1,207 @@
+#include "rhi/vulkan/gpuCuller.h"
+#include "renderer/renderItem.h"
+#include "renderer/uniforms.h"
+#include <algorithm>
+
+namespace {
+constexpr uint32_t GroupSize = 64;
+
+VkDescriptorSetLayoutBinding binding(uint32_t index, VkDescriptorType type) {
+  VkDescriptorSetLayoutBinding b{};
+  b.binding = index;
+  b.descriptorType = type;
+  b.descriptorCount = 1;
+  b.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  return b;
+}
+
+const VkDescriptorSetLayoutBinding CullBindings[] = {
+    binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC),
+    binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC),
+    binding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC),
+    binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC),
+    binding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC),
+    binding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+    binding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER),
+};
+} // namespace
+
+GpuCuller::GpuCuller(Device &device, uint32_t framesInFlight,
+                     uint32_t maxObjects)
+    : pipeline(device.getLogical(), "shaders/cull.spv", CullBindings,
+               sizeof(uint32_t)),
+      pyramid(device), visibility(device, VK_NULL_HANDLE),
+      cullObjectRing(device, framesInFlight,
+                     VkDeviceSize{maxObjects} * sizeof(CullObject)),
+      // Early and late phases each get a table
+      instanceRing(device, framesInFlight,
+                   VkDeviceSize{maxObjects} * 2 * sizeof(ObjectData)),
+      readbacks(framesInFlight) {
+  visibility.create(VkDeviceSize{std::max(maxObjects, 1u)} * sizeof(uint32_t),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void GpuCuller::beginFrame(uint32_t frame) {
+  currentFrame = frame;
+  cullObjectRing.beginFrame(frame);
+  instanceRing.beginFrame(frame);
+
+  // The records are host coherent and the shader's writes were made
+  // available to the host before the fence signaled
+  Readback &readback = readbacks[frame];
+  lastVisible = 0;
+  for (uint32_t i = 0; i < readback.count; i++) {
+    lastVisible += readback.records[i].instanceCount;
+    if (readback.lateRecords)
+      lastVisible += readback.lateRecords[i].instanceCount;
+  }
+  readback = {};
+}
+
+void GpuCuller::prepare(FrameData &frameData,
+                        std::span<const DrawBatch> batches,
+                        std::span<const uint32_t> objectIds,
+                        const Frustum &frustum, const CameraUBO &camera,
+                        UniformRing &uniforms) {
+  uint32_t objectCount = 0;
+  for (const DrawBatch &batch : batches)
+    objectCount += batch.instanceCount;
+
+  CullUBO params{};
+  params.view = camera.view;
+  params.proj = camera.proj;
+  std::copy(std::begin(frustum.planes), std::end(frustum.planes),
+            params.planes);
+  params.objectCount = objectCount;
+  params.pyramidWidth = pyramid.getExtent().width;
+  params.pyramidHeight = pyramid.getExtent().height;
+  params.pyramidMips = pyramid.getMipCount();
+  params.cameraPosition = glm::inverse(camera.view)[3];
+  frameData.cullParams = uniforms.push(params);
+
+  size_t count = std::max<uint32_t>(objectCount, 1);
+  frameData.cullObjects = cullObjectRing.allocate(count * sizeof(CullObject));
+  frameData.cullObjectRange = cullObjectRing.getFrameCapacity();
+  frameData.instances = instanceRing.allocate(count * 2 * sizeof(ObjectData));
+  frameData.instanceRange = instanceRing.getFrameCapacity();
+  frameData.objectCount = objectCount;
+  frameData.culler = this;
+
+  auto *records =
+      static_cast<VkDrawIndexedIndirectCommand *>(frameData.drawCommands.ptr);
+  auto *lateRecords = static_cast<VkDrawIndexedIndirectCommand *>(
+      frameData.lateDrawCommands.ptr);
+  auto *cullObjects = static_cast<CullObject *>(frameData.cullObjects.ptr);
+  for (uint32_t b = 0; b < batches.size(); b++) {
+    // The shader counts survivors up from zero
+    records[b].instanceCount = 0;
+    if (lateRecords) {
+      // Late survivors go to the second half of the instance table
+      lateRecords[b] = records[b];
+      lateRecords[b].firstInstance += objectCount;
+    }
+
+    const Bounds &bounds = batches[b].mesh->bounds;
+    glm::vec4 sphere(bounds.center, bounds.radius);
+    uint32_t drawIndex = batches[b].meshlets ? CullObject::NoDraw : b;
+    uint32_t first = batches[b].firstInstance;
+    for (uint32_t i = 0; i < batches[b].instanceCount; i++)
+      cullObjects[first + i] = {sphere, drawIndex, objectIds[first + i], {}};
+  }
+
+  readbacks[currentFrame] = {records, lateRecords, frameData.maxDraws};
+}
+
+void GpuCuller::record(VkCommandBuffer cmd, const FrameData &frameData) {
+  pyramid.prepare(cmd);
+  if (!visibilityCleared) {
+    // Nothing was visible before the first frame
+    vkCmdFillBuffer(cmd, visibility.get(), 0, VK_WHOLE_SIZE, 0);
+    visibilityCleared = true;
+  }
+
+  // The previous submission's late phase wrote the visibility this reads
+  VkMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+  barrier.srcStageMask =
+      VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT;
+  barrier.srcAccessMask =
+      VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+  barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+
+  VkDependencyInfo dep{};
+  dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  dep.memoryBarrierCount = 1;
+  dep.pMemoryBarriers = &barrier;
+  vkCmdPipelineBarrier2(cmd, &dep);
+
+  bool occlusion = frameData.lateDrawCommands.buffer != VK_NULL_HANDLE;
+  dispatch(cmd, frameData, occlusion ? Phase::Early : Phase::Frustum,
+           frameData.drawCommands);
+}
+
+void GpuCuller::recordLate(VkCommandBuffer cmd, const FrameData &frameData,
+                           const RenderTarget &target) {
+  pyramid.build(cmd, target.depthView, target.extent, *frameData.descriptors);
+  dispatch(cmd, frameData, Phase::Late, frameData.lateDrawCommands);
+}
+
+void GpuCuller::dispatch(VkCommandBuffer cmd, const FrameData &frameData,
+                         Phase phase, const RingAllocation &draws) {
+  const DescriptorBinding bindings[] = {
+      {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+       frameData.cullParams.buffer, 0, sizeof(CullUBO)},
+      {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, frameData.objects.buffer,
+       0, frameData.objectRange},
+      {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+       frameData.cullObjects.buffer, 0, frameData.cullObjectRange},
+      {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, draws.buffer, 0,
+       frameData.drawRange},
+      {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+       frameData.instances.buffer, 0, frameData.instanceRange},
+      {5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, visibility.get(), 0,
+       VK_WHOLE_SIZE},
+      {6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_NULL_HANDLE, 0,
+       VK_WHOLE_SIZE, pyramid.getSampler(), pyramid.getView(),
+       VK_IMAGE_LAYOUT_GENERAL}};
+  VkDescriptorSet set = frameData.descriptors->get(
+      pipeline.getDescriptorSetLayout(), bindings);
+  uint32_t offsets[] = {static_cast<uint32_t>(frameData.cullParams.offset),
+                        static_cast<uint32_t>(frameData.objects.offset),
+                        static_cast<uint32_t>(frameData.cullObjects.offset),
+                        static_cast<uint32_t>(draws.offset),
+                        static_cast<uint32_t>(frameData.instances.offset)};
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    pipeline.getPipeline());
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          pipeline.getPipelineLayout(), 0, 1, &set, 5,
+                          offsets);
+  uint32_t push = static_cast<uint32_t>(phase);
+  vkCmdPushConstants(cmd, pipeline.getPipelineLayout(),
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+  vkCmdDispatch(cmd, (frameData.objectCount + GroupSize - 1) / GroupSize, 1,
+                1);
+
+  // Counts and instances feed the indirect draw and the vertex shader; the
+  // host reads the counts back once the fence signals
+  VkMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+  barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+  barrier.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT |
+                         VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                         VK_PIPELINE_STAGE_2_HOST_BIT;
+  barrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT |
+                          VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+                          VK_ACCESS_2_HOST_READ_BIT;
+
+  VkDependencyInfo dep{};
+  dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  dep.memoryBarrierCount = 1;
+  dep.pMemoryBarriers = &barrier;
+  vkCmdPipelineBarrier2(cmd, &dep);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "renderer/drawBatch.h"
+#include "renderer/frameData.h"
+#include "renderer/frustum.h"
+#include "renderer/uniforms.h"
+#include "rhi/vulkan/buffer.h"
+#include "rhi/vulkan/computePipeline.h"
+#include "rhi/vulkan/depthPyramid.h"
+#include "rhi/vulkan/device.h"
+#include "rhi/vulkan/renderTarget.h"
+#include "rhi/vulkan/uniformRing.h"
+#include <span>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Compute frustum culling feeding the indirect draw path. The CPU writes
+// one draw record per batch with instanceCount = 0 and a bounding sphere per
+// object; the shader appends each visible object to its batch and copies
+// its ObjectData into a compacted instance table.
+//
+// With occlusion culling the work is split in two phases around a depth
+// pyramid. The early phase draws what was visible last frame, the pyramid
+// is rebuilt from that depth, and the late phase tests every object against
+// it, updates the visibility buffer and draws the newly visible ones.
+class GpuCuller {
+public:
+  GpuCuller(Device &device, uint32_t framesInFlight, uint32_t maxObjects);
+
+  // Rewinds this slot's rings and reads back what its last use kept.
+  // Call after the slot's fence waited, before the draw records are reused.
+  void beginFrame(uint32_t frame);
+
+  // Matches the depth pyramid to the render target. Returns true when it
+  // was recreated; the device is idle then and cached sets must be dropped.
+  bool resize(VkExtent2D depthExtent) { return pyramid.resize(depthExtent); }
+
+  // Fills the cull inputs for the batches in frameData's draw records and
+  // points frameData.instances at the compacted output table. objectIds
+  // gives each object's visibility slot, in object table order. Objects of
+  // meshlet batches are copied to their own slot of the table unculled.
+  void prepare(FrameData &frameData, std::span<const DrawBatch> batches,
+               std::span<const uint32_t> objectIds, const Frustum &frustum,
+               const CameraUBO &camera, UniformRing &uniforms);
+
+  // Frustum pass, or the early phase when frameData has late draw records.
+  // Dispatch plus the barrier that hands its output to the draws.
+  void record(VkCommandBuffer cmd, const FrameData &frameData);
+
+  // Rebuilds the pyramid from target's depth (in DEPTH_READ_ONLY_OPTIMAL)
+  // and runs the late phase into frameData.lateDrawCommands
+  void recordLate(VkCommandBuffer cmd, const FrameData &frameData,
+                  const RenderTarget &target);
+
+  // Instances that survived culling the last time the current slot ran
+  uint32_t getLastVisibleCount() const noexcept { return lastVisible; }
+  // Rebuilt by recordLate, shared with the meshlet culler
+  const DepthPyramid &getPyramid() const noexcept { return pyramid; }
+
+private:
+  // Push constant selecting what the shader does with a visible object
+  enum class Phase : uint32_t { Frustum, Early, Late };
+
+  struct Readback {
+    const VkDrawIndexedIndirectCommand *records = nullptr;
+    const VkDrawIndexedIndirectCommand *lateRecords = nullptr;
+    uint32_t count = 0;
+  };
+
+  void dispatch(VkCommandBuffer cmd, const FrameData &frameData, Phase phase,
+                const RingAllocation &draws);
+
+  ComputePipeline pipeline;
+  DepthPyramid pyramid;
+  // One uint per object, nonzero if it passed the last late phase. Shared
+  // by all frame slots, submissions touch it in queue order.
+  Buffer visibility;
+  bool visibilityCleared = false;
+  UniformRing cullObjectRing;
+  UniformRing instanceRing;
+  std::vector<Readback> readbacks;
+  uint32_t currentFrame = 0;
+  uint32_t lastVisible = 0;
+};
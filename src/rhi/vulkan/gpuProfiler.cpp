@@ -0,0 +1,118 @@
+#include "rhi/vulkan/gpuProfiler.h"
+#include "helper.h"
+#include <cstring>
+
+GpuProfiler::GpuProfiler(Device &device, uint32_t framesInFlight,
+                         uint32_t maxZones)
+    : device(device), maxZones(maxZones) {
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(device.getPhysical(), &props);
+
+  uint32_t familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysical(), &familyCount,
+                                           nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysical(), &familyCount,
+                                           families.data());
+
+  uint32_t validBits =
+      families[device.getQueues().graphicsFamily.value()].timestampValidBits;
+
+  supported = validBits > 0 && props.limits.timestampPeriod > 0.0f;
+  if (!supported)
+    return;
+
+  timestampPeriodNs = props.limits.timestampPeriod;
+  timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+  frames.resize(framesInFlight);
+  for (auto &f : frames) {
+    VkQueryPoolCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    info.queryCount = maxZones * 2;
+    VK_CHECK(vkCreateQueryPool(device.getLogical(), &info, nullptr, &f.pool));
+
+    f.zones.reserve(maxZones);
+  }
+  readback.resize(maxZones * 2);
+  results.reserve(maxZones);
+}
+
+GpuProfiler::~GpuProfiler() {
+  for (auto &f : frames) {
+    vkDestroyQueryPool(device.getLogical(), f.pool, nullptr);
+  }
+}
+
+void GpuProfiler::collect(uint32_t frame) {
+  if (!supported)
+    return;
+
+  FrameQueries &f = frames[frame];
+  if (f.zones.empty())
+    return;
+
+  uint32_t queryCount = static_cast<uint32_t>(f.zones.size()) * 2;
+  VkResult res = vkGetQueryPoolResults(
+      device.getLogical(), f.pool, 0, queryCount,
+      queryCount * sizeof(uint64_t), readback.data(), sizeof(uint64_t),
+      VK_QUERY_RESULT_64_BIT);
+
+  // Not ready means the caller polled before the fence; keep old results
+  if (res != VK_SUCCESS)
+    return;
+
+  results.clear();
+  for (size_t i = 0; i < f.zones.size(); i++) {
+    uint64_t begin = readback[i * 2] & timestampMask;
+    uint64_t end = readback[i * 2 + 1] & timestampMask;
+
+    GpuZone zone = f.zones[i];
+    zone.ms = end >= begin ? (end - begin) * timestampPeriodNs / 1e6 : 0.0;
+    results.push_back(zone);
+  }
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer cmd, uint32_t frame) {
+  if (!supported)
+    return;
+
+  recordingFrame = frame;
+  frames[frame].zones.clear();
+  vkCmdResetQueryPool(cmd, frames[frame].pool, 0, maxZones * 2);
+}
+
+uint32_t GpuProfiler::beginZone(VkCommandBuffer cmd, const char *name,
+                                uint32_t rangeBegin, uint32_t rangeEnd) {
+  if (!supported)
+    return InvalidZone;
+
+  FrameQueries &f = frames[recordingFrame];
+  if (f.zones.size() >= maxZones)
+    return InvalidZone;
+
+  uint32_t zone = static_cast<uint32_t>(f.zones.size());
+  f.zones.push_back({name, 0.0, rangeBegin, rangeEnd});
+
+  vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, f.pool,
+                       zone * 2);
+  return zone;
+}
+
+void GpuProfiler::endZone(VkCommandBuffer cmd, uint32_t zone) {
+  if (zone == InvalidZone)
+    return;
+
+  vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
+                       frames[recordingFrame].pool, zone * 2 + 1);
+}
+
+double GpuProfiler::getZoneMs(const char *name) const noexcept {
+  double ms = 0.0;
+  for (const auto &zone : results) {
+    if (std::strcmp(zone.name, name) == 0)
+      ms += zone.ms;
+  }
+  return ms;
+}
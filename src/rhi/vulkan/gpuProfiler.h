@@ -0,0 +1,60 @@
+#pragma once
+#include "rhi/vulkan/device.h"
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Result of one timestamp pair. Names are expected to be string literals.
+struct GpuZone {
+  const char *name = nullptr;
+  double ms = 0.0;
+  // Item range covered by draw-range zones, empty for pass zones
+  uint32_t rangeBegin = 0;
+  uint32_t rangeEnd = 0;
+};
+
+// Timestamp queries around regions of a frame's command buffer. Keeps one
+// query pool per frame in flight and only reads a pool back once the fence
+// of that frame slot has signaled, so polling never stalls the GPU.
+class GpuProfiler {
+public:
+  static constexpr uint32_t InvalidZone = UINT32_MAX;
+
+  GpuProfiler(Device &device, uint32_t framesInFlight, uint32_t maxZones = 256);
+  ~GpuProfiler();
+
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+  // Read back the previous use of this slot. Call after its fence waited.
+  void collect(uint32_t frame);
+  // Reset the slot's queries. Must be recorded outside of rendering.
+  void beginFrame(VkCommandBuffer cmd, uint32_t frame);
+
+  uint32_t beginZone(VkCommandBuffer cmd, const char *name,
+                     uint32_t rangeBegin = 0, uint32_t rangeEnd = 0);
+  void endZone(VkCommandBuffer cmd, uint32_t zone);
+
+  // Zones of the most recently completed frame, in recording order
+  const std::vector<GpuZone> &getResults() const noexcept { return results; }
+  // Sum of all zones named `name` in the latest results
+  double getZoneMs(const char *name) const noexcept;
+  bool isSupported() const noexcept { return supported; }
+
+private:
+  struct FrameQueries {
+    VkQueryPool pool = VK_NULL_HANDLE;
+    std::vector<GpuZone> zones;
+  };
+
+  Device &device;
+  bool supported = false;
+  double timestampPeriodNs = 1.0;
+  uint64_t timestampMask = ~0ull;
+  uint32_t maxZones;
+  uint32_t recordingFrame = 0;
+
+  std::vector<FrameQueries> frames;
+  std::vector<uint64_t> readback;
+  std::vector<GpuZone> results;
+};
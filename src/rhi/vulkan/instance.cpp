@@ -86,18 +86,20 @@ void Instance::setupDebugMessenger() {
                                         &debugMessenger));
 }
 
-Instance::Instance(bool enableValidationLayers)
+Instance::Instance(bool enableValidationLayers, bool headless)
     : enableValidationLayers(enableValidationLayers) {
   if (enableValidationLayers && !checkValidationLayerSupport()) {
     throw std::runtime_error("validation layers requested, but not available!");
   }
 
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions =
-      glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions,
-                                       glfwExtensions + glfwExtensionCount);
+  // Headless instances never create a surface, so GLFW is not needed
+  std::vector<const char *> extensions;
+  if (!headless) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions =
+        glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -4,7 +4,7 @@
 
 class Instance {
 public:
-  Instance(bool enableValidationLayers);
+  Instance(bool enableValidationLayers, bool headless = false);
   ~Instance();
 
   const std::vector<const char *> &getValidationLayers() const;
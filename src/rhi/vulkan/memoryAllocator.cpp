@@ -0,0 +1,472 @@
+#include "rhi/vulkan/memoryAllocator.h"
+#include "helper.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <stdexcept>
+
+namespace {
+
+// TLSF layout: the first level is log2 of the size, the second level splits
+// each power of two into SlCount linear classes.
+constexpr uint32_t SlLog2 = 4;
+constexpr uint32_t SlCount = 1u << SlLog2;
+constexpr uint32_t FlCount = 64;
+// Every node starts and ends on this granularity, so requests with smaller
+// alignment never need padding and leftover slivers are never tracked.
+constexpr VkDeviceSize NodeGranularity = 256;
+constexpr uint32_t NoNode = UINT32_MAX;
+
+uint32_t log2Floor(uint64_t v) {
+  return 63 - static_cast<uint32_t>(std::countl_zero(v));
+}
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+void mapping(VkDeviceSize size, uint32_t &fl, uint32_t &sl) {
+  fl = log2Floor(size);
+  sl = static_cast<uint32_t>(size >> (fl - SlLog2)) - SlCount;
+}
+
+} // namespace
+
+struct MemoryBlock {
+  struct Node {
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    uint32_t prevPhys = NoNode;
+    uint32_t nextPhys = NoNode;
+    uint32_t prevFree = NoNode;
+    uint32_t nextFree = NoNode;
+    bool free = false;
+    bool inUse = false;
+    VkDeviceSize requestedSize = 0;
+    VkDeviceSize alignment = 0;
+    void *userData = nullptr;
+  };
+
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  void *mapped = nullptr;
+  uint32_t memoryType = 0;
+
+  VkDeviceSize used = 0;
+  uint32_t liveCount = 0;
+
+  std::vector<Node> nodes;
+  std::vector<uint32_t> unusedNodes;
+  uint64_t flBitmap = 0;
+  std::array<uint32_t, FlCount> slBitmap{};
+  std::array<std::array<uint32_t, SlCount>, FlCount> heads;
+
+  explicit MemoryBlock(VkDeviceSize blockSize) : size(blockSize) {
+    for (auto &fl : heads)
+      fl.fill(NoNode);
+    insertFree(newNode(0, blockSize));
+  }
+
+  uint32_t newNode(VkDeviceSize offset, VkDeviceSize nodeSize) {
+    uint32_t index;
+    if (!unusedNodes.empty()) {
+      index = unusedNodes.back();
+      unusedNodes.pop_back();
+      nodes[index] = Node{};
+    } else {
+      index = static_cast<uint32_t>(nodes.size());
+      nodes.emplace_back();
+    }
+    nodes[index].offset = offset;
+    nodes[index].size = nodeSize;
+    return index;
+  }
+
+  void releaseNode(uint32_t index) {
+    nodes[index].inUse = false;
+    unusedNodes.push_back(index);
+  }
+
+  void insertFree(uint32_t index) {
+    uint32_t fl, sl;
+    mapping(nodes[index].size, fl, sl);
+
+    Node &node = nodes[index];
+    node.free = true;
+    node.prevFree = NoNode;
+    node.nextFree = heads[fl][sl];
+    if (node.nextFree != NoNode)
+      nodes[node.nextFree].prevFree = index;
+    heads[fl][sl] = index;
+
+    flBitmap |= 1ull << fl;
+    slBitmap[fl] |= 1u << sl;
+  }
+
+  void removeFree(uint32_t index) {
+    uint32_t fl, sl;
+    mapping(nodes[index].size, fl, sl);
+
+    Node &node = nodes[index];
+    if (node.prevFree != NoNode)
+      nodes[node.prevFree].nextFree = node.nextFree;
+    if (node.nextFree != NoNode)
+      nodes[node.nextFree].prevFree = node.prevFree;
+    if (heads[fl][sl] == index) {
+      heads[fl][sl] = node.nextFree;
+      if (heads[fl][sl] == NoNode) {
+        slBitmap[fl] &= ~(1u << sl);
+        if (slBitmap[fl] == 0)
+          flBitmap &= ~(1ull << fl);
+      }
+    }
+    node.free = false;
+    node.prevFree = NoNode;
+    node.nextFree = NoNode;
+  }
+
+  // Good-fit search: rounds the request up to the next class boundary so
+  // that any node in the class found is guaranteed to be large enough.
+  uint32_t findFree(VkDeviceSize request) const {
+    uint32_t fl = log2Floor(request);
+    VkDeviceSize rounded = request + (VkDeviceSize(1) << (fl - SlLog2)) - 1;
+    uint32_t sl;
+    mapping(rounded, fl, sl);
+    if (fl >= FlCount)
+      return NoNode;
+
+    uint32_t slMap = slBitmap[fl] & (~0u << sl);
+    if (slMap == 0) {
+      uint64_t flMap = fl + 1 < FlCount ? flBitmap & (~0ull << (fl + 1)) : 0;
+      if (flMap == 0)
+        return NoNode;
+      fl = static_cast<uint32_t>(std::countr_zero(flMap));
+      slMap = slBitmap[fl];
+    }
+    sl = static_cast<uint32_t>(std::countr_zero(slMap));
+    return heads[fl][sl];
+  }
+
+  uint32_t allocate(VkDeviceSize requestSize, VkDeviceSize alignment,
+                    void *userData) {
+    VkDeviceSize nodeSize = alignUp(requestSize, NodeGranularity);
+    // Node offsets are already NodeGranularity aligned
+    VkDeviceSize padding =
+        alignment > NodeGranularity ? alignment - NodeGranularity : 0;
+
+    uint32_t index = findFree(nodeSize + padding);
+    if (index == NoNode)
+      return NoNode;
+    removeFree(index);
+
+    // Hand any front padding back as its own free node
+    VkDeviceSize aligned = alignUp(nodes[index].offset, alignment);
+    VkDeviceSize front = aligned - nodes[index].offset;
+    if (front > 0) {
+      uint32_t head = newNode(nodes[index].offset, front);
+      nodes[head].prevPhys = nodes[index].prevPhys;
+      nodes[head].nextPhys = index;
+      if (nodes[head].prevPhys != NoNode)
+        nodes[nodes[head].prevPhys].nextPhys = head;
+      nodes[index].prevPhys = head;
+      nodes[index].offset = aligned;
+      nodes[index].size -= front;
+      insertFree(head);
+    }
+
+    // Split off the tail
+    if (nodes[index].size - nodeSize >= NodeGranularity) {
+      uint32_t tail = newNode(nodes[index].offset + nodeSize,
+                              nodes[index].size - nodeSize);
+      nodes[tail].prevPhys = index;
+      nodes[tail].nextPhys = nodes[index].nextPhys;
+      if (nodes[tail].nextPhys != NoNode)
+        nodes[nodes[tail].nextPhys].prevPhys = tail;
+      nodes[index].nextPhys = tail;
+      nodes[index].size = nodeSize;
+      insertFree(tail);
+    }
+
+    Node &node = nodes[index];
+    node.inUse = true;
+    node.requestedSize = requestSize;
+    node.alignment = alignment;
+    node.userData = userData;
+    used += node.size;
+    liveCount++;
+    return index;
+  }
+
+  void free(uint32_t index) {
+    used -= nodes[index].size;
+    liveCount--;
+    nodes[index].inUse = false;
+    nodes[index].userData = nullptr;
+
+    // Coalesce with free physical neighbours
+    uint32_t prev = nodes[index].prevPhys;
+    if (prev != NoNode && nodes[prev].free) {
+      removeFree(prev);
+      nodes[prev].size += nodes[index].size;
+      nodes[prev].nextPhys = nodes[index].nextPhys;
+      if (nodes[prev].nextPhys != NoNode)
+        nodes[nodes[prev].nextPhys].prevPhys = prev;
+      releaseNode(index);
+      index = prev;
+    }
+
+    uint32_t next = nodes[index].nextPhys;
+    if (next != NoNode && nodes[next].free) {
+      removeFree(next);
+      nodes[index].size += nodes[next].size;
+      nodes[index].nextPhys = nodes[next].nextPhys;
+      if (nodes[index].nextPhys != NoNode)
+        nodes[nodes[index].nextPhys].prevPhys = index;
+      releaseNode(next);
+    }
+
+    insertFree(index);
+  }
+
+  bool empty() const noexcept { return liveCount == 0; }
+};
+
+static Allocation makeAllocation(MemoryBlock &block, uint32_t node) {
+  const MemoryBlock::Node &n = block.nodes[node];
+
+  Allocation a;
+  a.memory = block.memory;
+  a.offset = n.offset;
+  a.size = n.requestedSize;
+  a.mapped = block.mapped ? static_cast<char *>(block.mapped) + n.offset
+                          : nullptr;
+  a.memoryType = block.memoryType;
+  a.block = &block;
+  a.node = node;
+  return a;
+}
+
+MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice,
+                                 VkDevice device,
+                                 VkDeviceSize preferredBlockSize)
+    : device(device), preferredBlockSize(preferredBlockSize) {
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+}
+
+MemoryAllocator::~MemoryAllocator() {
+  for (auto &pool : pools) {
+    for (auto &block : pool.blocks) {
+      vkFreeMemory(device, block->memory, nullptr);
+    }
+  }
+}
+
+uint32_t MemoryAllocator::findMemoryType(
+    uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (memoryProperties.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
+      return i;
+    }
+  }
+
+  throw std::runtime_error("Failed to find suitable memory type");
+}
+
+MemoryAllocator::Pool &MemoryAllocator::getPool(uint32_t memoryType,
+                                                AllocationKind kind) {
+  for (auto &pool : pools) {
+    if (pool.memoryType == memoryType && pool.kind == kind)
+      return pool;
+  }
+  Pool &pool = pools.emplace_back();
+  pool.memoryType = memoryType;
+  pool.kind = kind;
+  return pool;
+}
+
+MemoryBlock &MemoryAllocator::createBlock(Pool &pool, VkDeviceSize minSize) {
+  // Small heaps (integrated / software devices) get smaller blocks
+  uint32_t heap = memoryProperties.memoryTypes[pool.memoryType].heapIndex;
+  VkDeviceSize heapSize = memoryProperties.memoryHeaps[heap].size;
+  VkDeviceSize blockSize = preferredBlockSize;
+  if (heapSize <= 1024ull * 1024 * 1024)
+    blockSize = std::min(blockSize, alignUp(heapSize / 8, NodeGranularity));
+  blockSize = std::max(blockSize, alignUp(minSize, NodeGranularity));
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = blockSize;
+  allocInfo.memoryTypeIndex = pool.memoryType;
+
+  auto block = std::make_unique<MemoryBlock>(blockSize);
+  block->memoryType = pool.memoryType;
+  VK_CHECK(vkAllocateMemory(device, &allocInfo, nullptr, &block->memory));
+
+  if (memoryProperties.memoryTypes[pool.memoryType].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    VK_CHECK(vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0,
+                         &block->mapped));
+  }
+
+  pool.blocks.push_back(std::move(block));
+  return *pool.blocks.back();
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+                                     VkMemoryPropertyFlags properties,
+                                     AllocationKind kind, void *userData) {
+  uint32_t memoryType =
+      findMemoryType(requirements.memoryTypeBits, properties);
+  Pool &pool = getPool(memoryType, kind);
+
+  for (auto &block : pool.blocks) {
+    uint32_t node =
+        block->allocate(requirements.size, requirements.alignment, userData);
+    if (node != NoNode)
+      return makeAllocation(*block, node);
+  }
+
+  MemoryBlock &block =
+      createBlock(pool, requirements.size + requirements.alignment);
+  uint32_t node =
+      block.allocate(requirements.size, requirements.alignment, userData);
+  if (node == NoNode)
+    throw std::runtime_error("Failed to sub-allocate device memory");
+  return makeAllocation(block, node);
+}
+
+void MemoryAllocator::free(Allocation &allocation) {
+  if (allocation.block == nullptr)
+    return;
+
+  MemoryBlock *block = allocation.block;
+  block->free(allocation.node);
+  allocation = Allocation{};
+
+  if (block->empty()) {
+    uint32_t memoryType = block->memoryType;
+    for (auto &pool : pools) {
+      if (pool.memoryType == memoryType) {
+        releaseEmptyBlocks(pool);
+      }
+    }
+  }
+}
+
+// Keep one empty block per pool around so a free/alloc pair at the boundary
+// does not thrash vkAllocateMemory.
+void MemoryAllocator::releaseEmptyBlocks(Pool &pool) {
+  bool keptOne = false;
+  for (auto it = pool.blocks.begin(); it != pool.blocks.end();) {
+    if ((*it)->empty()) {
+      if (keptOne) {
+        vkFreeMemory(device, (*it)->memory, nullptr);
+        it = pool.blocks.erase(it);
+        continue;
+      }
+      keptOne = true;
+    }
+    ++it;
+  }
+}
+
+Allocation MemoryAllocator::allocateForBuffer(VkBuffer buffer,
+                                              VkMemoryPropertyFlags properties,
+                                              void *userData) {
+  VkMemoryRequirements memReq;
+  vkGetBufferMemoryRequirements(device, buffer, &memReq);
+
+  Allocation allocation =
+      allocate(memReq, properties, AllocationKind::Linear, userData);
+  VK_CHECK(vkBindBufferMemory(device, buffer, allocation.memory,
+                              allocation.offset));
+  return allocation;
+}
+
+Allocation MemoryAllocator::allocateForImage(VkImage image,
+                                             VkMemoryPropertyFlags properties,
+                                             void *userData) {
+  VkMemoryRequirements memReq;
+  vkGetImageMemoryRequirements(device, image, &memReq);
+
+  Allocation allocation =
+      allocate(memReq, properties, AllocationKind::Optimal, userData);
+  VK_CHECK(
+      vkBindImageMemory(device, image, allocation.memory, allocation.offset));
+  return allocation;
+}
+
+std::vector<DefragmentationMove>
+MemoryAllocator::planDefragmentation(VkDeviceSize maxBytes) {
+  std::vector<DefragmentationMove> moves;
+  VkDeviceSize planned = 0;
+
+  for (auto &pool : pools) {
+    if (pool.blocks.size() < 2)
+      continue;
+
+    // Emptiest blocks first: those are the ones we want to drain
+    std::vector<MemoryBlock *> order;
+    for (auto &block : pool.blocks)
+      order.push_back(block.get());
+    std::sort(order.begin(), order.end(),
+              [](const MemoryBlock *a, const MemoryBlock *b) {
+                return a->used < b->used;
+              });
+
+    // Drain the emptier half into the fuller half, so a planned destination
+    // is never picked as a source again
+    size_t half = order.size() / 2;
+    for (size_t src = 0; src < half; src++) {
+      MemoryBlock &from = *order[src];
+      for (uint32_t n = 0; n < from.nodes.size(); n++) {
+        const MemoryBlock::Node &node = from.nodes[n];
+        if (!node.inUse)
+          continue;
+        if (planned + node.size > maxBytes)
+          return moves;
+
+        for (size_t dst = order.size() - 1; dst >= half; dst--) {
+          MemoryBlock &to = *order[dst];
+          uint32_t target = to.allocate(from.nodes[n].requestedSize,
+                                        from.nodes[n].alignment,
+                                        from.nodes[n].userData);
+          if (target == NoNode)
+            continue;
+
+          DefragmentationMove move;
+          move.userData = from.nodes[n].userData;
+          move.src = makeAllocation(from, n);
+          move.dst = makeAllocation(to, target);
+          moves.push_back(move);
+          planned += from.nodes[n].size;
+          break;
+        }
+      }
+    }
+  }
+  return moves;
+}
+
+void MemoryAllocator::completeMove(DefragmentationMove &move) {
+  free(move.src);
+}
+
+void MemoryAllocator::cancelMove(DefragmentationMove &move) {
+  free(move.dst);
+}
+
+MemoryStats MemoryAllocator::getStats() const noexcept {
+  MemoryStats stats;
+  for (const auto &pool : pools) {
+    for (const auto &block : pool.blocks) {
+      stats.blockCount++;
+      stats.allocationCount += block->liveCount;
+      stats.bytesReserved += block->size;
+      stats.bytesUsed += block->used;
+    }
+  }
+  return stats;
+}
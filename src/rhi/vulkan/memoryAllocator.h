@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Buffers and linear images vs optimal-tiling images. The two never share a
+// block, so bufferImageGranularity can never put them on the same page.
+enum class AllocationKind { Linear, Optimal };
+
+struct MemoryBlock;
+
+struct Allocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;
+  // Host-visible blocks stay mapped for their whole lifetime
+  void *mapped = nullptr;
+  uint32_t memoryType = 0;
+
+  // Owner bookkeeping, used by the allocator only
+  MemoryBlock *block = nullptr;
+  uint32_t node = 0;
+
+  explicit operator bool() const noexcept { return memory != VK_NULL_HANDLE; }
+};
+
+struct MemoryStats {
+  uint32_t blockCount = 0;
+  uint32_t allocationCount = 0;
+  VkDeviceSize bytesReserved = 0; // sum of vkAllocateMemory sizes
+  VkDeviceSize bytesUsed = 0;     // sum of live allocation sizes
+};
+
+// A proposed relocation. `dst` is already reserved; the owner copies the
+// contents, rebinds its resource and then calls completeMove, or cancelMove
+// to give `dst` back.
+struct DefragmentationMove {
+  void *userData = nullptr;
+  Allocation src;
+  Allocation dst;
+};
+
+// Sub-allocates device memory out of large per-memory-type blocks, using a
+// TLSF (two-level segregated fit) free list per block so allocation and
+// free are O(1) and neighbouring free ranges coalesce immediately.
+class MemoryAllocator {
+public:
+  MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device,
+                  VkDeviceSize preferredBlockSize = 64ull * 1024 * 1024);
+  ~MemoryAllocator();
+
+  MemoryAllocator(const MemoryAllocator &) = delete;
+  MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+
+  Allocation allocate(const VkMemoryRequirements &requirements,
+                      VkMemoryPropertyFlags properties, AllocationKind kind,
+                      void *userData = nullptr);
+  void free(Allocation &allocation);
+
+  // Convenience wrappers that also bind the memory
+  Allocation allocateForBuffer(VkBuffer buffer,
+                               VkMemoryPropertyFlags properties,
+                               void *userData = nullptr);
+  Allocation allocateForImage(VkImage image, VkMemoryPropertyFlags properties,
+                              void *userData = nullptr);
+
+  // Defragmentation hooks. Plans moves out of the emptiest blocks of each
+  // pool into free space in fuller ones, up to maxBytes in total.
+  std::vector<DefragmentationMove> planDefragmentation(VkDeviceSize maxBytes);
+  void completeMove(DefragmentationMove &move);
+  void cancelMove(DefragmentationMove &move);
+
+  MemoryStats getStats() const noexcept;
+
+private:
+  struct Pool {
+    uint32_t memoryType = 0;
+    AllocationKind kind = AllocationKind::Linear;
+    std::vector<std::unique_ptr<MemoryBlock>> blocks;
+  };
+
+  uint32_t findMemoryType(uint32_t typeFilter,
+                          VkMemoryPropertyFlags properties) const;
+  Pool &getPool(uint32_t memoryType, AllocationKind kind);
+  MemoryBlock &createBlock(Pool &pool, VkDeviceSize minSize);
+  void releaseEmptyBlocks(Pool &pool);
+
+  VkDevice device;
+  VkPhysicalDeviceMemoryProperties memoryProperties{};
+  VkDeviceSize preferredBlockSize;
+  std::vector<Pool> pools;
+};
@@ -0,0 +1,309 @@
+#include "rhi/vulkan/meshletCuller.h"
+#include "renderer/renderItem.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// Meshlets per task, the shader's group size
+constexpr uint32_t GroupSize = 64;
+// One workgroup per task along x, the guaranteed dispatch limit
+constexpr uint32_t MaxTasks = 65535;
+constexpr uint32_t RecordSize = sizeof(VkDrawIndexedIndirectCommand);
+
+VkDescriptorSetLayoutBinding binding(uint32_t index, VkDescriptorType type) {
+  VkDescriptorSetLayoutBinding b{};
+  b.binding = index;
+  b.descriptorType = type;
+  b.descriptorCount = 1;
+  b.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  return b;
+}
+
+const VkDescriptorSetLayoutBinding MeshletBindings[] = {
+    binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC),
+    binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC),
+    binding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+    binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC),
+    binding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC),
+    binding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC),
+    binding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+    binding(7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER),
+};
+
+// Phase, then where the 32-bit index records start
+struct Push {
+  uint32_t phase;
+  uint32_t longFirst;
+};
+
+uint32_t region(VkIndexType type) {
+  return type == VK_INDEX_TYPE_UINT16 ? 0 : 1;
+}
+} // namespace
+
+MeshletCuller::MeshletCuller(Device &device, uint32_t framesInFlight,
+                             const DepthPyramid &pyramid, uint32_t maxDraws,
+                             uint32_t maxVisibility)
+    : pipeline(device.getLogical(), "shaders/meshletCull.spv",
+               MeshletBindings, sizeof(Push)),
+      pyramid(pyramid), maxDraws(maxDraws), maxVisibility(maxVisibility),
+      visibility(device, VK_NULL_HANDLE),
+      // A task holds at least one meshlet
+      taskRing(device, framesInFlight,
+               VkDeviceSize{maxDraws} * sizeof(MeshletTask)),
+      // Two passes of records plus room for the aligned counts
+      drawRing(device, framesInFlight,
+               VkDeviceSize{maxDraws} * 2 * RecordSize + 1024,
+               VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT),
+      readbacks(framesInFlight) {
+  visibility.create(VkDeviceSize{std::max(maxVisibility, 1u)} *
+                        sizeof(uint32_t),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void MeshletCuller::beginFrame(uint32_t frame) {
+  currentFrame = frame;
+  taskRing.beginFrame(frame);
+  drawRing.beginFrame(frame);
+
+  // Host coherent, made available before the fence signaled
+  Readback &readback = readbacks[frame];
+  lastVisible = 0;
+  for (uint32_t r = 0; r < 2; r++) {
+    if (readback.counts)
+      lastVisible += readback.counts[r];
+    if (readback.lateCounts)
+      lastVisible += readback.lateCounts[r];
+  }
+  readback = {};
+}
+
+void MeshletCuller::assign(std::span<DrawBatch> batches,
+                           std::span<RenderItem *const> items,
+                           std::span<const uint32_t> objectIds) {
+  // Slots only move when the items or their meshes do, like the objects'
+  slots.resize(items.size());
+  uint32_t nextSlot = 0;
+  for (size_t i = 0; i < items.size(); i++) {
+    uint32_t count = items[i]->mesh->geometry.meshletCount;
+    slots[i] = NoSlot;
+    if (count >= MinMeshlets && count <= maxVisibility - nextSlot) {
+      slots[i] = nextSlot;
+      nextSlot += count;
+    }
+  }
+
+  uint32_t records = 0;
+  uint32_t tasks = 0;
+  for (DrawBatch &batch : batches) {
+    uint32_t count = batch.mesh->geometry.meshletCount;
+    uint64_t batchTasks =
+        uint64_t{(count + GroupSize - 1) / GroupSize} * batch.instanceCount;
+    batch.meshlets = false;
+    // Transparent batches keep their back-to-front order
+    if (batch.material->transparent || batch.lod != 0 ||
+        count < MinMeshlets ||
+        uint64_t{count} * batch.instanceCount > maxDraws - records ||
+        batchTasks > MaxTasks - tasks)
+      continue;
+
+    bool tracked = true;
+    for (uint32_t i = 0; i < batch.instanceCount && tracked; i++)
+      tracked = slots[objectIds[batch.firstInstance + i]] != NoSlot;
+    if (!tracked)
+      continue;
+
+    batch.meshlets = true;
+    records += count * batch.instanceCount;
+    tasks += static_cast<uint32_t>(batchTasks);
+  }
+}
+
+void MeshletCuller::prepare(FrameData &frameData,
+                            std::span<const DrawBatch> batches,
+                            std::span<const uint32_t> objectIds) {
+  uint32_t taskCount = 0;
+  uint32_t records[2] = {};
+  for (const DrawBatch &batch : batches) {
+    if (!batch.meshlets)
+      continue;
+    const GeometryRange &geometry = batch.mesh->geometry;
+    uint32_t perObject = (geometry.meshletCount + GroupSize - 1) / GroupSize;
+    taskCount += perObject * batch.instanceCount;
+    records[region(geometry.indexType)] +=
+        geometry.meshletCount * batch.instanceCount;
+  }
+  if (taskCount == 0)
+    return;
+
+  frameData.meshletTasks =
+      taskRing.allocate(VkDeviceSize{taskCount} * sizeof(MeshletTask));
+  frameData.meshletTaskCount = taskCount;
+  frameData.meshletRecords[0] = records[0];
+  frameData.meshletRecords[1] = records[1];
+  frameData.meshletCuller = this;
+
+  auto *task = static_cast<MeshletTask *>(frameData.meshletTasks.ptr);
+  for (const DrawBatch &batch : batches) {
+    if (!batch.meshlets)
+      continue;
+    const GeometryRange &geometry = batch.mesh->geometry;
+    for (uint32_t i = 0; i < batch.instanceCount; i++) {
+      uint32_t object = batch.firstInstance + i;
+      uint32_t slot = slots[objectIds[object]];
+      for (uint32_t first = 0; first < geometry.meshletCount;
+           first += GroupSize) {
+        *task++ = {object,
+                   geometry.firstMeshlet + first,
+                   std::min(GroupSize, geometry.meshletCount - first),
+                   slot + first,
+                   geometry.firstIndex,
+                   geometry.vertexOffset,
+                   region(geometry.indexType),
+                   0};
+      }
+    }
+  }
+
+  // Without the count buffer every record is drawn, unwritten ones must
+  // draw nothing
+  size_t recordBytes = size_t{records[0] + records[1]} * RecordSize;
+  auto allocateRecords = [&](RingAllocation &draws, RingAllocation &counts) {
+    draws = drawRing.allocate(recordBytes);
+    std::memset(draws.ptr, 0, recordBytes);
+    counts = drawRing.allocate(2 * sizeof(uint32_t));
+    std::memset(counts.ptr, 0, 2 * sizeof(uint32_t));
+  };
+  allocateRecords(frameData.meshletDraws, frameData.meshletCounts);
+  Readback &readback = readbacks[currentFrame];
+  readback.counts = static_cast<const uint32_t *>(frameData.meshletCounts.ptr);
+  if (frameData.lateDrawCommands.buffer != VK_NULL_HANDLE) {
+    allocateRecords(frameData.lateMeshletDraws, frameData.lateMeshletCounts);
+    readback.lateCounts =
+        static_cast<const uint32_t *>(frameData.lateMeshletCounts.ptr);
+  }
+}
+
+void MeshletCuller::record(VkCommandBuffer cmd, const FrameData &frameData) {
+  if (!visibilityCleared) {
+    // Nothing was visible before the first frame
+    vkCmdFillBuffer(cmd, visibility.get(), 0, VK_WHOLE_SIZE, 0);
+    visibilityCleared = true;
+  }
+
+  // The previous submission's late phase wrote the visibility this reads
+  VkMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+  barrier.srcStageMask =
+      VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT;
+  barrier.srcAccessMask =
+      VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+  barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+
+  VkDependencyInfo dep{};
+  dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  dep.memoryBarrierCount = 1;
+  dep.pMemoryBarriers = &barrier;
+  vkCmdPipelineBarrier2(cmd, &dep);
+
+  bool occlusion = frameData.lateMeshletDraws.buffer != VK_NULL_HANDLE;
+  dispatch(cmd, frameData, occlusion ? Phase::Early : Phase::Frustum,
+           frameData.meshletDraws, frameData.meshletCounts);
+}
+
+void MeshletCuller::recordLate(VkCommandBuffer cmd,
+                               const FrameData &frameData) {
+  dispatch(cmd, frameData, Phase::Late, frameData.lateMeshletDraws,
+           frameData.lateMeshletCounts);
+}
+
+uint32_t MeshletCuller::draw(VkCommandBuffer cmd, const FrameData &frameData,
+                             bool late) const {
+  const RingAllocation &draws =
+      late ? frameData.lateMeshletDraws : frameData.meshletDraws;
+  const RingAllocation &counts =
+      late ? frameData.lateMeshletCounts : frameData.meshletCounts;
+  const VkIndexType types[2] = {VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32};
+
+  uint32_t calls = 0;
+  VkDeviceSize first = 0;
+  for (uint32_t r = 0; r < 2; r++) {
+    uint32_t capacity = frameData.meshletRecords[r];
+    if (capacity == 0)
+      continue;
+    frameData.geometry->bindIndices(cmd, types[r]);
+    if (frameData.useDrawCount) {
+      vkCmdDrawIndexedIndirectCount(
+          cmd, draws.buffer, draws.offset + first * RecordSize, counts.buffer,
+          counts.offset + r * sizeof(uint32_t), capacity, RecordSize);
+    } else {
+      // Records past the count were zeroed and draw nothing
+      vkCmdDrawIndexedIndirect(cmd, draws.buffer,
+                               draws.offset + first * RecordSize, capacity,
+                               RecordSize);
+    }
+    calls++;
+    first += capacity;
+  }
+  return calls;
+}
+
+void MeshletCuller::dispatch(VkCommandBuffer cmd, const FrameData &frameData,
+                             Phase phase, const RingAllocation &draws,
+                             const RingAllocation &counts) {
+  const DescriptorBinding bindings[] = {
+      {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+       frameData.cullParams.buffer, 0, sizeof(CullUBO)},
+      {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, frameData.objects.buffer,
+       0, frameData.objectRange},
+      {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+       frameData.geometry->getMeshletBuffer(), 0, VK_WHOLE_SIZE},
+      {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+       frameData.meshletTasks.buffer, 0, taskRing.getFrameCapacity()},
+      {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, draws.buffer, 0,
+       VkDeviceSize{maxDraws} * RecordSize},
+      {5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, counts.buffer, 0,
+       2 * sizeof(uint32_t)},
+      {6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, visibility.get(), 0,
+       VK_WHOLE_SIZE},
+      {7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_NULL_HANDLE, 0,
+       VK_WHOLE_SIZE, pyramid.getSampler(), pyramid.getView(),
+       VK_IMAGE_LAYOUT_GENERAL}};
+  VkDescriptorSet set = frameData.descriptors->get(
+      pipeline.getDescriptorSetLayout(), bindings);
+  uint32_t offsets[] = {static_cast<uint32_t>(frameData.cullParams.offset),
+                        static_cast<uint32_t>(frameData.objects.offset),
+                        static_cast<uint32_t>(frameData.meshletTasks.offset),
+                        static_cast<uint32_t>(draws.offset),
+                        static_cast<uint32_t>(counts.offset)};
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    pipeline.getPipeline());
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          pipeline.getPipelineLayout(), 0, 1, &set, 5,
+                          offsets);
+  Push push{static_cast<uint32_t>(phase), frameData.meshletRecords[0]};
+  vkCmdPushConstants(cmd, pipeline.getPipelineLayout(),
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+  vkCmdDispatch(cmd, frameData.meshletTaskCount, 1, 1);
+
+  // Records and counts feed the indirect draws; the host reads the counts
+  // back once the fence signals
+  VkMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+  barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+  barrier.dstStageMask =
+      VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_HOST_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_HOST_READ_BIT;
+
+  VkDependencyInfo dep{};
+  dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  dep.memoryBarrierCount = 1;
+  dep.pMemoryBarriers = &barrier;
+  vkCmdPipelineBarrier2(cmd, &dep);
+}
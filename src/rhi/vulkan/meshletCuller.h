@@ -0,0 +1,99 @@
+#pragma once
+#include "renderer/drawBatch.h"
+#include "renderer/frameData.h"
+#include "renderer/uniforms.h"
+#include "rhi/vulkan/buffer.h"
+#include "rhi/vulkan/computePipeline.h"
+#include "rhi/vulkan/depthPyramid.h"
+#include "rhi/vulkan/device.h"
+#include "rhi/vulkan/uniformRing.h"
+#include <span>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+struct RenderItem;
+
+// Cluster culling on top of GpuCuller. Batches of meshes with enough
+// meshlets are drawn per meshlet instead of per instance: a compute pass
+// tests every meshlet of every instance against the frustum, its backface
+// cone and, with occlusion culling, the depth pyramid, and appends one
+// draw record per survivor. Records are split by index type so each half
+// is one indirect call.
+//
+// Meshlet visibility follows the objects' two phases: the early dispatch
+// draws meshlets visible last frame, the late one tests all of them
+// against the pyramid the early draws built.
+class MeshletCuller {
+public:
+  // maxDraws bounds the meshlet records of one dispatch, maxVisibility the
+  // meshlets of all items tracked for occlusion
+  MeshletCuller(Device &device, uint32_t framesInFlight,
+                const DepthPyramid &pyramid, uint32_t maxDraws = 1u << 17,
+                uint32_t maxVisibility = 1u << 20);
+
+  // Rewinds this slot's rings and reads back what its last use counted.
+  // Call after the slot's fence waited.
+  void beginFrame(uint32_t frame);
+
+  // Marks the batches to draw per meshlet: opaque, full level of detail,
+  // at least MinMeshlets meshlets and room left in the record, task and
+  // visibility budgets. items is the draw list, objectIds each object's
+  // index into it in object table order.
+  void assign(std::span<DrawBatch> batches,
+              std::span<RenderItem *const> items,
+              std::span<const uint32_t> objectIds);
+
+  // Writes the tasks and zeroed records of the marked batches into
+  // frameData, objectIds as given to assign. Call after GpuCuller::prepare,
+  // which set the cull params.
+  void prepare(FrameData &frameData, std::span<const DrawBatch> batches,
+               std::span<const uint32_t> objectIds);
+
+  // Early phase, or the only one without occlusion culling. Dispatch plus
+  // the barrier that hands the records to the draws.
+  void record(VkCommandBuffer cmd, const FrameData &frameData);
+  // Late phase, after GpuCuller::recordLate rebuilt the pyramid
+  void recordLate(VkCommandBuffer cmd, const FrameData &frameData);
+
+  // Inside a pass: draws the records of the early or late dispatch with
+  // the pass's state bound. Returns the indirect calls issued.
+  uint32_t draw(VkCommandBuffer cmd, const FrameData &frameData,
+                bool late) const;
+
+  // Meshlets drawn the last time the current slot ran
+  uint32_t getLastVisibleCount() const noexcept { return lastVisible; }
+
+  // Meshes with fewer meshlets stay on the per-instance path, the cone and
+  // sphere tests gain little over the object's own
+  static constexpr uint32_t MinMeshlets = 8;
+
+private:
+  enum class Phase : uint32_t { Frustum, Early, Late };
+
+  struct Readback {
+    const uint32_t *counts = nullptr;
+    const uint32_t *lateCounts = nullptr;
+  };
+
+  void dispatch(VkCommandBuffer cmd, const FrameData &frameData, Phase phase,
+                const RingAllocation &draws, const RingAllocation &counts);
+
+  ComputePipeline pipeline;
+  const DepthPyramid &pyramid;
+  uint32_t maxDraws;
+  uint32_t maxVisibility;
+  // One uint per meshlet of an item, nonzero if it passed the last late
+  // phase. Items get their slots in draw list order.
+  Buffer visibility;
+  bool visibilityCleared = false;
+  UniformRing taskRing;
+  // Early records, late records, then both passes' counts
+  UniformRing drawRing;
+  std::vector<Readback> readbacks;
+  // First visibility slot of each item, NoSlot when it has none
+  std::vector<uint32_t> slots;
+  uint32_t currentFrame = 0;
+  uint32_t lastVisible = 0;
+
+  static constexpr uint32_t NoSlot = 0xffffffffu;
+};
@@ -0,0 +1,85 @@
+#include "rhi/vulkan/offscreenTarget.h"
+#include "helper.h"
+
+OffscreenTarget::OffscreenTarget(Device &device, VkExtent2D extent,
+                                 uint32_t imageCount)
+    : device(device), extent(extent) {
+  slots.resize(imageCount);
+
+  for (auto &slot : slots) {
+    createImage(colorFormat,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT, slot.colorImage, slot.colorMemory,
+                slot.colorView);
+    createImage(depthFormat,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_IMAGE_ASPECT_DEPTH_BIT, slot.depthImage, slot.depthMemory,
+                slot.depthView);
+  }
+}
+
+void OffscreenTarget::createImage(VkFormat format, VkImageUsageFlags usage,
+                                  VkImageAspectFlags aspect, VkImage &image,
+                                  Allocation &memory, VkImageView &view) {
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = extent.width;
+  imageInfo.extent.height = extent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = format;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = usage;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VK_CHECK(vkCreateImage(device.getLogical(), &imageInfo, nullptr, &image));
+
+  memory = device.getAllocator().allocateForImage(
+      image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = format;
+  viewInfo.subresourceRange.aspectMask = aspect;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  VK_CHECK(vkCreateImageView(device.getLogical(), &viewInfo, nullptr, &view));
+}
+
+RenderTarget OffscreenTarget::getRenderTarget(uint32_t index) const noexcept {
+  const Slot &slot = slots[index];
+
+  RenderTarget target{};
+  target.colorImage = slot.colorImage;
+  target.colorView = slot.colorView;
+  target.depthImage = slot.depthImage;
+  target.depthView = slot.depthView;
+  target.extent = extent;
+  target.colorFormat = colorFormat;
+  target.depthFormat = depthFormat;
+  // Leave the image ready to be copied out for captures
+  target.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  return target;
+}
+
+OffscreenTarget::~OffscreenTarget() {
+  for (auto &slot : slots) {
+    vkDestroyImageView(device.getLogical(), slot.colorView, nullptr);
+    vkDestroyImage(device.getLogical(), slot.colorImage, nullptr);
+    device.getAllocator().free(slot.colorMemory);
+    vkDestroyImageView(device.getLogical(), slot.depthView, nullptr);
+    vkDestroyImage(device.getLogical(), slot.depthImage, nullptr);
+    device.getAllocator().free(slot.depthMemory);
+  }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "rhi/vulkan/device.h"
+#include "rhi/vulkan/renderTarget.h"
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Ring of color + depth images used instead of a swapchain when running
+// headless. One slot per frame in flight, indexed by the current frame.
+class OffscreenTarget {
+public:
+  OffscreenTarget(Device &device, VkExtent2D extent, uint32_t imageCount);
+  ~OffscreenTarget();
+
+  OffscreenTarget(const OffscreenTarget &) = delete;
+  OffscreenTarget &operator=(const OffscreenTarget &) = delete;
+
+  RenderTarget getRenderTarget(uint32_t index) const noexcept;
+
+  VkFormat getColorFormat() const noexcept { return colorFormat; }
+  VkFormat getDepthFormat() const noexcept { return depthFormat; }
+  VkExtent2D getExtent() const noexcept { return extent; }
+  uint32_t getImageCount() const noexcept {
+    return static_cast<uint32_t>(slots.size());
+  }
+
+private:
+  struct Slot {
+    VkImage colorImage = VK_NULL_HANDLE;
+    Allocation colorMemory;
+    VkImageView colorView = VK_NULL_HANDLE;
+    VkImage depthImage = VK_NULL_HANDLE;
+    Allocation depthMemory;
+    VkImageView depthView = VK_NULL_HANDLE;
+  };
+
+  void createImage(VkFormat format, VkImageUsageFlags usage,
+                   VkImageAspectFlags aspect, VkImage &image,
+                   Allocation &memory, VkImageView &view);
+
+  Device &device;
+  VkExtent2D extent;
+  VkFormat colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
+  std::vector<Slot> slots;
+};
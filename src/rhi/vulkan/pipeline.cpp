@@ -1,8 +1,39 @@
 #include "rhi/vulkan/pipeline.h"
 #include "helper.h"
 #include <fstream>
+#include <stdexcept>
+
+namespace {
+VkFormat toVkFormat(VertexFormat format) {
+  switch (format) {
+  case VertexFormat::Float2:
+    return VK_FORMAT_R32G32_SFLOAT;
+  case VertexFormat::Float3:
+    return VK_FORMAT_R32G32B32_SFLOAT;
+  case VertexFormat::Float4:
+    return VK_FORMAT_R32G32B32A32_SFLOAT;
+  case VertexFormat::Half2:
+    return VK_FORMAT_R16G16_SFLOAT;
+  case VertexFormat::Half4:
+    return VK_FORMAT_R16G16B16A16_SFLOAT;
+  case VertexFormat::Unorm16x4:
+    return VK_FORMAT_R16G16B16A16_UNORM;
+  case VertexFormat::Snorm16x2:
+    return VK_FORMAT_R16G16_SNORM;
+  case VertexFormat::Snorm16x4:
+    return VK_FORMAT_R16G16B16A16_SNORM;
+  case VertexFormat::Unorm8x4:
+    return VK_FORMAT_R8G8B8A8_UNORM;
+  case VertexFormat::Snorm8x4:
+    return VK_FORMAT_R8G8B8A8_SNORM;
+  case VertexFormat::None:
+    break;
+  }
+  return VK_FORMAT_UNDEFINED;
+}
+} // namespace
 
-static std::vector<char> readFile(const std::string &filename) {
+std::vector<char> readFile(const std::string &filename) {
   std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
   if (!file.is_open()) {
@@ -41,8 +72,13 @@ VkShaderModule Pipeline::createShaderModule(const std::vector<char> &code) {
   return shaderModule;
 }
 
-Pipeline::Pipeline(VkDevice device, VkFormat swapchainImageFormat)
-    : device(device) {
+Pipeline::Pipeline(VkDevice device, VkFormat swapchainImageFormat,
+                   const VertexLayout &layout)
+    : device(device), vertexLayout(layout) {
+  if (!layout.has(VertexAttribute::Position) ||
+      !layout.has(VertexAttribute::Color))
+    throw std::runtime_error("vertex layout lacks position or color");
+
   auto vertShaderCode = readFile("shaders/vert.spv");
   auto fragShaderCode = readFile("shaders/frag.spv");
 
@@ -66,8 +102,24 @@ Pipeline::Pipeline(VkDevice device, VkFormat swapchainImageFormat)
   VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo,
                                                     fragShaderStageInfo};
 
-  auto bindingDescription = Vertex::getBindingDescription();
-  auto attributeDescriptions = Vertex::getAttributeDescriptions();
+  VkVertexInputBindingDescription bindingDescription{};
+  bindingDescription.binding = 0;
+  bindingDescription.stride = vertexLayout.getStride();
+  bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+  // Shader locations are the attribute indices
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+  for (uint32_t a = 0; a < VertexAttributeCount; a++) {
+    auto attribute = static_cast<VertexAttribute>(a);
+    if (!vertexLayout.has(attribute))
+      continue;
+    VkVertexInputAttributeDescription description{};
+    description.binding = 0;
+    description.location = a;
+    description.format = toVkFormat(vertexLayout.getFormat(attribute));
+    description.offset = vertexLayout.getOffset(attribute);
+    attributeDescriptions.push_back(description);
+  }
 
   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
   vertexInputInfo.sType =
@@ -132,17 +184,19 @@ Pipeline::Pipeline(VkDevice device, VkFormat swapchainImageFormat)
 
   VkDescriptorSetLayoutBinding uboLayoutBindings[2]{};
 
-  // Binding 0: probably your existing uniform (camera / other)
+  // Binding 0: camera, lives in the per-frame uniform ring (dynamic offset)
   uboLayoutBindings[0].binding = 0;
   uboLayoutBindings[0].descriptorCount = 1;
-  uboLayoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  uboLayoutBindings[0].descriptorType =
+      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
   uboLayoutBindings[0].pImmutableSamplers = nullptr;
   uboLayoutBindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
-  // Binding 1: model matrix uniform (the one your shader is complaining about)
+  // Binding 1: per-frame object table, indexed by gl_InstanceIndex
   uboLayoutBindings[1].binding = 1;
   uboLayoutBindings[1].descriptorCount = 1;
-  uboLayoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  uboLayoutBindings[1].descriptorType =
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
   uboLayoutBindings[1].pImmutableSamplers = nullptr;
   uboLayoutBindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
@@ -1,43 +1,26 @@
 #pragma once
+#include "renderer/vertexLayout.h"
 #include <glm/glm.hpp>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
+// Whole file as bytes, throws when it cannot be opened
+std::vector<char> readFile(const std::string &filename);
+
+// Unpacked vertex of meshes built at runtime; the renderer encodes it into
+// its VertexLayout on upload
 struct Vertex {
   glm::vec3 pos;
   glm::vec3 color;
-
-  static VkVertexInputBindingDescription getBindingDescription() {
-    VkVertexInputBindingDescription bindingDescription{};
-
-    bindingDescription.binding = 0;
-    bindingDescription.stride = sizeof(Vertex);
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    return bindingDescription;
-  }
-
-  static std::array<VkVertexInputAttributeDescription, 2>
-  getAttributeDescriptions() {
-    std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
-
-    attributeDescriptions[0].binding = 0;
-    attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-    attributeDescriptions[1].binding = 0;
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-    return attributeDescriptions;
-  }
 };
 
 class Pipeline {
 public:
-  Pipeline(VkDevice device, VkFormat swapchainImageFormat);
+  // The vertex input state follows layout, which has to carry at least
+  // the position and color the forward shader reads
+  Pipeline(VkDevice device, VkFormat swapchainImageFormat,
+           const VertexLayout &layout = VertexLayout::compact());
   ~Pipeline();
 
   VkShaderModule createShaderModule(const std::vector<char> &code);
@@ -45,6 +28,7 @@ public:
   VkPipeline getGraphicsPipeline() const noexcept;
   VkPipelineLayout getPipelineLayout() const noexcept;
   VkDescriptorSetLayout getDescriptorSetLayout() const noexcept;
+  const VertexLayout &getVertexLayout() const noexcept { return vertexLayout; }
 
   const std::vector<Vertex> vertices = {
       {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
@@ -56,6 +40,7 @@ public:
 
 private:
   VkDevice device;
+  VertexLayout vertexLayout;
   VkPipelineLayout pipelineLayout;
   VkPipeline graphicsPipeline;
   VkDescriptorSetLayout descriptorSetLayout;
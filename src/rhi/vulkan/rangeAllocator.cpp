@@ -0,0 +1,52 @@
+#include "rhi/vulkan/rangeAllocator.h"
+#include <iterator>
+
+RangeAllocator::RangeAllocator(uint32_t capacity) : capacity(capacity) {
+  if (capacity > 0)
+    freeRanges.emplace(0, capacity);
+}
+
+std::optional<uint32_t> RangeAllocator::allocate(uint32_t count) {
+  if (count == 0)
+    return std::nullopt;
+
+  for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+    if (it->second < count)
+      continue;
+
+    uint32_t offset = it->first;
+    uint32_t remaining = it->second - count;
+    freeRanges.erase(it);
+    if (remaining > 0)
+      freeRanges.emplace(offset + count, remaining);
+    used += count;
+    return offset;
+  }
+  return std::nullopt;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t count) {
+  if (count == 0)
+    return;
+  used -= count;
+
+  auto next = freeRanges.lower_bound(offset);
+
+  // Merge with the range that ends where this one starts
+  if (next != freeRanges.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      count += prev->second;
+      freeRanges.erase(prev);
+    }
+  }
+
+  // Merge with the range that starts where this one ends
+  if (next != freeRanges.end() && offset + count == next->first) {
+    count += next->second;
+    freeRanges.erase(next);
+  }
+
+  freeRanges.emplace(offset, count);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <optional>
+
+// First-fit allocator over an abstract [0, capacity) range of elements.
+// Freed ranges are coalesced with their neighbours.
+class RangeAllocator {
+public:
+  explicit RangeAllocator(uint32_t capacity);
+
+  std::optional<uint32_t> allocate(uint32_t count);
+  void free(uint32_t offset, uint32_t count);
+
+  uint32_t getCapacity() const noexcept { return capacity; }
+  uint32_t getUsed() const noexcept { return used; }
+
+private:
+  uint32_t capacity;
+  uint32_t used = 0;
+  // offset -> count of every free range
+  std::map<uint32_t, uint32_t> freeRanges;
+};
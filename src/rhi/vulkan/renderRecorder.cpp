@@ -1,16 +1,73 @@
 #include "rhi/vulkan/renderRecorder.h"
 #include "helper.h"
+#include "rhi/vulkan/commandWorkers.h"
+#include "rhi/vulkan/gpuCuller.h"
+#include "rhi/vulkan/meshletCuller.h"
+#include "renderer/uniforms.h"
+#include <algorithm>
+
+namespace {
+// Below this many batches per worker the serial path is cheaper
+constexpr size_t MinBatchesPerSlice = 64;
+
+// Index buffer bound to a command buffer, none yet after bindState
+constexpr VkIndexType NoIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+void drawBatch(VkCommandBuffer cmd, const GeometryPool &pool,
+               const DrawBatch &batch, VkIndexType &boundType) {
+  // gl_InstanceIndex walks the batch's slice of the object table
+  const GeometryRange &geometry = batch.mesh->geometry;
+  const MeshLod &lod = batch.mesh->lods[batch.lod];
+  if (geometry.indexType != boundType) {
+    pool.bindIndices(cmd, geometry.indexType);
+    boundType = geometry.indexType;
+  }
+  vkCmdDrawIndexed(cmd, lod.indexCount, batch.instanceCount,
+                   geometry.firstIndex + lod.firstIndex, geometry.vertexOffset,
+                   batch.firstInstance);
+}
+} // namespace
 
 RenderRecorder::RenderRecorder(Pipeline &pipeline) : pipeline(pipeline) {}
 
-void RenderRecorder::record(VkCommandBuffer cmd, Swapchain &swapchain,
-                            uint32_t imageIndex, uint32_t frame,
-                            std::span<RenderItem *> items, Camera &camera) {
+uint32_t RenderRecorder::beginZone(VkCommandBuffer cmd, const char *name,
+                                   uint32_t first, uint32_t last) {
+  return profiler ? profiler->beginZone(cmd, name, first, last)
+                  : GpuProfiler::InvalidZone;
+}
+
+void RenderRecorder::endZone(VkCommandBuffer cmd, uint32_t zone) {
+  if (profiler)
+    profiler->endZone(cmd, zone);
+}
+
+void RenderRecorder::record(VkCommandBuffer cmd, const RenderTarget &target,
+                            const FrameData &frameData,
+                            std::span<const DrawBatch> batches) {
+  stats = {};
+
   VkCommandBufferBeginInfo begin{};
   begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   VK_CHECK(vkBeginCommandBuffer(cmd, &begin));
 
+  // Geometry streamed in since an earlier frame drew it
+  if (frameData.uploadWait)
+    frameData.uploads->acquire(cmd, frameData.uploadWait);
+
+  if (profiler)
+    profiler->beginFrame(cmd, frameData.frame);
+  uint32_t frameZone = beginZone(cmd, "frame");
+
+  if (frameData.culler) {
+    uint32_t cullZone = beginZone(cmd, "cull");
+    frameData.culler->record(cmd, frameData);
+    if (frameData.meshletCuller)
+      frameData.meshletCuller->record(cmd, frameData);
+    endZone(cmd, cullZone);
+  }
+
   // --- Image barriers for color and depth ---
+  uint32_t barrierZone = beginZone(cmd, "barriers");
   VkImageMemoryBarrier2 barriers[2]{};
 
   // Color
@@ -20,18 +77,21 @@ void RenderRecorder::record(VkCommandBuffer cmd, Swapchain &swapchain,
   barriers[0].dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
   barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
   barriers[0].newLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
-  barriers[0].image = swapchain.getSwapchainImages()[imageIndex];
+  barriers[0].image = target.colorImage;
   barriers[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   barriers[0].subresourceRange.levelCount = 1;
   barriers[0].subresourceRange.layerCount = 1;
 
-  // Depth
+  // Depth, the previous frame may still be reducing it into the pyramid
   barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+  barriers[1].srcStageMask = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT |
+                             VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+  barriers[1].srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
   barriers[1].dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT;
   barriers[1].dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
   barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
   barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-  barriers[1].image = swapchain.getDepthImage();
+  barriers[1].image = target.depthImage;
   barriers[1].subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
   barriers[1].subresourceRange.levelCount = 1;
   barriers[1].subresourceRange.layerCount = 1;
@@ -42,87 +102,258 @@ void RenderRecorder::record(VkCommandBuffer cmd, Swapchain &swapchain,
   dep.pImageMemoryBarriers = barriers;
 
   vkCmdPipelineBarrier2(cmd, &dep);
+  endZone(cmd, barrierZone);
+
+  for (const DrawBatch &batch : batches) {
+    stats.itemsSubmitted += batch.instanceCount;
+    stats.trianglesSubmitted += uint64_t{batch.instanceCount} *
+                                batch.mesh->lods[batch.lod].indexCount / 3;
+    if (batch.meshlets)
+      stats.meshletsSubmitted +=
+          batch.instanceCount * batch.mesh->geometry.meshletCount;
+  }
+
+  uint32_t mainPassZone = beginZone(cmd, "main pass");
+  recordPass(cmd, target, frameData, batches, frameData.drawCommands, true);
+  endZone(cmd, mainPassZone);
+
+  if (frameData.lateDrawCommands.buffer != VK_NULL_HANDLE) {
+    // --- Occlusion: pyramid from the early depth, then the late draws ---
+    uint32_t occlusionZone = beginZone(cmd, "occlusion cull");
+    depthBarrier(cmd, target, true);
+    frameData.culler->recordLate(cmd, frameData, target);
+    if (frameData.meshletCuller)
+      frameData.meshletCuller->recordLate(cmd, frameData);
+    depthBarrier(cmd, target, false);
+    endZone(cmd, occlusionZone);
 
+    uint32_t latePassZone = beginZone(cmd, "late pass");
+    recordPass(cmd, target, frameData, batches, frameData.lateDrawCommands,
+               false);
+    endZone(cmd, latePassZone);
+  }
+  stats.descriptorWrites = frameData.descriptors->getFrameWrites();
+
+  // --- Transition color image to present (or transfer src offscreen) ---
+  uint32_t presentZone = beginZone(cmd, "present transition");
+  VkImageMemoryBarrier2 present{};
+  present.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+  present.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+  present.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+  present.oldLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
+  present.newLayout = target.finalLayout;
+  present.image = target.colorImage;
+  present.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  present.subresourceRange.levelCount = 1;
+  present.subresourceRange.layerCount = 1;
+
+  VkDependencyInfo dep2{};
+  dep2.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  dep2.imageMemoryBarrierCount = 1;
+  dep2.pImageMemoryBarriers = &present;
+
+  vkCmdPipelineBarrier2(cmd, &dep2);
+  endZone(cmd, presentZone);
+  endZone(cmd, frameZone);
+
+  VK_CHECK(vkEndCommandBuffer(cmd));
+}
+
+void RenderRecorder::depthBarrier(VkCommandBuffer cmd,
+                                  const RenderTarget &target, bool toRead) {
+  VkImageMemoryBarrier2 barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+  if (toRead) {
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+  } else {
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                           VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+  }
+  barrier.image = target.depthImage;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.layerCount = 1;
+
+  // The late pass loads and keeps writing the early pass's color
+  VkMemoryBarrier2 color{};
+  color.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+  color.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+  color.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+  color.dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+  color.dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+                        VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+
+  VkDependencyInfo dep{};
+  dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  dep.memoryBarrierCount = toRead ? 0 : 1;
+  dep.pMemoryBarriers = &color;
+  dep.imageMemoryBarrierCount = 1;
+  dep.pImageMemoryBarriers = &barrier;
+  vkCmdPipelineBarrier2(cmd, &dep);
+}
+
+void RenderRecorder::recordPass(VkCommandBuffer cmd,
+                                const RenderTarget &target,
+                                const FrameData &frameData,
+                                std::span<const DrawBatch> batches,
+                                const RingAllocation &draws, bool clear) {
   // --- Dynamic rendering setup ---
+  VkAttachmentLoadOp loadOp =
+      clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+
   VkRenderingAttachmentInfo colorAtt{};
   colorAtt.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-  colorAtt.imageView = swapchain.getSwapchainImageViews()[imageIndex];
+  colorAtt.imageView = target.colorView;
   colorAtt.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
-  colorAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAtt.loadOp = loadOp;
   colorAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   colorAtt.clearValue.color = {{0.01f, 0.01f, 0.01f, 1.f}};
 
   VkRenderingAttachmentInfo depthAtt{};
   depthAtt.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-  depthAtt.imageView = swapchain.getDepthImageView();
+  depthAtt.imageView = target.depthView;
   depthAtt.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-  depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAtt.loadOp = loadOp;
   depthAtt.clearValue.depthStencil = {1.f, 0};
 
   VkRenderingInfo ri{};
   ri.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-  ri.renderArea.extent = swapchain.getSwapchainExtent();
+  ri.renderArea.extent = target.extent;
   ri.layerCount = 1;
   ri.colorAttachmentCount = 1;
   ri.pColorAttachments = &colorAtt;
   ri.pDepthAttachment = &depthAtt;
 
-  vkCmdBeginRendering(cmd, &ri);
+  // Camera and object table are selected with dynamic offsets, so one
+  // cached set serves every frame and is bound once. Looked up here, the
+  // cache is not safe to use from the recording workers.
+  const DescriptorBinding bindings[] = {
+      {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, frameData.camera.buffer, 0,
+       sizeof(CameraUBO)},
+      {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+       frameData.instances.buffer, 0, frameData.instanceRange}};
+  VkDescriptorSet set = frameData.descriptors->get(
+      pipeline.getDescriptorSetLayout(), bindings);
+  uint32_t dynamicOffsets[] = {
+      static_cast<uint32_t>(frameData.camera.offset),
+      static_cast<uint32_t>(frameData.instances.offset)};
 
-  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    pipeline.getGraphicsPipeline());
+  // Secondary command buffers start without state, each slice binds it
+  auto bindState = [&](VkCommandBuffer buffer) {
+    vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      pipeline.getGraphicsPipeline());
 
-  VkViewport vp{};
-  vp.width = (float)swapchain.getSwapchainExtent().width;
-  vp.height = (float)swapchain.getSwapchainExtent().height;
-  vp.maxDepth = 1.f;
-  vkCmdSetViewport(cmd, 0, 1, &vp);
+    VkViewport vp{};
+    vp.width = (float)target.extent.width;
+    vp.height = (float)target.extent.height;
+    vp.maxDepth = 1.f;
+    vkCmdSetViewport(buffer, 0, 1, &vp);
 
-  VkRect2D sc{};
-  sc.extent = swapchain.getSwapchainExtent();
-  vkCmdSetScissor(cmd, 0, 1, &sc);
+    VkRect2D sc{};
+    sc.extent = target.extent;
+    vkCmdSetScissor(buffer, 0, 1, &sc);
 
-  // --- Draw items ---
-  for (auto *item : items) {
-    // Update per-frame UBOs
-    item->update(frame, camera.getBuffer(), sizeof(CameraUBO));
+    vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pipeline.getPipelineLayout(), 0, 1, &set, 2,
+                            dynamicOffsets);
 
-    auto &mesh = *item->mesh;
-    VkDeviceSize offset = 0;
-    VkBuffer vb = mesh.vertexBuffer.get();
+    frameData.geometry->bind(buffer);
+  };
 
-    vkCmdBindVertexBuffers(cmd, 0, 1, &vb, &offset);
-    vkCmdBindIndexBuffer(cmd, mesh.indexBuffer.get(), 0, VK_INDEX_TYPE_UINT32);
+  // Direct draws are split across the workers once there are enough
+  uint32_t slices = 0;
+  if (workers && draws.buffer == VK_NULL_HANDLE) {
+    slices = static_cast<uint32_t>(std::min<size_t>(
+        workers->getWorkerCount(), batches.size() / MinBatchesPerSlice));
+  }
+  if (slices > 1) {
+    // --- Direct, recorded in parallel and replayed in slice order ---
+    ri.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+    vkCmdBeginRendering(cmd, &ri);
 
-    // Single descriptor set with both camera and model bindings
-    VkDescriptorSet sets[] = {item->descriptorSet->get(frame)};
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            pipeline.getPipelineLayout(), 0, 1, sets, 0,
-                            nullptr);
+    auto secondaries = workers->record(
+        target, slices, [&](uint32_t slice, VkCommandBuffer sub) {
+          size_t first = batches.size() * slice / slices;
+          size_t last = batches.size() * (slice + 1) / slices;
+          bindState(sub);
+          VkIndexType boundType = NoIndexType;
+          for (const DrawBatch &batch : batches.subspan(first, last - first))
+            drawBatch(sub, *frameData.geometry, batch, boundType);
+        });
+    vkCmdExecuteCommands(cmd, static_cast<uint32_t>(secondaries.size()),
+                         secondaries.data());
+    stats.drawCalls += static_cast<uint32_t>(batches.size());
 
-    vkCmdDrawIndexed(cmd, mesh.indexCount, 1, 0, 0, 0);
+    vkCmdEndRendering(cmd);
+    return;
   }
 
-  vkCmdEndRendering(cmd);
+  vkCmdBeginRendering(cmd, &ri);
+  bindState(cmd);
 
-  // --- Transition color image to present ---
-  VkImageMemoryBarrier2 present{};
-  present.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
-  present.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
-  present.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
-  present.oldLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
-  present.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-  present.image = swapchain.getSwapchainImages()[imageIndex];
-  present.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  present.subresourceRange.levelCount = 1;
-  present.subresourceRange.layerCount = 1;
+  if (draws.buffer != VK_NULL_HANDLE) {
+    // --- Indirect: one call per run of batches sharing an index type ---
+    // Records match batches one to one. The sort key groups opaque batches
+    // by index type, so there are usually at most two runs.
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    uint32_t first = 0;
+    while (first < batches.size()) {
+      VkIndexType type = batches[first].mesh->geometry.indexType;
+      uint32_t last = first + 1;
+      while (last < batches.size() &&
+             batches[last].mesh->geometry.indexType == type)
+        last++;
 
-  VkDependencyInfo dep2{};
-  dep2.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-  dep2.imageMemoryBarrierCount = 1;
-  dep2.pImageMemoryBarriers = &present;
+      frameData.geometry->bindIndices(cmd, type);
+      if (frameData.useDrawCount && first == 0 && last == batches.size()) {
+        vkCmdDrawIndexedIndirectCount(cmd, draws.buffer, draws.offset,
+                                      frameData.drawCount.buffer,
+                                      frameData.drawCount.offset,
+                                      frameData.maxDraws, stride);
+      } else {
+        // The count buffer only holds the total
+        vkCmdDrawIndexedIndirect(cmd, draws.buffer,
+                                 draws.offset + VkDeviceSize{first} * stride,
+                                 last - first, stride);
+      }
+      stats.indirectCalls++;
+      first = last;
+    }
+    stats.drawCalls += static_cast<uint32_t>(batches.size());
 
-  vkCmdPipelineBarrier2(cmd, &dep2);
+    // Meshlets that survived cluster culling, after the batches
+    if (frameData.meshletCuller) {
+      bool late = &draws == &frameData.lateDrawCommands;
+      stats.indirectCalls += frameData.meshletCuller->draw(cmd, frameData,
+                                                           late);
+    }
+  } else {
+    // --- Direct: one call per batch ---
+    VkIndexType boundType = NoIndexType;
+    uint32_t rangeZone = GpuProfiler::InvalidZone;
+    for (uint32_t i = 0; i < batches.size(); i++) {
+      const DrawBatch &batch = batches[i];
+      if (drawRangeSize != 0 && i % drawRangeSize == 0) {
+        endZone(cmd, rangeZone);
+        uint32_t last = std::min<uint32_t>(i + drawRangeSize, batches.size());
+        rangeZone = beginZone(cmd, "draw range", i, last);
+      }
 
-  VK_CHECK(vkEndCommandBuffer(cmd));
+      drawBatch(cmd, *frameData.geometry, batch, boundType);
+      stats.drawCalls++;
+    }
+    endZone(cmd, rangeZone);
+  }
+
+  vkCmdEndRendering(cmd);
 }
@@ -1,18 +1,57 @@
 #pragma once
-#include "renderer/camera.h"
+#include "renderer/drawBatch.h"
+#include "renderer/frameData.h"
 #include "renderer/renderItem.h"
+#include "renderer/renderStats.h"
+#include "rhi/vulkan/gpuProfiler.h"
 #include "rhi/vulkan/pipeline.h"
-#include "rhi/vulkan/swapchain.h"
+#include "rhi/vulkan/renderTarget.h"
 #include <span>
 #include <vulkan/vulkan_core.h>
 
+class CommandWorkers;
+
 class RenderRecorder {
 public:
   RenderRecorder(Pipeline &pipeline);
 
-  void record(VkCommandBuffer cmd, Swapchain &swapchain, uint32_t imageIndex,
-              uint32_t frame, std::span<RenderItem *> items, Camera &camera);
+  void record(VkCommandBuffer cmd, const RenderTarget &target,
+              const FrameData &frameData, std::span<const DrawBatch> batches);
+
+  const RenderStats &getStats() const noexcept { return stats; }
+  const Pipeline &getPipeline() const noexcept { return pipeline; }
+
+  // Optional, zones are only written when a profiler is set
+  void setProfiler(GpuProfiler *gpuProfiler) noexcept {
+    profiler = gpuProfiler;
+  }
+  // Split the main pass draws into GPU zones of this many draws, 0 = off.
+  // Only the serial direct path writes them.
+  void setDrawRangeSize(uint32_t size) noexcept { drawRangeSize = size; }
+  // Optional, direct draws are recorded into secondary command buffers on
+  // these threads when there are enough of them
+  void setCommandWorkers(CommandWorkers *commandWorkers) noexcept {
+    workers = commandWorkers;
+  }
 
 private:
+  // One dynamic rendering pass drawing draws (indirect) or the batches
+  // (direct). clear starts the attachments fresh, otherwise they are loaded.
+  void recordPass(VkCommandBuffer cmd, const RenderTarget &target,
+                  const FrameData &frameData,
+                  std::span<const DrawBatch> batches,
+                  const RingAllocation &draws, bool clear);
+  // Depth attachment to/from DEPTH_READ_ONLY_OPTIMAL around the pyramid
+  // build; the way back also orders the two passes' color writes
+  void depthBarrier(VkCommandBuffer cmd, const RenderTarget &target,
+                    bool toRead);
+  uint32_t beginZone(VkCommandBuffer cmd, const char *name, uint32_t first = 0,
+                     uint32_t last = 0);
+  void endZone(VkCommandBuffer cmd, uint32_t zone);
+
   Pipeline &pipeline;
+  RenderStats stats;
+  GpuProfiler *profiler = nullptr;
+  CommandWorkers *workers = nullptr;
+  uint32_t drawRangeSize = 0;
 };
@@ -0,0 +1,17 @@
+#pragma once
+#include <vulkan/vulkan_core.h>
+
+// The images a single frame renders into. Filled in by either the swapchain
+// or the offscreen target so the recorder does not care which one it is.
+struct RenderTarget {
+  VkImage colorImage = VK_NULL_HANDLE;
+  VkImageView colorView = VK_NULL_HANDLE;
+  VkImage depthImage = VK_NULL_HANDLE;
+  VkImageView depthView = VK_NULL_HANDLE;
+  VkExtent2D extent{};
+  // Needed by secondary command buffers that inherit the rendering pass
+  VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  // Layout the color image is left in once recording is done
+  VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+};
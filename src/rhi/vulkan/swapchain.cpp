@@ -186,26 +186,17 @@ void Swapchain::createDepthResources() {
   imageInfo.format = depthFormat;
   imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
   imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+  // Sampled so the occlusion pass can reduce it into the depth pyramid
+  imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_SAMPLED_BIT;
   imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
   imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
   VK_CHECK(
       vkCreateImage(device.getLogical(), &imageInfo, nullptr, &depthImage));
 
-  VkMemoryRequirements memReq;
-  vkGetImageMemoryRequirements(device.getLogical(), depthImage, &memReq);
-
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memReq.size;
-  allocInfo.memoryTypeIndex = device.findMemoryType(
-      memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-  VK_CHECK(
-      vkAllocateMemory(device.getLogical(), &allocInfo, nullptr, &depthMemory));
-
-  vkBindImageMemory(device.getLogical(), depthImage, depthMemory, 0);
+  depthMemory = device.getAllocator().allocateForImage(
+      depthImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
   VkImageViewCreateInfo viewInfo{};
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -232,7 +223,7 @@ void Swapchain::cleanupSwapChain() {
   vkDestroySwapchainKHR(device.getLogical(), swapchain, nullptr);
   vkDestroyImageView(device.getLogical(), depthImageView, nullptr);
   vkDestroyImage(device.getLogical(), depthImage, nullptr);
-  vkFreeMemory(device.getLogical(), depthMemory, nullptr);
+  device.getAllocator().free(depthMemory);
 }
 
 Swapchain::Swapchain(Device &device, VkSurfaceKHR surface, Window &window)
@@ -261,3 +252,16 @@ VkImageView Swapchain::getDepthImageView() const noexcept {
 
 VkImage Swapchain::getDepthImage() const noexcept { return depthImage; }
 VkFormat Swapchain::getDepthFormat() const noexcept { return depthFormat; }
+
+RenderTarget Swapchain::getRenderTarget(uint32_t imageIndex) const noexcept {
+  RenderTarget target{};
+  target.colorImage = swapchainImages[imageIndex];
+  target.colorView = swapchainImageViews[imageIndex];
+  target.depthImage = depthImage;
+  target.depthView = depthImageView;
+  target.extent = swapchainExtent;
+  target.colorFormat = swapchainImageFormat;
+  target.depthFormat = depthFormat;
+  target.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  return target;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "core/window.h"
 #include "rhi/vulkan/device.h"
+#include "rhi/vulkan/renderTarget.h"
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
@@ -34,6 +35,7 @@ public:
   VkImageView getDepthImageView() const noexcept;
   VkImage getDepthImage() const noexcept;
   VkFormat getDepthFormat() const noexcept;
+  RenderTarget getRenderTarget(uint32_t imageIndex) const noexcept;
 
   void resizeSwapchainImageViewsToSwapchainImages() {
     swapchainImageViews.resize(swapchainImages.size());
@@ -49,7 +51,7 @@ private:
 
   // Depth Shit
   VkImage depthImage = VK_NULL_HANDLE;
-  VkDeviceMemory depthMemory = VK_NULL_HANDLE;
+  Allocation depthMemory;
   VkImageView depthImageView = VK_NULL_HANDLE;
   VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
 };
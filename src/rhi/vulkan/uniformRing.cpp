@@ -0,0 +1,40 @@
+#include "rhi/vulkan/uniformRing.h"
+#include <algorithm>
+#include <stdexcept>
+
+UniformRing::UniformRing(Device &device, uint32_t framesInFlight,
+                         VkDeviceSize bytesPerFrame,
+                         VkBufferUsageFlags extraUsage)
+    : buffer(device, VK_NULL_HANDLE), bytesPerFrame(bytesPerFrame) {
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(device.getPhysical(), &props);
+  alignment = std::max(props.limits.minUniformBufferOffsetAlignment,
+                       props.limits.minStorageBufferOffsetAlignment);
+
+  // Keep every partition starting on an aligned offset
+  this->bytesPerFrame = (bytesPerFrame + alignment - 1) / alignment * alignment;
+
+  buffer.create(this->bytesPerFrame * framesInFlight,
+                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | extraUsage,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+void UniformRing::beginFrame(uint32_t frame) {
+  frameBase = bytesPerFrame * frame;
+  head = frameBase;
+}
+
+RingAllocation UniformRing::allocate(VkDeviceSize size) {
+  VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+  if (offset + size > frameBase + bytesPerFrame)
+    throw std::runtime_error("UniformRing frame partition exhausted");
+  head = offset + size;
+
+  RingAllocation a;
+  a.buffer = buffer.get();
+  a.offset = offset;
+  a.ptr = static_cast<char *>(buffer.getMapped()) + offset;
+  return a;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "rhi/vulkan/buffer.h"
+#include "rhi/vulkan/device.h"
+#include <cstring>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+struct RingAllocation {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  void *ptr = nullptr;
+};
+
+// Persistently mapped linear allocator for per-frame uniform and storage
+// data. The buffer is split into one partition per frame in flight; a
+// partition is rewound in beginFrame, which must only be called once that
+// frame's fence has signaled. Offsets are aligned for use as dynamic
+// uniform or storage buffer offsets.
+class UniformRing {
+public:
+  // extraUsage is added to the uniform/storage usage, e.g. for indirect args
+  UniformRing(Device &device, uint32_t framesInFlight,
+              VkDeviceSize bytesPerFrame = 8ull * 1024 * 1024,
+              VkBufferUsageFlags extraUsage = 0);
+
+  void beginFrame(uint32_t frame);
+  RingAllocation allocate(VkDeviceSize size);
+
+  template <typename T> RingAllocation push(const T &value) {
+    RingAllocation a = allocate(sizeof(T));
+    std::memcpy(a.ptr, &value, sizeof(T));
+    return a;
+  }
+
+  VkBuffer getBuffer() const noexcept { return buffer.get(); }
+  VkDeviceSize getAlignment() const noexcept { return alignment; }
+  VkDeviceSize getFrameCapacity() const noexcept { return bytesPerFrame; }
+  // Bytes handed out from the current frame's partition so far
+  VkDeviceSize getFrameUsage() const noexcept { return head - frameBase; }
+
+private:
+  Buffer buffer;
+  VkDeviceSize bytesPerFrame;
+  VkDeviceSize alignment = 1;
+  VkDeviceSize frameBase = 0;
+  VkDeviceSize head = 0;
+};
@@ -0,0 +1,300 @@
+#include "rhi/vulkan/uploadQueue.h"
+#include "helper.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// What the acquire makes the uploaded data visible to: vertex and index
+// fetch, and the meshlet cull reading the meshlet buffer
+constexpr VkPipelineStageFlags2 ConsumerStages =
+    VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT |
+    VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT |
+    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+constexpr VkAccessFlags2 ConsumerAccess =
+    VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT |
+    VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+// Keeps staged data aligned for any element type
+constexpr VkDeviceSize StagingAlignment = 16;
+} // namespace
+
+UploadQueue::UploadQueue(Device &device, VkDeviceSize stagingSize)
+    : device(device), transferFamily(device.getTransferFamily()),
+      graphicsFamily(device.getQueues().graphicsFamily.value()),
+      staging(device, VK_NULL_HANDLE),
+      stagingSize((stagingSize + StagingAlignment - 1) / StagingAlignment *
+                  StagingAlignment) {
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                   VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = transferFamily;
+  VK_CHECK(
+      vkCreateCommandPool(device.getLogical(), &poolInfo, nullptr, &pool));
+
+  VkSemaphoreTypeCreateInfo typeInfo{};
+  typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  typeInfo.initialValue = 0;
+
+  VkSemaphoreCreateInfo semaphoreInfo{};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreInfo.pNext = &typeInfo;
+  VK_CHECK(vkCreateSemaphore(device.getLogical(), &semaphoreInfo, nullptr,
+                             &timeline));
+
+  staging.create(this->stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+UploadQueue::~UploadQueue() {
+  waitIdle();
+  collect();
+  vkDestroySemaphore(device.getLogical(), timeline, nullptr);
+  // Frees the recycled command buffers with it
+  vkDestroyCommandPool(device.getLogical(), pool, nullptr);
+}
+
+UploadTicket UploadQueue::upload(const Buffer &dst, const void *data,
+                                 VkDeviceSize size, VkDeviceSize dstOffset) {
+  if (size == 0)
+    return UploadTicket{};
+
+  // Larger than the ring: staged and copied in ring-sized pieces
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  for (VkDeviceSize done = 0; done < size;) {
+    VkDeviceSize chunk = std::min(size - done, stagingSize);
+    VkDeviceSize offset = allocateStaging(chunk);
+    std::memcpy(static_cast<uint8_t *>(staging.getMapped()) + offset,
+                bytes + done, static_cast<size_t>(chunk));
+
+    Copy copy;
+    copy.dst = dst.get();
+    copy.region.srcOffset = offset;
+    copy.region.dstOffset = dstOffset + done;
+    copy.region.size = chunk;
+    copies.push_back(copy);
+    done += chunk;
+  }
+  return UploadTicket{nextValue};
+}
+
+VkDeviceSize UploadQueue::allocateStaging(VkDeviceSize size) {
+  size = (size + StagingAlignment - 1) / StagingAlignment * StagingAlignment;
+  for (;;) {
+    // Nothing staged or in flight, start over at the front
+    if (stagingHead == stagingTail)
+      stagingHead = stagingTail = 0;
+
+    // Allocations never wrap, the tail end of the ring is skipped instead
+    VkDeviceSize start = stagingHead;
+    VkDeviceSize offset = start % stagingSize;
+    if (offset + size > stagingSize)
+      start += stagingSize - offset;
+    if (start + size - stagingTail <= stagingSize) {
+      stagingHead = start + size;
+      return start % stagingSize;
+    }
+
+    // Full: the queued copies hold the space when nothing else does
+    if (inFlight.empty())
+      flush();
+    wait(UploadTicket{inFlight.front().value});
+    collect();
+  }
+}
+
+VkCommandBuffer UploadQueue::getCommandBuffer() {
+  if (!freeCommands.empty()) {
+    VkCommandBuffer cmd = freeCommands.back();
+    freeCommands.pop_back();
+    return cmd;
+  }
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.commandPool = pool;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandBufferCount = 1;
+  VkCommandBuffer cmd;
+  VK_CHECK(vkAllocateCommandBuffers(device.getLogical(), &allocInfo, &cmd));
+  return cmd;
+}
+
+void UploadQueue::flush() {
+  if (copies.empty())
+    return;
+
+  Batch batch;
+  batch.value = nextValue;
+  batch.cmd = getCommandBuffer();
+  batch.stagingEnd = stagingHead;
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  VK_CHECK(vkBeginCommandBuffer(batch.cmd, &beginInfo));
+
+  // One vkCmdCopyBuffer per destination with all of its regions
+  std::stable_sort(copies.begin(), copies.end(),
+                   [](const Copy &a, const Copy &b) { return a.dst < b.dst; });
+  std::vector<VkBufferCopy> regions;
+  for (size_t i = 0; i < copies.size();) {
+    VkBuffer dst = copies[i].dst;
+    regions.clear();
+    for (; i < copies.size() && copies[i].dst == dst; i++)
+      regions.push_back(copies[i].region);
+    vkCmdCopyBuffer(batch.cmd, staging.get(), dst,
+                    static_cast<uint32_t>(regions.size()), regions.data());
+  }
+
+  // Hand the ranges over to the graphics family, see acquire(). Back to
+  // back uploads into one buffer are released as a single range.
+  if (ownershipTransfer()) {
+    size_t first = releases.size();
+    for (const Copy &copy : copies) {
+      if (releases.size() > first) {
+        Release &last = releases.back();
+        if (last.buffer == copy.dst &&
+            last.offset + last.size == copy.region.dstOffset) {
+          last.size += copy.region.size;
+          continue;
+        }
+      }
+      releases.push_back({batch.value, copy.dst, copy.region.dstOffset,
+                          copy.region.size});
+    }
+
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    barriers.reserve(releases.size() - first);
+    for (size_t i = first; i < releases.size(); i++) {
+      VkBufferMemoryBarrier2 release{};
+      release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+      release.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+      release.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+      release.srcQueueFamilyIndex = transferFamily;
+      release.dstQueueFamilyIndex = graphicsFamily;
+      release.buffer = releases[i].buffer;
+      release.offset = releases[i].offset;
+      release.size = releases[i].size;
+      barriers.push_back(release);
+    }
+
+    VkDependencyInfo dep{};
+    dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dep.bufferMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+    dep.pBufferMemoryBarriers = barriers.data();
+    vkCmdPipelineBarrier2(batch.cmd, &dep);
+  }
+  copies.clear();
+
+  VK_CHECK(vkEndCommandBuffer(batch.cmd));
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &batch.value;
+
+  VkSubmitInfo submit{};
+  submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit.pNext = &timelineInfo;
+  submit.commandBufferCount = 1;
+  submit.pCommandBuffers = &batch.cmd;
+  submit.signalSemaphoreCount = 1;
+  submit.pSignalSemaphores = &timeline;
+  VK_CHECK(vkQueueSubmit(device.getTransferQueue(), 1, &submit,
+                         VK_NULL_HANDLE));
+
+  nextValue++;
+  inFlight.push_back(batch);
+}
+
+void UploadQueue::acquire(VkCommandBuffer cmd, uint64_t value) {
+  if (value <= acquiredValue)
+    return;
+
+  // The source stage matches the semaphore wait stage so the wait chains
+  // through this barrier into later submissions as well
+  std::vector<VkBufferMemoryBarrier2> barriers;
+  auto acquired = std::partition(
+      releases.begin(), releases.end(),
+      [&](const Release &release) { return release.value > value; });
+  for (auto it = acquired; it != releases.end(); ++it) {
+    VkBufferMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    barrier.srcStageMask = ConsumerStages;
+    barrier.dstStageMask = ConsumerStages;
+    barrier.dstAccessMask = ConsumerAccess;
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    barrier.buffer = it->buffer;
+    barrier.offset = it->offset;
+    barrier.size = it->size;
+    barriers.push_back(barrier);
+  }
+  releases.erase(acquired, releases.end());
+
+  VkMemoryBarrier2 memory{};
+  memory.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+  memory.srcStageMask = ConsumerStages;
+  memory.dstStageMask = ConsumerStages;
+  memory.dstAccessMask = ConsumerAccess;
+
+  VkDependencyInfo dep{};
+  dep.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+  if (ownershipTransfer()) {
+    dep.bufferMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+    dep.pBufferMemoryBarriers = barriers.data();
+  } else {
+    // Same family, there is nothing to acquire but the chain
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers = &memory;
+  }
+  vkCmdPipelineBarrier2(cmd, &dep);
+
+  acquiredValue = value;
+}
+
+uint64_t UploadQueue::queryCompleted() {
+  VK_CHECK(vkGetSemaphoreCounterValue(device.getLogical(), timeline,
+                                      &completedValue));
+  return completedValue;
+}
+
+bool UploadQueue::isComplete(UploadTicket ticket) {
+  return ticket.value <= completedValue || ticket.value <= queryCompleted();
+}
+
+void UploadQueue::wait(UploadTicket ticket) {
+  if (isComplete(ticket))
+    return;
+  if (ticket.value == nextValue)
+    flush();
+  // Never submitted, there was nothing to copy
+  if (ticket.value >= nextValue)
+    return;
+
+  VkSemaphoreWaitInfo waitInfo{};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores = &timeline;
+  waitInfo.pValues = &ticket.value;
+  VK_CHECK(vkWaitSemaphores(device.getLogical(), &waitInfo, UINT64_MAX));
+  completedValue = std::max(completedValue, ticket.value);
+}
+
+void UploadQueue::waitIdle() {
+  flush();
+  wait(UploadTicket{nextValue - 1});
+}
+
+void UploadQueue::collect() {
+  if (inFlight.empty())
+    return;
+  uint64_t completed = queryCompleted();
+  while (!inFlight.empty() && inFlight.front().value <= completed) {
+    freeCommands.push_back(inFlight.front().cmd);
+    stagingTail = inFlight.front().stagingEnd;
+    inFlight.pop_front();
+  }
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "rhi/vulkan/buffer.h"
+#include "rhi/vulkan/device.h"
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Point on the upload timeline. The data is in place once the timeline
+// semaphore reaches value; a default ticket is always complete.
+struct UploadTicket {
+  uint64_t value = 0;
+};
+
+// Asynchronous buffer uploads on the transfer queue. Data is staged in a
+// persistently mapped ring and copies are batched: everything uploaded
+// between two flushes goes out as one command buffer and one submit that
+// signals the next value of a timeline semaphore. The first graphics
+// submission that draws from the data waits on that value and, when the
+// transfer family differs from the graphics one, acquires the released
+// ranges. Every method is called from one thread.
+class UploadQueue {
+public:
+  explicit UploadQueue(Device &device,
+                       VkDeviceSize stagingSize = 64ull * 1024 * 1024);
+  ~UploadQueue();
+
+  UploadQueue(const UploadQueue &) = delete;
+  UploadQueue &operator=(const UploadQueue &) = delete;
+
+  // Stages size bytes of data and queues their copy into dst at dstOffset.
+  // dst is then read as vertex or index data, or as a storage buffer by
+  // compute, on the graphics queue. Only blocks when the staging ring is
+  // full of copies still in flight.
+  UploadTicket upload(const Buffer &dst, const void *data, VkDeviceSize size,
+                      VkDeviceSize dstOffset = 0);
+  // Submits the queued copies as one batch, nothing when there are none
+  void flush();
+
+  // Value a graphics submission reading ticket's data has to wait for, 0
+  // when an earlier submission already waited and acquired it. The ticket
+  // must have been flushed.
+  uint64_t getWaitValue(UploadTicket ticket) const noexcept {
+    return ticket.value > acquiredValue ? ticket.value : 0;
+  }
+  // Records the graphics-side acquire of every upload up to value. The
+  // submission of cmd must wait on getSemaphore() for value at WaitStage;
+  // later submissions on the graphics queue are covered by the barrier.
+  void acquire(VkCommandBuffer cmd, uint64_t value);
+
+  bool isComplete(UploadTicket ticket);
+  // Blocks the calling thread until ticket's copies are done, flushing
+  // them first if needed
+  void wait(UploadTicket ticket);
+  // Blocks until every queued upload is done
+  void waitIdle();
+  // Recycles the staging space and command buffers of finished batches
+  void collect();
+
+  VkSemaphore getSemaphore() const noexcept { return timeline; }
+  // Graphics queue stages that consume uploads: vertex and index fetch,
+  // and compute reading the meshlet buffer before the draws
+  static constexpr VkPipelineStageFlags WaitStage =
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  // Batches submitted so far
+  uint64_t getSubmitCount() const noexcept { return nextValue - 1; }
+
+private:
+  // Submitted batch, its staging space is reused once the timeline passes
+  // value
+  struct Batch {
+    uint64_t value = 0;
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    VkDeviceSize stagingEnd = 0;
+  };
+  // Copy queued for the next flush
+  struct Copy {
+    VkBuffer dst = VK_NULL_HANDLE;
+    VkBufferCopy region{};
+  };
+  // Range released by the transfer queue, not yet acquired by graphics
+  struct Release {
+    uint64_t value = 0;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+  };
+
+  bool ownershipTransfer() const noexcept {
+    return transferFamily != graphicsFamily;
+  }
+  uint64_t queryCompleted();
+  // Offset of size bytes in the staging ring, waiting for the oldest batch
+  // in flight while there is no room
+  VkDeviceSize allocateStaging(VkDeviceSize size);
+  VkCommandBuffer getCommandBuffer();
+
+  Device &device;
+  uint32_t transferFamily = 0;
+  uint32_t graphicsFamily = 0;
+  VkCommandPool pool = VK_NULL_HANDLE;
+  VkSemaphore timeline = VK_NULL_HANDLE;
+
+  // Positions grow monotonically, the ring offset is position % size
+  Buffer staging;
+  VkDeviceSize stagingSize = 0;
+  VkDeviceSize stagingHead = 0;
+  VkDeviceSize stagingTail = 0;
+
+  // Value the next flush signals
+  uint64_t nextValue = 1;
+  // Last value the semaphore was seen at
+  uint64_t completedValue = 0;
+  // Highest value a graphics submission waited on and acquired
+  uint64_t acquiredValue = 0;
+
+  std::vector<Copy> copies;
+  std::deque<Batch> inFlight;
+  std::vector<VkCommandBuffer> freeCommands;
+  std::vector<Release> releases;
+};